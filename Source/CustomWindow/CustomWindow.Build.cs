@@ -26,6 +26,8 @@ public class CustomWindow : ModuleRules
 			new string[]
 			{
 				"Core",
+				"CoreUObject",
+				"Engine",
 				// ... add other public dependencies that you statically link with here ...
 			}
 			);
@@ -34,14 +36,15 @@ public class CustomWindow : ModuleRules
 		PrivateDependencyModuleNames.AddRange(
 			new string[]
 			{
-				"CoreUObject",
-				"Engine",
 				"Slate",
 				"SlateCore",
 				"WorkspaceMenuStructure",
 				"InputCore",
+				"Json",
 				"PropertyEditor",
 				"RenderCore",
+				"RHI",
+				"Projects",
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
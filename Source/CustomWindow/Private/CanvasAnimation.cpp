@@ -0,0 +1,66 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CanvasAnimation.h"
+
+float GetCanvasAnimationAlpha(const FCanvasAnimationTrack& Track, double Time, bool& bOutFinished)
+{
+	bOutFinished = false;
+	const float Elapsed = static_cast<float>(FMath::Max(Time - Track.StartTime, 0.0));
+	if (Track.Duration <= 0.f)
+	{
+		bOutFinished = Track.Loop == ECanvasAnimationLoop::Once;
+		return 1.f;
+	}
+
+	const float Cycles = Elapsed / Track.Duration;
+	switch (Track.Loop)
+	{
+	case ECanvasAnimationLoop::Repeat:
+		return FMath::Frac(Cycles);
+	case ECanvasAnimationLoop::PingPong:
+	{
+		const float Phase = FMath::Frac(Cycles * 0.5f) * 2.f;
+		return Phase > 1.f ? 2.f - Phase : Phase;
+	}
+	default:
+		bOutFinished = Cycles >= 1.f;
+		return FMath::Min(Cycles, 1.f);
+	}
+}
+
+template<typename InstanceType>
+static void ApplyPositionOrColor(InstanceType& Item, ECanvasAnimatedProperty Property, const FVector4f& Value)
+{
+	if (Property == ECanvasAnimatedProperty::Position)
+	{
+		Item.Position = FVector2D(Value.X, Value.Y);
+	}
+	else if (Property == ECanvasAnimatedProperty::Color)
+	{
+		Item.Color = FLinearColor(Value.X, Value.Y, Value.Z, Value.W);
+	}
+}
+
+void ApplyCanvasAnimationValue(FBoxInstance& Item, ECanvasAnimatedProperty Property, const FVector4f& Value)
+{
+	ApplyPositionOrColor(Item, Property, Value);
+	if (Property == ECanvasAnimatedProperty::Size)
+	{
+		Item.Size = FVector2D(Value.X, Value.Y);
+	}
+}
+
+void ApplyCanvasAnimationValue(FTextInstance& Item, ECanvasAnimatedProperty Property, const FVector4f& Value)
+{
+	// Scaling a text would mean laying it out again every frame, texts only animate position and color
+	ApplyPositionOrColor(Item, Property, Value);
+}
+
+void ApplyCanvasAnimationValue(FTileInstance& Item, ECanvasAnimatedProperty Property, const FVector4f& Value)
+{
+	ApplyPositionOrColor(Item, Property, Value);
+	if (Property == ECanvasAnimatedProperty::Size)
+	{
+		Item.Size = FVector2D(Value.X, Value.Y);
+	}
+}
@@ -0,0 +1,202 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CanvasAutosave.h"
+
+#include "Async/Async.h"
+#include "CanvasJournal.h"
+#include "CanvasSceneSerializer.h"
+#include "HAL/FileManager.h"
+#include "Misc/Crc.h"
+#include "Misc/FileHelper.h"
+
+namespace CanvasAutosave
+{
+	struct FLogHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		uint32 SnapshotCrc;
+		uint32 Reserved;
+	};
+
+	constexpr int64 AppendedToLog = -1;
+	constexpr int64 WriteFailed = -2;
+
+	static int64 AppendToLog(const FString& LogPath, const TArray<uint8>& Bytes)
+	{
+		if (!FFileHelper::SaveArrayToFile(Bytes, *LogPath, &IFileManager::Get(), FILEWRITE_Append))
+		{
+			UE_LOG(LogCustomWindow, Warning, TEXT("Failed to append %d bytes to the autosave log %s"), Bytes.Num(), *LogPath);
+			return WriteFailed;
+		}
+		return AppendedToLog;
+	}
+
+	/** Replaces the snapshot and starts an empty log against it, returns the snapshot size or WriteFailed */
+	static int64 WriteSnapshot(const FString& SnapshotPath, const FString& LogPath, const FCanvasSceneData& Snapshot)
+	{
+		TArray<uint8> SnapshotData;
+		FCanvasSceneSerializer::WriteBinary(Snapshot, SnapshotData);
+		const FLogHeader Header{ FCanvasAutosave::LogMagic, FCanvasAutosave::LogVersion, FCrc::MemCrc32(SnapshotData.GetData(), SnapshotData.Num()), 0 };
+		const TArray<uint8> LogData(reinterpret_cast<const uint8*>(&Header), sizeof(FLogHeader));
+
+		// Both files are written aside first. Between the two moves the new snapshot only matches the temporary log,
+		// which Load falls back to
+		const FString SnapshotTemp = SnapshotPath + TEXT(".tmp");
+		const FString LogTemp = LogPath + TEXT(".tmp");
+		IFileManager& FileManager = IFileManager::Get();
+		if (!FFileHelper::SaveArrayToFile(SnapshotData, *SnapshotTemp) || !FFileHelper::SaveArrayToFile(LogData, *LogTemp)
+			|| !FileManager.Move(*SnapshotPath, *SnapshotTemp) || !FileManager.Move(*LogPath, *LogTemp))
+		{
+			UE_LOG(LogCustomWindow, Warning, TEXT("Failed to write the autosave snapshot %s"), *SnapshotPath);
+			return WriteFailed;
+		}
+		return SnapshotData.Num();
+	}
+}
+
+FCanvasAutosave::FCanvasAutosave(const FString& InBasePath)
+	: SnapshotPath(GetSnapshotPath(InBasePath))
+	, LogPath(GetLogPath(InBasePath))
+{
+}
+
+FCanvasAutosave::~FCanvasAutosave()
+{
+	if (IsWriting())
+	{
+		Writing.Wait();
+		IsWriting();
+	}
+	if (bWriteFailed && Pending.Num() > 0)
+	{
+		UE_LOG(LogCustomWindow, Warning, TEXT("Dropped %d bytes of deltas, the autosave log %s is behind after a failed write"), Pending.Num(), *LogPath);
+	}
+	else if (Pending.Num() > 0)
+	{
+		CanvasAutosave::AppendToLog(LogPath, Pending);
+	}
+}
+
+void FCanvasAutosave::Append(const FCanvasDelta& Delta)
+{
+	FCanvasJournal::WriteDelta(Delta, Pending);
+}
+
+bool FCanvasAutosave::IsWriting()
+{
+	if (Writing.IsValid() && Writing.IsReady())
+	{
+		const int64 Result = Writing.Get();
+		bWriteFailed |= Result == CanvasAutosave::WriteFailed;
+		if (Result >= 0)
+		{
+			SnapshotBytes = Result;
+			bWriteFailed = false;
+		}
+		Writing = TFuture<int64>();
+	}
+	return Writing.IsValid();
+}
+
+bool FCanvasAutosave::NeedsCompaction() const
+{
+	return bWriteFailed || LogBytes + Pending.Num() > FMath::Max(SnapshotBytes, MinCompactionBytes);
+}
+
+void FCanvasAutosave::Flush()
+{
+	if (Pending.Num() == 0 || IsWriting())
+	{
+		return;
+	}
+
+	LogBytes += Pending.Num();
+	Writing = Async(EAsyncExecution::ThreadPool, [LogPath = LogPath, Bytes = MoveTemp(Pending)]()
+	{
+		return CanvasAutosave::AppendToLog(LogPath, Bytes);
+	});
+	Pending.Reset();
+}
+
+void FCanvasAutosave::Compact(FCanvasSceneData&& Snapshot)
+{
+	// Appends still running target the log about to be replaced
+	if (IsWriting())
+	{
+		Writing.Wait();
+		IsWriting();
+	}
+
+	Pending.Reset();
+	LogBytes = 0;
+	Writing = Async(EAsyncExecution::ThreadPool, [SnapshotPath = SnapshotPath, LogPath = LogPath, Snapshot = MoveTemp(Snapshot)]()
+	{
+		return CanvasAutosave::WriteSnapshot(SnapshotPath, LogPath, Snapshot);
+	});
+}
+
+void FCanvasAutosave::Close(TFunctionRef<void(FCanvasSceneData&)> ExportScene)
+{
+	if (IsWriting())
+	{
+		Writing.Wait();
+		IsWriting();
+	}
+
+	if (bWriteFailed)
+	{
+		// Appending to a log that missed deltas, or that belongs to the previous snapshot, would replay them over the
+		// wrong scene on the next load
+		FCanvasSceneData Snapshot;
+		ExportScene(Snapshot);
+		Pending.Reset();
+		LogBytes = 0;
+		const int64 Result = CanvasAutosave::WriteSnapshot(SnapshotPath, LogPath, Snapshot);
+		bWriteFailed = Result == CanvasAutosave::WriteFailed;
+		if (!bWriteFailed)
+		{
+			SnapshotBytes = Result;
+		}
+	}
+	else if (Pending.Num() > 0)
+	{
+		LogBytes += Pending.Num();
+		bWriteFailed = CanvasAutosave::AppendToLog(LogPath, Pending) == CanvasAutosave::WriteFailed;
+		Pending.Reset();
+	}
+}
+
+bool FCanvasAutosave::Load(const FString& BasePath, FCanvasSceneData& OutSnapshot, TArray<uint8>& OutLog)
+{
+	using namespace CanvasAutosave;
+
+	TArray<uint8> SnapshotData;
+	if (!FFileHelper::LoadFileToArray(SnapshotData, *GetSnapshotPath(BasePath), FILEREAD_Silent)
+		|| !FCanvasSceneSerializer::ReadBinary(SnapshotData, OutSnapshot))
+	{
+		return false;
+	}
+
+	const uint32 SnapshotCrc = FCrc::MemCrc32(SnapshotData.GetData(), SnapshotData.Num());
+	const FString LogPaths[] = { GetLogPath(BasePath), GetLogPath(BasePath) + TEXT(".tmp") };
+	for (const FString& Path : LogPaths)
+	{
+		TArray<uint8> LogData;
+		if (!FFileHelper::LoadFileToArray(LogData, *Path, FILEREAD_Silent) || LogData.Num() < static_cast<int32>(sizeof(FLogHeader)))
+		{
+			continue;
+		}
+
+		FLogHeader Header;
+		FMemory::Memcpy(&Header, LogData.GetData(), sizeof(FLogHeader));
+		if (Header.Magic == LogMagic && Header.Version == LogVersion && Header.SnapshotCrc == SnapshotCrc)
+		{
+			OutLog.Append(LogData.GetData() + sizeof(FLogHeader), LogData.Num() - sizeof(FLogHeader));
+			return true;
+		}
+	}
+
+	UE_LOG(LogCustomWindow, Warning, TEXT("No delta log matches the autosave %s, restoring the snapshot alone"), *GetSnapshotPath(BasePath));
+	return true;
+}
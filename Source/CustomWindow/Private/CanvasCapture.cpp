@@ -0,0 +1,276 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CanvasCapture.h"
+
+#include "Async/Async.h"
+#include "CanvasTypes.h"
+#include "CustomWindowStats.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "ImageUtils.h"
+#include "Misc/App.h"
+#include "Misc/FileHelper.h"
+#include "RHIGPUReadback.h"
+#include "RenderingThread.h"
+#include "TextureResource.h"
+#include "UObject/Package.h"
+
+struct FCanvasCapture::FPendingReadback
+{
+	FRHIGPUTextureReadback Readback{ TEXT("CustomWindowCapture") };
+	FIntPoint Size = FIntPoint::ZeroValue;
+	FColor Background;
+	FString FilePath;
+	FOnCanvasCaptureSaved OnSaved;
+	/** Render thread only, FColor is BGRA */
+	bool bSwapRedBlue = false;
+	/** Set on the render thread once the pixels went to the worker, the game thread then drops the entry */
+	std::atomic<bool> bDone{ false };
+};
+
+namespace CanvasCapture
+{
+	/** Compresses and writes on a worker and reports back on the game thread */
+	static void SavePixels(TArray<FColor>&& Pixels, const FIntPoint& Size, const FString& FilePath, const FOnCanvasCaptureSaved& OnSaved,
+		const TSharedRef<FThreadSafeCounter, ESPMode::ThreadSafe>& Pending)
+	{
+		Async(EAsyncExecution::ThreadPool, [Pixels = MoveTemp(Pixels), Size, FilePath, OnSaved, Pending]() mutable
+		{
+			// Item blending leaves partial alpha behind, the snapshot is meant to look like the viewport
+			for (FColor& Pixel : Pixels)
+			{
+				Pixel.A = 255;
+			}
+
+			TArray<uint8> Png;
+			FImageUtils::CompressImageArray(Size.X, Size.Y, Pixels, Png);
+			const bool bSaved = Png.Num() > 0 && FFileHelper::SaveArrayToFile(Png, *FilePath);
+
+			AsyncTask(ENamedThreads::GameThread, [FilePath, OnSaved, Pending, bSaved]()
+			{
+				Pending->Decrement();
+				if (bSaved)
+				{
+					UE_LOG(LogCustomWindow, Log, TEXT("Saved scene capture to %s"), *FilePath);
+				}
+				else
+				{
+					UE_LOG(LogCustomWindow, Warning, TEXT("Failed to save scene capture to %s"), *FilePath);
+				}
+				OnSaved.ExecuteIfBound(bSaved);
+			});
+		});
+	}
+}
+
+FCanvasCapture::FCanvasCapture(FCustomViewportClient& InClient)
+	: Client(InClient)
+{
+}
+
+FCanvasCapture::~FCanvasCapture()
+{
+	if (Readbacks.Num() > 0)
+	{
+		PollReadbacks(true);
+		FlushRenderingCommands();
+	}
+}
+
+UTextureRenderTarget2D* FCanvasCapture::GetTarget(const FIntPoint& Resolution)
+{
+	const FIntPoint Size(FMath::Clamp(Resolution.X, 1, 8192), FMath::Clamp(Resolution.Y, 1, 8192));
+	if (!Target)
+	{
+		Target = NewObject<UTextureRenderTarget2D>(GetTransientPackage(), NAME_None, RF_Transient);
+		Target->RenderTargetFormat = RTF_RGBA8_SRGB;
+		Target->ClearColor = Client.BackgroundColor;
+		Target->bAutoGenerateMips = false;
+		Target->InitAutoFormat(Size.X, Size.Y);
+		Target->UpdateResourceImmediate(true);
+		RenderedVersion = MAX_uint64;
+	}
+	else if (Target->SizeX != Size.X || Target->SizeY != Size.Y)
+	{
+		Target->ResizeTarget(Size.X, Size.Y);
+		RenderedVersion = MAX_uint64;
+	}
+	return Target;
+}
+
+void FCanvasCapture::SetView(const FBox2D& InWorldRect)
+{
+	WorldRect = InWorldRect;
+}
+
+bool FCanvasCapture::Update(bool bForce)
+{
+	PollReadbacks(false);
+	if (!Target)
+	{
+		return false;
+	}
+
+	Client.ApplyCommands();
+	const bool bChanged = RenderedVersion != Client.GetVersion()
+		|| !(RenderedRect == WorldRect)
+		|| (!WorldRect.bIsValid && RenderedViewportSize != Client.GetViewportSize());
+	FTextureRenderTargetResource* Resource = Target->GameThread_GetRenderTargetResource();
+	if ((!bChanged && !bForce) || !Resource)
+	{
+		return false;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_CustomWindow_Capture);
+	FVector2D CameraOffset;
+	float CameraZoom;
+	GetCamera(CameraOffset, CameraZoom);
+	Client.FillSnapshot(Snapshot, CameraOffset, CameraZoom, FIntPoint(Target->SizeX, Target->SizeY));
+
+	FCanvas Canvas(Resource, nullptr, FGameTime::GetTimeSinceAppStart(), GMaxRHIFeatureLevel);
+	RenderCounters = FCanvasDrawCounters();
+	Client.DrawSnapshot(&Canvas, Snapshot, RenderCounters);
+	Canvas.Flush_GameThread();
+
+	// Everything was copied into the canvas batches, don't make the next scene edit copy away from these arrays
+	Snapshot.Boxes.Reset();
+	Snapshot.Texts.Reset();
+	Snapshot.Tiles.Reset();
+
+	RenderedVersion = Client.GetVersion();
+	RenderedRect = WorldRect;
+	RenderedViewportSize = Client.GetViewportSize();
+	++NumRenders;
+	return true;
+}
+
+void FCanvasCapture::SavePNG(const FString& FilePath, FOnCanvasCaptureSaved OnSaved)
+{
+	if (!Target)
+	{
+		OnSaved.ExecuteIfBound(false);
+		return;
+	}
+
+	Update();
+	const FIntPoint Size(Target->SizeX, Target->SizeY);
+	const FColor Background = Client.BackgroundColor.ToFColor(true);
+	FTextureRenderTargetResource* Resource = Target->GameThread_GetRenderTargetResource();
+	PendingSaves->Increment();
+	if (!FApp::CanEverRender() || !Resource)
+	{
+		TArray<FColor> Pixels;
+		Pixels.Init(Background, Size.X * Size.Y);
+		CanvasCapture::SavePixels(MoveTemp(Pixels), Size, FilePath, OnSaved, PendingSaves);
+		return;
+	}
+
+	TSharedRef<FPendingReadback, ESPMode::ThreadSafe> Entry = MakeShared<FPendingReadback, ESPMode::ThreadSafe>();
+	Entry->Size = Size;
+	Entry->Background = Background;
+	Entry->FilePath = FilePath;
+	Entry->OnSaved = MoveTemp(OnSaved);
+	Readbacks.Add(Entry);
+
+	// Queued after the render of Update, so the copy sees it
+	ENQUEUE_RENDER_COMMAND(CustomWindowCaptureCopy)([Entry, Resource, Pending = PendingSaves](FRHICommandListImmediate& RHICmdList)
+	{
+		FRHITexture* Texture = Resource->GetRenderTargetTexture();
+		if (!Texture)
+		{
+			TArray<FColor> Pixels;
+			Pixels.Init(Entry->Background, Entry->Size.X * Entry->Size.Y);
+			Entry->bDone = true;
+			CanvasCapture::SavePixels(MoveTemp(Pixels), Entry->Size, Entry->FilePath, Entry->OnSaved, Pending);
+			return;
+		}
+		Entry->bSwapRedBlue = Texture->GetFormat() == PF_R8G8B8A8;
+		Entry->Readback.EnqueueCopy(RHICmdList, Texture);
+	});
+}
+
+void FCanvasCapture::PollReadbacks(bool bWait)
+{
+	Readbacks.RemoveAll([](const TSharedRef<FPendingReadback, ESPMode::ThreadSafe>& Entry) { return Entry->bDone.load(); });
+	if (Readbacks.Num() == 0)
+	{
+		return;
+	}
+
+	ENQUEUE_RENDER_COMMAND(CustomWindowCapturePoll)([Entries = Readbacks, Pending = PendingSaves, bWait](FRHICommandListImmediate& RHICmdList)
+	{
+		bool bWaited = false;
+		for (const TSharedRef<FPendingReadback, ESPMode::ThreadSafe>& Entry : Entries)
+		{
+			if (Entry->bDone)
+			{
+				continue;
+			}
+			if (!Entry->Readback.IsReady())
+			{
+				if (!bWait)
+				{
+					continue;
+				}
+				if (!bWaited)
+				{
+					RHICmdList.BlockUntilGPUIdle();
+					bWaited = true;
+				}
+			}
+
+			const FIntPoint Size = Entry->Size;
+			TArray<FColor> Pixels;
+			int32 RowPitch = 0;
+			const FColor* Data = Entry->Readback.IsReady() ? static_cast<const FColor*>(Entry->Readback.Lock(RowPitch)) : nullptr;
+			if (Data && RowPitch >= Size.X)
+			{
+				// The staging texture rows may be padded
+				Pixels.SetNumUninitialized(Size.X * Size.Y);
+				for (int32 Row = 0; Row < Size.Y; ++Row)
+				{
+					FMemory::Memcpy(&Pixels[Row * Size.X], Data + static_cast<int64>(Row) * RowPitch, Size.X * sizeof(FColor));
+				}
+				if (Entry->bSwapRedBlue)
+				{
+					for (FColor& Pixel : Pixels)
+					{
+						Swap(Pixel.R, Pixel.B);
+					}
+				}
+			}
+			if (Data)
+			{
+				Entry->Readback.Unlock();
+			}
+			if (Pixels.Num() == 0)
+			{
+				Pixels.Init(Entry->Background, Size.X * Size.Y);
+			}
+
+			Entry->bDone = true;
+			CanvasCapture::SavePixels(MoveTemp(Pixels), Size, Entry->FilePath, Entry->OnSaved, Pending);
+		}
+	});
+}
+
+void FCanvasCapture::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	Collector.AddReferencedObject(Target);
+}
+
+void FCanvasCapture::GetCamera(FVector2D& OutOffset, float& OutZoom) const
+{
+	const FVector2D TargetSize(Target->SizeX, Target->SizeY);
+	if (WorldRect.bIsValid)
+	{
+		// Fit the whole rectangle, the target aspect ratio may differ from it
+		const FVector2D WorldSize = WorldRect.GetSize();
+		OutOffset = WorldRect.Min;
+		OutZoom = static_cast<float>(FMath::Min(TargetSize.X / FMath::Max(WorldSize.X, 1.0), TargetSize.Y / FMath::Max(WorldSize.Y, 1.0)));
+		return;
+	}
+
+	const FIntPoint ViewportSize = Client.GetViewportSize();
+	OutOffset = Client.CameraOffset;
+	OutZoom = ViewportSize.X > 0 ? static_cast<float>(Client.CameraZoom * TargetSize.X / ViewportSize.X) : Client.CameraZoom;
+}
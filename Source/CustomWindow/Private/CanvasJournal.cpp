@@ -0,0 +1,344 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CanvasJournal.h"
+
+namespace CanvasDelta
+{
+	// Unaligned, deltas are packed back to back in the blocks and the logs
+	struct FHeader
+	{
+		uint8 Op;
+		uint8 Type;
+		uint8 Property;
+		uint8 Reserved;
+		uint32 BeforeSize;
+		uint32 AfterSize;
+		int32 BeforePosition;
+		int32 AfterPosition;
+	};
+
+	static_assert(sizeof(FHeader) == 20, "Delta header layout changed");
+
+	static void WriteDeltaTo(const FCanvasDelta& Delta, uint8* Data)
+	{
+		const FHeader Header{ static_cast<uint8>(Delta.Op), static_cast<uint8>(Delta.Type), static_cast<uint8>(Delta.Property), 0,
+			static_cast<uint32>(Delta.Before.Num()), static_cast<uint32>(Delta.After.Num()), Delta.BeforePosition, Delta.AfterPosition };
+		FMemory::Memcpy(Data, &Header, sizeof(FHeader));
+		FMemory::Memcpy(Data + sizeof(FHeader), Delta.Before.GetData(), Delta.Before.Num());
+		FMemory::Memcpy(Data + sizeof(FHeader) + Delta.Before.Num(), Delta.After.GetData(), Delta.After.Num());
+	}
+
+	/** Returns the size of the delta at Data, or 0 when the Available bytes don't hold a valid one */
+	static int64 ReadDeltaAt(const uint8* Data, int64 Available, FCanvasDelta& OutDelta)
+	{
+		if (Available < static_cast<int64>(sizeof(FHeader)))
+		{
+			return 0;
+		}
+
+		FHeader Header;
+		FMemory::Memcpy(&Header, Data, sizeof(FHeader));
+		const int64 Size = sizeof(FHeader) + static_cast<int64>(Header.BeforeSize) + Header.AfterSize;
+		if (Size > Available || Header.Op > static_cast<uint8>(ECanvasDeltaOp::Clear) || Header.Type > static_cast<uint8>(ECanvasItemType::Num)
+			|| Header.Property > static_cast<uint8>(ECanvasDeltaProperty::Size) || Header.BeforePosition < INDEX_NONE || Header.AfterPosition < INDEX_NONE)
+		{
+			return 0;
+		}
+
+		OutDelta.Op = static_cast<ECanvasDeltaOp>(Header.Op);
+		OutDelta.Type = static_cast<ECanvasItemType>(Header.Type);
+		OutDelta.Property = static_cast<ECanvasDeltaProperty>(Header.Property);
+		OutDelta.Before = MakeArrayView(Data + sizeof(FHeader), Header.BeforeSize);
+		OutDelta.After = MakeArrayView(Data + sizeof(FHeader) + Header.BeforeSize, Header.AfterSize);
+		OutDelta.BeforePosition = Header.BeforePosition;
+		OutDelta.AfterPosition = Header.AfterPosition;
+		return Size;
+	}
+
+	void FWriter::WriteString(const FString& String)
+	{
+		FTCHARToUTF8 Converted(*String);
+		Write<uint32>(Converted.Length());
+		Bytes.Append(reinterpret_cast<const uint8*>(Converted.Get()), Converted.Length());
+	}
+
+	void FWriter::operator()(const FCanvasField&, const FVector2D& Value)
+	{
+		Write<float>(Value.X);
+		Write<float>(Value.Y);
+	}
+
+	void FWriter::operator()(const FCanvasField&, const FLinearColor& Value)
+	{
+		Write<float>(Value.R);
+		Write<float>(Value.G);
+		Write<float>(Value.B);
+		Write<float>(Value.A);
+	}
+
+	FString FReader::ReadString()
+	{
+		const uint32 Length = Read<uint32>();
+		if (End - Cursor < static_cast<int64>(Length))
+		{
+			bValid = false;
+			Cursor = End;
+			return FString();
+		}
+
+		const FUTF8ToTCHAR Converted(reinterpret_cast<const ANSICHAR*>(Cursor), Length);
+		Cursor += Length;
+		return FString(Converted.Length(), Converted.Get());
+	}
+
+	void FReader::operator()(const FCanvasField&, FName& Value)
+	{
+		const FString String = ReadString();
+		Value = String.IsEmpty() ? NAME_None : FName(*String);
+	}
+
+	void FReader::operator()(const FCanvasField&, FVector2D& Value)
+	{
+		Value.X = Read<float>();
+		Value.Y = Read<float>();
+	}
+
+	void FReader::operator()(const FCanvasField&, FLinearColor& Value)
+	{
+		Value.R = Read<float>();
+		Value.G = Read<float>();
+		Value.B = Read<float>();
+		Value.A = Read<float>();
+	}
+
+	void WriteProperty(FName Name, const FVector4f& Value, TArray<uint8>& Bytes)
+	{
+		FWriter Writer{ Bytes };
+		Writer(FCanvasField{ TEXT("Name"), TEXT("name") }, Name);
+		Writer.Write<FVector4f>(Value);
+	}
+
+	bool ReadProperty(TArrayView<const uint8> Bytes, FName& OutName, FVector4f& OutValue)
+	{
+		FReader Reader{ Bytes.GetData(), Bytes.GetData() + Bytes.Num() };
+		Reader(FCanvasField{ TEXT("Name"), TEXT("name") }, OutName);
+		OutValue = Reader.Read<FVector4f>();
+		return Reader.bValid && Reader.Cursor == Reader.End;
+	}
+
+	FName ReadName(TArrayView<const uint8> Bytes)
+	{
+		FReader Reader{ Bytes.GetData(), Bytes.GetData() + Bytes.Num() };
+		FName Name;
+		Reader(FCanvasField{ TEXT("Name"), TEXT("name") }, Name);
+		return Reader.bValid ? Name : NAME_None;
+	}
+}
+
+FCanvasDelta FCanvasDelta::Inverse() const
+{
+	FCanvasDelta Inverse = *this;
+	Inverse.Op = Op == ECanvasDeltaOp::Add ? ECanvasDeltaOp::Remove : Op == ECanvasDeltaOp::Remove ? ECanvasDeltaOp::Add : Op;
+	Inverse.Before = After;
+	Inverse.After = Before;
+	Inverse.BeforePosition = AfterPosition;
+	Inverse.AfterPosition = BeforePosition;
+	return Inverse;
+}
+
+FCanvasJournal::FCanvasJournal(int64 InMaxBytes)
+{
+	SetMaxBytes(InMaxBytes);
+}
+
+void FCanvasJournal::BeginTransaction()
+{
+	if (OpenDepth++ == 0)
+	{
+		bTransactionPending = true;
+	}
+}
+
+void FCanvasJournal::EndTransaction()
+{
+	check(OpenDepth > 0);
+	if (--OpenDepth == 0)
+	{
+		bTransactionPending = false;
+		DropOldest();
+	}
+}
+
+void FCanvasJournal::Record(const FCanvasDelta& Delta)
+{
+	if (OpenDepth == 0)
+	{
+		BeginTransaction();
+		Record(Delta);
+		EndTransaction();
+		return;
+	}
+
+	if (bTransactionPending)
+	{
+		DropRedo();
+		Transactions.Add(Entries.Num());
+		NumApplied = Transactions.Num();
+		bTransactionPending = false;
+	}
+
+	const int32 Size = sizeof(CanvasDelta::FHeader) + Delta.Before.Num() + Delta.After.Num();
+	int64 Block;
+	uint8* Data = Allocate(Size, Block);
+	CanvasDelta::WriteDeltaTo(Delta, Data);
+	Entries.Add({ Data, Size, Block });
+}
+
+bool FCanvasJournal::Undo(TFunctionRef<void(const FCanvasDelta&)> Apply)
+{
+	if (!CanUndo())
+	{
+		return false;
+	}
+
+	--NumApplied;
+	for (int32 Index = GetTransactionEnd(NumApplied) - 1; Index >= Transactions[NumApplied]; --Index)
+	{
+		FCanvasDelta Delta;
+		CanvasDelta::ReadDeltaAt(Entries[Index].Data, Entries[Index].Size, Delta);
+		Apply(Delta.Inverse());
+	}
+	return true;
+}
+
+bool FCanvasJournal::Redo(TFunctionRef<void(const FCanvasDelta&)> Apply)
+{
+	if (!CanRedo())
+	{
+		return false;
+	}
+
+	for (int32 Index = Transactions[NumApplied]; Index < GetTransactionEnd(NumApplied); ++Index)
+	{
+		FCanvasDelta Delta;
+		CanvasDelta::ReadDeltaAt(Entries[Index].Data, Entries[Index].Size, Delta);
+		Apply(Delta);
+	}
+	++NumApplied;
+	return true;
+}
+
+void FCanvasJournal::Reset()
+{
+	Blocks.Empty();
+	FirstBlock = 0;
+	AllocatedBytes = 0;
+	Entries.Empty();
+	Transactions.Empty();
+	NumApplied = 0;
+	// A transaction open across the reset starts over with its next delta
+	bTransactionPending = OpenDepth > 0;
+}
+
+void FCanvasJournal::WriteDelta(const FCanvasDelta& Delta, TArray<uint8>& Bytes)
+{
+	const int32 Offset = Bytes.AddUninitialized(sizeof(CanvasDelta::FHeader) + Delta.Before.Num() + Delta.After.Num());
+	CanvasDelta::WriteDeltaTo(Delta, Bytes.GetData() + Offset);
+}
+
+bool FCanvasJournal::ReadDeltas(TArrayView<const uint8> Bytes, TFunctionRef<void(const FCanvasDelta&)> Func)
+{
+	int64 Offset = 0;
+	while (Offset < Bytes.Num())
+	{
+		FCanvasDelta Delta;
+		const int64 Size = CanvasDelta::ReadDeltaAt(Bytes.GetData() + Offset, Bytes.Num() - Offset, Delta);
+		if (Size == 0)
+		{
+			return false;
+		}
+		Func(Delta);
+		Offset += Size;
+	}
+	return true;
+}
+
+uint8* FCanvasJournal::Allocate(int32 Size, int64& OutBlock)
+{
+	if (Blocks.Num() == 0 || Blocks.Last().Max() - Blocks.Last().Num() < Size)
+	{
+		// Deltas larger than a block, long texts mostly, get a block of their own
+		TArray<uint8>& Block = Blocks.AddDefaulted_GetRef();
+		Block.Reserve(FMath::Max(BlockSize, Size));
+		AllocatedBytes += Block.Max();
+	}
+
+	TArray<uint8>& Block = Blocks.Last();
+	OutBlock = FirstBlock + Blocks.Num() - 1;
+	return Block.GetData() + Block.AddUninitialized(Size);
+}
+
+int32 FCanvasJournal::GetTransactionEnd(int32 Transaction) const
+{
+	return Transactions.IsValidIndex(Transaction + 1) ? Transactions[Transaction + 1] : Entries.Num();
+}
+
+void FCanvasJournal::DropRedo()
+{
+	if (NumApplied == Transactions.Num())
+	{
+		return;
+	}
+
+	// The undone deltas are the last ones of the arena, rewind it to the first of them
+	const FEntry& First = Entries[Transactions[NumApplied]];
+	const int32 BlockIndex = static_cast<int32>(First.Block - FirstBlock);
+	for (int32 Index = BlockIndex + 1; Index < Blocks.Num(); ++Index)
+	{
+		AllocatedBytes -= Blocks[Index].Max();
+	}
+	Blocks.SetNum(BlockIndex + 1);
+	Blocks[BlockIndex].SetNum(static_cast<int32>(First.Data - Blocks[BlockIndex].GetData()), false);
+
+	Entries.SetNum(Transactions[NumApplied], false);
+	Transactions.SetNum(NumApplied, false);
+}
+
+void FCanvasJournal::DropOldest()
+{
+	if (AllocatedBytes <= MaxBytes)
+	{
+		return;
+	}
+
+	// Down to three quarters of the budget so the front of the arrays isn't shifted on every transaction
+	const int64 TargetBytes = MaxBytes / 4 * 3;
+	int64 RemainingBytes = AllocatedBytes;
+	int64 KeptBlock = FirstBlock;
+	int32 NumDropped = 0;
+	while (RemainingBytes > TargetBytes && NumDropped < NumApplied - 1)
+	{
+		++NumDropped;
+		for (const int64 FirstKept = Entries[Transactions[NumDropped]].Block; KeptBlock < FirstKept; ++KeptBlock)
+		{
+			RemainingBytes -= Blocks[static_cast<int32>(KeptBlock - FirstBlock)].Max();
+		}
+	}
+	if (NumDropped == 0)
+	{
+		return;
+	}
+
+	const int32 NumEntries = Transactions[NumDropped];
+	Entries.RemoveAt(0, NumEntries, false);
+	Transactions.RemoveAt(0, NumDropped, false);
+	for (int32& FirstEntry : Transactions)
+	{
+		FirstEntry -= NumEntries;
+	}
+	NumApplied -= NumDropped;
+
+	Blocks.RemoveAt(0, static_cast<int32>(KeptBlock - FirstBlock), false);
+	FirstBlock = KeptBlock;
+	AllocatedBytes = RemainingBytes;
+}
@@ -0,0 +1,137 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CanvasPixelBuffer.h"
+
+#include "CustomWindowStats.h"
+#include "Engine/Texture2D.h"
+#include "Misc/ScopeLock.h"
+
+FCanvasPixelBuffer::FCanvasPixelBuffer(const FIntPoint& InSize)
+	: Size(FMath::Clamp(InSize.X, 1, 8192), FMath::Clamp(InSize.Y, 1, 8192))
+{
+	Pixels.SetNumZeroed(Size.X * Size.Y);
+}
+
+void FCanvasPixelBuffer::WritePixels(const FIntRect& Rect, TArrayView<const FColor> InPixels)
+{
+	FIntRect Clipped = Rect;
+	if (InPixels.Num() < Rect.Area() || !ClipRect(Clipped))
+	{
+		return;
+	}
+
+	FScopeLock ScopeLock(&Lock);
+	const int32 SourceStride = Rect.Width();
+	const FIntPoint SourceOffset = Clipped.Min - Rect.Min;
+	for (int32 Row = 0; Row < Clipped.Height(); ++Row)
+	{
+		FMemory::Memcpy(&Pixels[(Clipped.Min.Y + Row) * Size.X + Clipped.Min.X],
+			&InPixels[(SourceOffset.Y + Row) * SourceStride + SourceOffset.X], Clipped.Width() * sizeof(FColor));
+	}
+	AddDirtyRect(Clipped);
+}
+
+void FCanvasPixelBuffer::SetPixel(int32 X, int32 Y, const FColor& Color)
+{
+	if (X < 0 || Y < 0 || X >= Size.X || Y >= Size.Y)
+	{
+		return;
+	}
+
+	FScopeLock ScopeLock(&Lock);
+	Pixels[Y * Size.X + X] = Color;
+	AddDirtyRect(FIntRect(X, Y, X + 1, Y + 1));
+}
+
+void FCanvasPixelBuffer::Fill(const FColor& Color)
+{
+	FScopeLock ScopeLock(&Lock);
+	for (FColor& Pixel : Pixels)
+	{
+		Pixel = Color;
+	}
+	AddDirtyRect(FIntRect(FIntPoint::ZeroValue, Size));
+}
+
+void FCanvasPixelBuffer::Edit(const FIntRect& Rect, TFunctionRef<void(FColor* Pixels, int32 Stride)> Writer)
+{
+	FIntRect Clipped = Rect;
+	if (!ClipRect(Clipped))
+	{
+		return;
+	}
+
+	FScopeLock ScopeLock(&Lock);
+	Writer(&Pixels[Clipped.Min.Y * Size.X + Clipped.Min.X], Size.X);
+	AddDirtyRect(Clipped);
+}
+
+int64 FCanvasPixelBuffer::UploadDirtyRegions(UTexture2D* Texture)
+{
+	check(IsInGameThread());
+	if (!Texture || Texture->GetSizeX() != Size.X || Texture->GetSizeY() != Size.Y)
+	{
+		return 0;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_CustomWindow_PixelUpload);
+	int64 NumPixels = 0;
+	FScopeLock ScopeLock(&Lock);
+	for (const FIntRect& Rect : DirtyRects)
+	{
+		// Packed copy of the rectangle, owned by the render command until the texture is updated
+		const int32 Width = Rect.Width();
+		const int32 Height = Rect.Height();
+		uint8* Data = static_cast<uint8*>(FMemory::Malloc(Width * Height * sizeof(FColor)));
+		for (int32 Row = 0; Row < Height; ++Row)
+		{
+			FMemory::Memcpy(Data + Row * Width * sizeof(FColor), &Pixels[(Rect.Min.Y + Row) * Size.X + Rect.Min.X], Width * sizeof(FColor));
+		}
+
+		FUpdateTextureRegion2D* Region = new FUpdateTextureRegion2D(Rect.Min.X, Rect.Min.Y, 0, 0, Width, Height);
+		Texture->UpdateTextureRegions(0, 1, Region, Width * sizeof(FColor), sizeof(FColor), Data,
+			[](uint8* SrcData, const FUpdateTextureRegion2D* Regions)
+			{
+				FMemory::Free(SrcData);
+				delete Regions;
+			});
+		NumPixels += Rect.Area();
+	}
+	DirtyRects.Reset();
+	NumUploadedPixels += NumPixels;
+	return NumPixels;
+}
+
+bool FCanvasPixelBuffer::ClipRect(FIntRect& Rect) const
+{
+	Rect.Clip(FIntRect(FIntPoint::ZeroValue, Size));
+	return Rect.Width() > 0 && Rect.Height() > 0;
+}
+
+void FCanvasPixelBuffer::AddDirtyRect(const FIntRect& Rect)
+{
+	// Merge with every rectangle it touches, which may in turn touch others
+	FIntRect Merged = Rect;
+	for (int32 Index = DirtyRects.Num() - 1; Index >= 0; --Index)
+	{
+		const FIntRect& Other = DirtyRects[Index];
+		if (Merged.Min.X <= Other.Max.X && Other.Min.X <= Merged.Max.X && Merged.Min.Y <= Other.Max.Y && Other.Min.Y <= Merged.Max.Y)
+		{
+			Merged.Union(Other);
+			DirtyRects.RemoveAtSwap(Index, 1, false);
+			Index = DirtyRects.Num();
+		}
+	}
+	DirtyRects.Add(Merged);
+
+	if (DirtyRects.Num() > MaxDirtyRects)
+	{
+		FIntRect Bounds = DirtyRects[0];
+		for (const FIntRect& Other : DirtyRects)
+		{
+			Bounds.Union(Other);
+		}
+		DirtyRects.Reset();
+		DirtyRects.Add(Bounds);
+	}
+}
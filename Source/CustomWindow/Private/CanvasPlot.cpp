@@ -0,0 +1,151 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CanvasPlot.h"
+
+#include "Math/VectorRegister.h"
+#include "Misc/ScopeLock.h"
+
+void CanvasPlotMinMax(const float* Samples, int32 Num, float& InOutMin, float& InOutMax)
+{
+	int32 Index = 0;
+	if (Num >= 8)
+	{
+		// Two pairs of accumulators so consecutive iterations don't wait on each other
+		VectorRegister4Float Min0 = VectorLoad(Samples);
+		VectorRegister4Float Min1 = VectorLoad(Samples + 4);
+		VectorRegister4Float Max0 = Min0;
+		VectorRegister4Float Max1 = Min1;
+		for (Index = 8; Index + 8 <= Num; Index += 8)
+		{
+			const VectorRegister4Float A = VectorLoad(Samples + Index);
+			const VectorRegister4Float B = VectorLoad(Samples + Index + 4);
+			Min0 = VectorMin(Min0, A);
+			Max0 = VectorMax(Max0, A);
+			Min1 = VectorMin(Min1, B);
+			Max1 = VectorMax(Max1, B);
+		}
+
+		float Lanes[4];
+		VectorStore(VectorMin(Min0, Min1), Lanes);
+		InOutMin = FMath::Min(InOutMin, FMath::Min(FMath::Min(Lanes[0], Lanes[1]), FMath::Min(Lanes[2], Lanes[3])));
+		VectorStore(VectorMax(Max0, Max1), Lanes);
+		InOutMax = FMath::Max(InOutMax, FMath::Max(FMath::Max(Lanes[0], Lanes[1]), FMath::Max(Lanes[2], Lanes[3])));
+	}
+
+	for (; Index < Num; ++Index)
+	{
+		InOutMin = FMath::Min(InOutMin, Samples[Index]);
+		InOutMax = FMath::Max(InOutMax, Samples[Index]);
+	}
+}
+
+FCanvasPlot::FCanvasPlot(int32 InCapacity)
+	: Capacity(AlignCapacity(InCapacity))
+{
+	Samples.SetNumZeroed(Capacity);
+	BlockMin.SetNumZeroed(Capacity / BlockSize);
+	BlockMax.SetNumZeroed(Capacity / BlockSize);
+}
+
+void FCanvasPlot::Append(float Sample)
+{
+	FScopeLock ScopeLock(&Lock);
+	AppendLocked(&Sample, 1);
+}
+
+void FCanvasPlot::Append(TArrayView<const float> InSamples)
+{
+	FScopeLock ScopeLock(&Lock);
+	AppendLocked(InSamples.GetData(), InSamples.Num());
+}
+
+void FCanvasPlot::Reset()
+{
+	FScopeLock ScopeLock(&Lock);
+	NumAppended = 0;
+	PublishedCount.store(0, std::memory_order_relaxed);
+}
+
+void FCanvasPlot::AppendLocked(const float* InSamples, int32 Num)
+{
+	// Only the last Capacity samples would survive the copy
+	if (Num > Capacity)
+	{
+		InSamples += Num - Capacity;
+		NumAppended += Num - Capacity;
+		Num = Capacity;
+	}
+
+	while (Num > 0)
+	{
+		// Capacity is a multiple of the block size, a run up to the end of the block never wraps
+		const int32 Offset = static_cast<int32>(NumAppended % Capacity);
+		const int32 Run = FMath::Min(Num, BlockSize - Offset % BlockSize);
+		FMemory::Memcpy(&Samples[Offset], InSamples, Run * sizeof(float));
+		InSamples += Run;
+		Num -= Run;
+		NumAppended += Run;
+
+		if ((Offset + Run) % BlockSize == 0)
+		{
+			const int32 Block = (Offset + Run) / BlockSize - 1;
+			float Min = MAX_flt;
+			float Max = -MAX_flt;
+			CanvasPlotMinMax(&Samples[Block * BlockSize], BlockSize, Min, Max);
+			BlockMin[Block] = Min;
+			BlockMax[Block] = Max;
+		}
+	}
+	PublishedCount.store(NumAppended, std::memory_order_relaxed);
+}
+
+int32 FCanvasPlot::Decimate(int32 NumColumns, TArray<FVector2f>& OutMinMax) const
+{
+	FScopeLock ScopeLock(&Lock);
+	const uint64 Count = FMath::Min<uint64>(NumAppended, Capacity);
+	const uint64 Start = NumAppended - Count;
+	const int32 Columns = static_cast<int32>(FMath::Min<uint64>(FMath::Max(NumColumns, 0), Count));
+	OutMinMax.SetNumUninitialized(Columns, false);
+
+	for (int32 Column = 0; Column < Columns; ++Column)
+	{
+		float Min = MAX_flt;
+		float Max = -MAX_flt;
+		ScanRange(Start + Count * Column / Columns, Start + Count * (Column + 1) / Columns, Min, Max);
+		OutMinMax[Column] = FVector2f(Min, Max);
+	}
+	return Columns;
+}
+
+void FCanvasPlot::ScanRange(uint64 Begin, uint64 End, float& InOutMin, float& InOutMax) const
+{
+	// Whole blocks from their summary, the partial blocks at both ends sample by sample
+	const uint64 FirstBlock = (Begin + BlockSize - 1) / BlockSize;
+	const uint64 EndBlock = End / BlockSize;
+	if (FirstBlock >= EndBlock)
+	{
+		ScanSamples(Begin, End, InOutMin, InOutMax);
+		return;
+	}
+
+	ScanSamples(Begin, FirstBlock * BlockSize, InOutMin, InOutMax);
+	const int32 NumBlocks = BlockMin.Num();
+	for (uint64 Block = FirstBlock; Block < EndBlock; ++Block)
+	{
+		const int32 Slot = static_cast<int32>(Block % NumBlocks);
+		InOutMin = FMath::Min(InOutMin, BlockMin[Slot]);
+		InOutMax = FMath::Max(InOutMax, BlockMax[Slot]);
+	}
+	ScanSamples(EndBlock * BlockSize, End, InOutMin, InOutMax);
+}
+
+void FCanvasPlot::ScanSamples(uint64 Begin, uint64 End, float& InOutMin, float& InOutMax) const
+{
+	while (Begin < End)
+	{
+		const int32 Offset = static_cast<int32>(Begin % Capacity);
+		const int32 Run = static_cast<int32>(FMath::Min<uint64>(End - Begin, Capacity - Offset));
+		CanvasPlotMinMax(&Samples[Offset], Run, InOutMin, InOutMax);
+		Begin += Run;
+	}
+}
@@ -0,0 +1,303 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CanvasScene.h"
+
+#include "CustomWindowStats.h"
+#include "Engine/Font.h"
+#include "Engine/Texture2D.h"
+#include "EngineFontServices.h"
+#include "Fonts/FontCache.h"
+
+FBox2D GetCanvasItemBounds(const FBoxInstance& Box)
+{
+	const FVector2D HalfThickness(Box.Thickness * 0.5f);
+	return FBox2D(Box.Position - HalfThickness, Box.Position + Box.Size + HalfThickness);
+}
+
+FBox2D GetCanvasItemBounds(const FTextInstance& Text)
+{
+	return FBox2D(Text.Position, Text.Position + Text.LayoutSize);
+}
+
+FBox2D GetCanvasItemBounds(const FTileInstance& Tile)
+{
+	return FBox2D(Tile.Position, Tile.Position + Tile.Size);
+}
+
+void BuildTextLayout(FTextInstance& Text)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BuildTextLayout);
+	Text.Glyphs.Reset();
+	Text.ShapedText.Reset();
+	Text.LayoutSize = FVector2D::ZeroVector;
+	if (!Text.Font)
+	{
+		return;
+	}
+
+	const FString& Message = Text.Message.ToString();
+	if (Text.Font->FontCacheType != EFontCacheType::Offline)
+	{
+		// Shape runtime fonts once, FCanvasTextItem would shape the message again on every draw. Multi-line messages
+		// keep going through FCanvasTextItem, which splits the lines
+		int32 NewLineIndex = INDEX_NONE;
+		if (!Message.FindChar(TEXT('\n'), NewLineIndex) && FEngineFontServices::IsInitialized())
+		{
+			if (const TSharedPtr<FSlateFontCache> FontCache = FEngineFontServices::Get().GetFontCache())
+			{
+				Text.ShapedText = FontCache->ShapeBidiText(Message, Text.Font->GetLegacySlateFontInfo(), 1.0f, TextBiDi::ETextDirection::LeftToRight, GetDefaultTextShapingMethod());
+				Text.LayoutSize = FVector2D(Text.ShapedText->GetMeasuredWidth(), Text.ShapedText->GetMaxTextHeight()) * Text.Scale;
+				return;
+			}
+		}
+		Text.LayoutSize = FVector2D(Text.Font->GetStringSize(*Message), Text.Font->GetStringHeightSize(*Message)) * Text.Scale;
+		return;
+	}
+
+	const UFont* Font = Text.Font;
+	const float LineHeight = Font->GetMaxCharHeight() * Text.Scale.Y;
+	const float CharIncrement = Font->Kerning * Text.Scale.X;
+	Text.Glyphs.Reserve(Message.Len());
+
+	FVector2D Cursor = FVector2D::ZeroVector;
+	for (TCHAR Char : Message)
+	{
+		if (Char == TEXT('\n'))
+		{
+			Cursor = FVector2D(0.f, Cursor.Y + LineHeight);
+			continue;
+		}
+
+		const int32 CharIndex = Font->RemapChar(Char);
+		if (!Font->Characters.IsValidIndex(CharIndex))
+		{
+			continue;
+		}
+
+		const FFontCharacter& FontChar = Font->Characters[CharIndex];
+		const UTexture2D* Texture = Font->Textures.IsValidIndex(FontChar.TextureIndex) ? Font->Textures[FontChar.TextureIndex].Get() : nullptr;
+		const FVector2D GlyphSize = FVector2D(FontChar.USize, FontChar.VSize) * Text.Scale;
+		if (Texture && GlyphSize.X > 0.f && GlyphSize.Y > 0.f)
+		{
+			const FVector2D InvTextureSize(1.f / Texture->GetSurfaceWidth(), 1.f / Texture->GetSurfaceHeight());
+			FCanvasGlyphQuad& Glyph = Text.Glyphs.AddDefaulted_GetRef();
+			Glyph.Min = Cursor + FVector2D(0.f, FontChar.VerticalOffset * Text.Scale.Y);
+			Glyph.Max = Glyph.Min + GlyphSize;
+			Glyph.UVMin = FVector2D(FontChar.StartU, FontChar.StartV) * InvTextureSize;
+			Glyph.UVMax = FVector2D(FontChar.StartU + FontChar.USize, FontChar.StartV + FontChar.VSize) * InvTextureSize;
+			Glyph.TextureIndex = FontChar.TextureIndex;
+		}
+
+		Cursor.X += GlyphSize.X + CharIncrement;
+		Text.LayoutSize.X = FMath::Max(Text.LayoutSize.X, Cursor.X);
+	}
+	Text.LayoutSize.Y = Cursor.Y + LineHeight;
+}
+
+FCanvasItemHandle FCanvasScene::Find(FName Name) const
+{
+	if (const int32* SlotIndex = NameToSlot.Find(Name))
+	{
+		return FCanvasItemHandle{ *SlotIndex, Slots[*SlotIndex].Generation };
+	}
+	return FCanvasItemHandle();
+}
+
+bool FCanvasScene::IsValid(FCanvasItemHandle Handle) const
+{
+	return Slots.IsValidIndex(Handle.Slot)
+		&& Slots[Handle.Slot].Generation == Handle.Generation
+		&& Slots[Handle.Slot].Index != INDEX_NONE;
+}
+
+void FCanvasScene::UpdateBounds(int32 SlotIndex)
+{
+	const FSlot& Slot = Slots[SlotIndex];
+	VisitSlot(Slot, [this, SlotIndex, &Slot](const auto& Storage)
+	{
+		SpatialIndex.Update(SlotIndex, GetCanvasItemBounds((*Storage.Items)[Slot.Index]));
+	});
+}
+
+void FCanvasScene::QueryVisible(const FBox2D& Rect, TArray<int32>& OutBoxes, TArray<int32>& OutTexts, TArray<int32>& OutTiles) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FCanvasScene::QueryVisible);
+
+	// Indexed by ECanvasItemType
+	TArray<int32>* const Outputs[] = { &OutBoxes, &OutTexts, &OutTiles };
+	static_assert(UE_ARRAY_COUNT(Outputs) == static_cast<SIZE_T>(ECanvasItemType::Num), "One output per item type");
+	for (TArray<int32>* Output : Outputs)
+	{
+		Output->Reset();
+	}
+
+	SpatialIndex.Query(Rect, [this, &Outputs](int32 SlotIndex)
+	{
+		const FSlot& Slot = Slots[SlotIndex];
+		Outputs[static_cast<int32>(Slot.Type)]->Add(Slot.Index);
+	});
+
+	for (TArray<int32>* Output : Outputs)
+	{
+		Output->Sort();
+	}
+}
+
+FCanvasItemHandle FCanvasScene::Pick(const FVector2D& Point) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FCanvasScene::Pick);
+
+	int32 BestSlot = INDEX_NONE;
+	int32 BestLayer = 0;
+	int32 BestDrawOrder = 0;
+	SpatialIndex.Query(FBox2D(Point, Point), [this, &BestSlot, &BestLayer, &BestDrawOrder](int32 SlotIndex)
+	{
+		const FSlot& Slot = Slots[SlotIndex];
+		int32 Layer = 0;
+		int32 DrawOrder = 0;
+		VisitSlot(Slot, [&Slot, &Layer, &DrawOrder](const auto& Storage)
+		{
+			Layer = (*Storage.Items)[Slot.Index].Layer;
+			DrawOrder = TCanvasItemType<typename TDecay<decltype(Storage)>::Type::ItemType>::DrawOrder;
+		});
+
+		if (BestSlot == INDEX_NONE
+			|| Layer > BestLayer
+			|| (Layer == BestLayer && DrawOrder > BestDrawOrder)
+			|| (Layer == BestLayer && DrawOrder == BestDrawOrder && Slot.Index > Slots[BestSlot].Index))
+		{
+			BestSlot = SlotIndex;
+			BestLayer = Layer;
+			BestDrawOrder = DrawOrder;
+		}
+	});
+
+	return BestSlot != INDEX_NONE ? FCanvasItemHandle{ BestSlot, Slots[BestSlot].Generation } : FCanvasItemHandle();
+}
+
+void FCanvasScene::QueryRect(const FBox2D& Rect, TArray<FCanvasItemHandle>& OutHandles) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FCanvasScene::QueryRect);
+	SpatialIndex.Query(Rect, [this, &OutHandles](int32 SlotIndex)
+	{
+		OutHandles.Add(FCanvasItemHandle{ SlotIndex, Slots[SlotIndex].Generation });
+	});
+}
+
+FBox2D FCanvasScene::GetBounds(FCanvasItemHandle Handle) const
+{
+	return IsValid(Handle) && SpatialIndex.Contains(Handle.Slot) ? SpatialIndex.GetBounds(Handle.Slot) : FBox2D(ForceInit);
+}
+
+int32 FCanvasScene::GetLayerPosition(FCanvasItemHandle Handle, TArrayView<const FCanvasItemHandle> Ignored) const
+{
+	if (!IsValid(Handle))
+	{
+		return INDEX_NONE;
+	}
+
+	const FSlot& Slot = Slots[Handle.Slot];
+	int32 LayerStart = 0;
+	VisitSlot(Slot, [&Slot, &LayerStart](const auto& Storage)
+	{
+		const auto& Items = *Storage.Items;
+		LayerStart = GetLayerStart(Items, Items[Slot.Index].Layer);
+	});
+
+	int32 Position = Slot.Index - LayerStart;
+	for (FCanvasItemHandle Other : Ignored)
+	{
+		if (!IsValid(Other))
+		{
+			continue;
+		}
+
+		const FSlot& OtherSlot = Slots[Other.Slot];
+		if (OtherSlot.Type == Slot.Type && OtherSlot.Index >= LayerStart && OtherSlot.Index < Slot.Index)
+		{
+			--Position;
+		}
+	}
+	return Position;
+}
+
+void FCanvasScene::SetLayerPosition(FCanvasItemHandle Handle, int32 Position)
+{
+	if (IsValid(Handle))
+	{
+		VisitSlot(Slots[Handle.Slot], [this, &Handle, Position](const auto& Storage)
+		{
+			MoveInLayer<typename TDecay<decltype(Storage)>::Type::ItemType>(Handle.Slot, Position);
+		});
+	}
+}
+
+bool FCanvasScene::Remove(FName Name)
+{
+	if (const int32* SlotIndex = NameToSlot.Find(Name))
+	{
+		RemoveSlot(*SlotIndex);
+		return true;
+	}
+	return false;
+}
+
+bool FCanvasScene::Remove(FCanvasItemHandle Handle)
+{
+	if (!IsValid(Handle))
+	{
+		return false;
+	}
+
+	RemoveSlot(Handle.Slot);
+	return true;
+}
+
+void FCanvasScene::Empty()
+{
+	// Snapshots may still be reading the old arrays, start from fresh ones instead of emptying them
+	Storages = decltype(Storages)();
+	NameToSlot.Empty();
+	SpatialIndex.Reset();
+
+	// The slots stay with their generation bumped, so handles from before don't match the items added after
+	FreeSlots.Reset(Slots.Num());
+	for (int32 SlotIndex = Slots.Num() - 1; SlotIndex >= 0; --SlotIndex)
+	{
+		FSlot& Slot = Slots[SlotIndex];
+		if (Slot.Index != INDEX_NONE)
+		{
+			Slot.Name = NAME_None;
+			Slot.Index = INDEX_NONE;
+			Slot.Type = ECanvasItemType::Num;
+			++Slot.Generation;
+		}
+		FreeSlots.Add(SlotIndex);
+	}
+}
+
+int32 FCanvasScene::AllocateSlot(FName Name, ECanvasItemType Type)
+{
+	const int32 SlotIndex = FreeSlots.Num() > 0 ? FreeSlots.Pop(false) : Slots.AddDefaulted();
+	FSlot& Slot = Slots[SlotIndex];
+	Slot.Name = Name;
+	Slot.Type = Type;
+	return SlotIndex;
+}
+
+void FCanvasScene::RemoveSlot(int32 SlotIndex)
+{
+	FSlot& Slot = Slots[SlotIndex];
+	VisitSlot(Slot, [this, &Slot](const auto& Storage)
+	{
+		RemoveFromArray<typename TDecay<decltype(Storage)>::Type::ItemType>(Slot.Index);
+	});
+
+	NameToSlot.Remove(Slot.Name);
+	SpatialIndex.Remove(SlotIndex);
+	Slot.Name = NAME_None;
+	Slot.Index = INDEX_NONE;
+	Slot.Type = ECanvasItemType::Num;
+	++Slot.Generation;
+	FreeSlots.Add(SlotIndex);
+}
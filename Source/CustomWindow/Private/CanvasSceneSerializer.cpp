@@ -0,0 +1,478 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CanvasSceneSerializer.h"
+
+#include "Async/MappedFileHandle.h"
+#include "CustomWindowStats.h"
+#include "Dom/JsonObject.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+namespace CanvasSceneBinary
+{
+	// Every field is 4 bytes wide so the records have no padding and stay 4 byte aligned behind the header
+	struct FHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		/** Records of every primitive, in ECanvasItemType order */
+		uint32 NumItems[static_cast<int32>(ECanvasItemType::Num)];
+		uint32 NumStrings;
+		uint32 StringBytes;
+		uint32 Reserved;
+	};
+
+	// A new primitive needs a new file version, with a reader for the old header
+	static_assert(sizeof(FHeader) == 32, "Binary scene header layout changed");
+
+	class FStringTableWriter
+	{
+	public:
+		FStringTableWriter()
+		{
+			Add(FString());
+		}
+
+		uint32 Add(const FString& String)
+		{
+			if (const uint32* Existing = Indices.Find(String))
+			{
+				return *Existing;
+			}
+
+			const uint32 Index = Offsets.Num();
+			Offsets.Add(Bytes.Num());
+			FTCHARToUTF8 Converted(*String);
+			Bytes.Append(reinterpret_cast<const uint8*>(Converted.Get()), Converted.Length());
+			Indices.Add(String, Index);
+			return Index;
+		}
+
+		uint32 Add(FName Name)
+		{
+			return Add(Name.IsNone() ? FString() : Name.ToString());
+		}
+
+		TMap<FString, uint32> Indices;
+		TArray<uint32> Offsets;
+		TArray<uint8> Bytes;
+	};
+
+	/** Record of an item: its fields in visiting order, strings and names as string table indices */
+	struct FRecordWriter
+	{
+		TArray<uint8>& Bytes;
+		FStringTableWriter& Strings;
+
+		template<typename T>
+		void Write(T Value)
+		{
+			Bytes.Append(reinterpret_cast<const uint8*>(&Value), sizeof(T));
+		}
+
+		void operator()(const FCanvasField&, FName Value) { Write<uint32>(Strings.Add(Value)); }
+		void operator()(const FCanvasField&, const FString& Value) { Write<uint32>(Strings.Add(Value)); }
+		void operator()(const FCanvasField&, float Value) { Write<float>(Value); }
+		void operator()(const FCanvasField&, int32 Value) { Write<int32>(Value); }
+
+		void operator()(const FCanvasField&, const FVector2D& Value)
+		{
+			Write<float>(Value.X);
+			Write<float>(Value.Y);
+		}
+
+		void operator()(const FCanvasField&, const FLinearColor& Value)
+		{
+			Write<float>(Value.R);
+			Write<float>(Value.G);
+			Write<float>(Value.B);
+			Write<float>(Value.A);
+		}
+	};
+
+	struct FRecordReader
+	{
+		const uint8* Cursor;
+		const TArray<FString>& Strings;
+		bool& bValid;
+
+		template<typename T>
+		T Read()
+		{
+			T Value;
+			FMemory::Memcpy(&Value, Cursor, sizeof(T));
+			Cursor += sizeof(T);
+			return Value;
+		}
+
+		const FString& ReadString()
+		{
+			const uint32 Index = Read<uint32>();
+			if (!Strings.IsValidIndex(Index))
+			{
+				bValid = false;
+				return Strings[0];
+			}
+			return Strings[Index];
+		}
+
+		void operator()(const FCanvasField&, FName& Value)
+		{
+			const FString& String = ReadString();
+			Value = String.IsEmpty() ? NAME_None : FName(*String);
+		}
+
+		void operator()(const FCanvasField&, FString& Value) { Value = ReadString(); }
+		void operator()(const FCanvasField&, float& Value) { Value = Read<float>(); }
+		void operator()(const FCanvasField&, int32& Value) { Value = Read<int32>(); }
+
+		void operator()(const FCanvasField&, FVector2D& Value)
+		{
+			Value.X = Read<float>();
+			Value.Y = Read<float>();
+		}
+
+		void operator()(const FCanvasField&, FLinearColor& Value)
+		{
+			Value.R = Read<float>();
+			Value.G = Read<float>();
+			Value.B = Read<float>();
+			Value.A = Read<float>();
+		}
+	};
+
+	/** Bytes FRecordWriter writes for one item of DataType */
+	template<typename DataType>
+	int64 GetRecordSize()
+	{
+		int64 Size = 0;
+		DataType Default;
+		TCanvasPrimitive<DataType>::VisitFields(Default, [&Size](const FCanvasField&, const auto& Value)
+		{
+			using FieldType = typename TDecay<decltype(Value)>::Type;
+			Size += TIsSame<FieldType, FVector2D>::Value ? 2 * sizeof(float) : TIsSame<FieldType, FLinearColor>::Value ? 4 * sizeof(float) : sizeof(uint32);
+		});
+		return Size;
+	}
+}
+
+void FCanvasSceneSerializer::WriteBinary(const FCanvasSceneData& Data, TArray<uint8>& OutBytes)
+{
+	using namespace CanvasSceneBinary;
+
+	FHeader Header;
+	Header.Magic = BinaryMagic;
+	Header.Version = BinaryVersion;
+	Header.Reserved = 0;
+
+	// Records go straight behind a placeholder header, which is filled in once the string table is complete
+	int64 RecordBytes = 0;
+	FCanvasPrimitives::ForEach([&Data, &RecordBytes](auto Primitive)
+	{
+		RecordBytes += (Data.*decltype(Primitive)::Items).Num() * GetRecordSize<typename decltype(Primitive)::DataType>();
+	});
+
+	FStringTableWriter Strings;
+	OutBytes.Reset(sizeof(FHeader) + RecordBytes);
+	OutBytes.AddZeroed(sizeof(FHeader));
+	FCanvasPrimitives::ForEach([&Data, &OutBytes, &Strings, &Header](auto Primitive)
+	{
+		const auto& Items = Data.*decltype(Primitive)::Items;
+		Header.NumItems[static_cast<int32>(decltype(Primitive)::Type)] = Items.Num();
+		FRecordWriter Writer{ OutBytes, Strings };
+		for (const auto& Item : Items)
+		{
+			decltype(Primitive)::VisitFields(Item, Writer);
+		}
+	});
+
+	// Terminating offset so the length of string N is always Offsets[N + 1] - Offsets[N]
+	Strings.Offsets.Add(Strings.Bytes.Num());
+	Header.NumStrings = Strings.Offsets.Num() - 1;
+	Header.StringBytes = Strings.Bytes.Num();
+
+	FMemory::Memcpy(OutBytes.GetData(), &Header, sizeof(FHeader));
+	OutBytes.Append(reinterpret_cast<const uint8*>(Strings.Offsets.GetData()), Strings.Offsets.Num() * sizeof(uint32));
+	OutBytes.Append(Strings.Bytes);
+}
+
+bool FCanvasSceneSerializer::ReadBinary(TArrayView<const uint8> Bytes, FCanvasSceneData& OutData)
+{
+	using namespace CanvasSceneBinary;
+
+	if (Bytes.Num() < static_cast<int32>(sizeof(FHeader)))
+	{
+		UE_LOG(LogCustomWindow, Warning, TEXT("Scene file is too small to hold a header"));
+		return false;
+	}
+
+	const FHeader& Header = *reinterpret_cast<const FHeader*>(Bytes.GetData());
+	if (Header.Magic != BinaryMagic || Header.Version == 0 || Header.Version > BinaryVersion || Header.NumStrings == 0)
+	{
+		UE_LOG(LogCustomWindow, Warning, TEXT("Not a CustomWindow scene or unsupported version %u"), Header.Version);
+		return false;
+	}
+
+	int64 RecordsOffsets[static_cast<int32>(ECanvasItemType::Num)];
+	int64 OffsetsOffset = sizeof(FHeader);
+	FCanvasPrimitives::ForEach([&Header, &RecordsOffsets, &OffsetsOffset](auto Primitive)
+	{
+		const int32 Type = static_cast<int32>(decltype(Primitive)::Type);
+		RecordsOffsets[Type] = OffsetsOffset;
+		OffsetsOffset += static_cast<int64>(Header.NumItems[Type]) * GetRecordSize<typename decltype(Primitive)::DataType>();
+	});
+	const int64 StringsOffset = OffsetsOffset + (static_cast<int64>(Header.NumStrings) + 1) * sizeof(uint32);
+	if (StringsOffset + Header.StringBytes != Bytes.Num())
+	{
+		UE_LOG(LogCustomWindow, Warning, TEXT("Scene file size doesn't match its header"));
+		return false;
+	}
+
+	const uint32* Offsets = reinterpret_cast<const uint32*>(Bytes.GetData() + OffsetsOffset);
+	const ANSICHAR* StringBytes = reinterpret_cast<const ANSICHAR*>(Bytes.GetData() + StringsOffset);
+	TArray<FString> Strings;
+	Strings.Reserve(Header.NumStrings);
+	for (uint32 Index = 0; Index < Header.NumStrings; ++Index)
+	{
+		if (Offsets[Index] > Offsets[Index + 1] || Offsets[Index + 1] > Header.StringBytes)
+		{
+			UE_LOG(LogCustomWindow, Warning, TEXT("Scene file has a corrupt string table"));
+			return false;
+		}
+		const FUTF8ToTCHAR Converted(StringBytes + Offsets[Index], Offsets[Index + 1] - Offsets[Index]);
+		Strings.Emplace(Converted.Length(), Converted.Get());
+	}
+
+	bool bValid = true;
+	FCanvasPrimitives::ForEach([&Bytes, &Header, &RecordsOffsets, &Strings, &bValid, &OutData](auto Primitive)
+	{
+		const int32 Type = static_cast<int32>(decltype(Primitive)::Type);
+		auto& Items = OutData.*decltype(Primitive)::Items;
+		Items.SetNum(Header.NumItems[Type]);
+		FRecordReader Reader{ Bytes.GetData() + RecordsOffsets[Type], Strings, bValid };
+		for (auto& Item : Items)
+		{
+			decltype(Primitive)::VisitFields(Item, Reader);
+		}
+	});
+
+	if (!bValid)
+	{
+		UE_LOG(LogCustomWindow, Warning, TEXT("Scene file references strings outside of its string table"));
+	}
+	return bValid;
+}
+
+bool FCanvasSceneSerializer::SaveBinary(const FCanvasSceneData& Data, const FString& Filename)
+{
+	TArray<uint8> Bytes;
+	WriteBinary(Data, Bytes);
+	if (!FFileHelper::SaveArrayToFile(Bytes, *Filename))
+	{
+		UE_LOG(LogCustomWindow, Warning, TEXT("Failed to write scene file %s"), *Filename);
+		return false;
+	}
+	return true;
+}
+
+bool FCanvasSceneSerializer::LoadBinary(const FString& Filename, FCanvasSceneData& OutData)
+{
+	// Map the file when the platform supports it so the records are read straight from the page cache
+	TUniquePtr<IMappedFileHandle> MappedFile(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Filename));
+	if (MappedFile.IsValid())
+	{
+		TUniquePtr<IMappedFileRegion> Region(MappedFile->MapRegion());
+		if (Region.IsValid())
+		{
+			return ReadBinary(MakeArrayView(Region->GetMappedPtr(), static_cast<int32>(Region->GetMappedSize())), OutData);
+		}
+	}
+
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *Filename))
+	{
+		UE_LOG(LogCustomWindow, Warning, TEXT("Failed to read scene file %s"), *Filename);
+		return false;
+	}
+	return ReadBinary(Bytes, OutData);
+}
+
+namespace CanvasSceneJson
+{
+	static TArray<TSharedPtr<FJsonValue>> MakeArray(std::initializer_list<double> Values)
+	{
+		TArray<TSharedPtr<FJsonValue>> Array;
+		for (double Value : Values)
+		{
+			Array.Add(MakeShared<FJsonValueNumber>(Value));
+		}
+		return Array;
+	}
+
+	/** Sets a field of the item object named after FCanvasField::Key */
+	struct FItemWriter
+	{
+		FJsonObject& Object;
+
+		void operator()(const FCanvasField& Field, FName Value) { Object.SetStringField(Field.Key, Value.ToString()); }
+		void operator()(const FCanvasField& Field, const FString& Value) { Object.SetStringField(Field.Key, Value); }
+		void operator()(const FCanvasField& Field, float Value) { Object.SetNumberField(Field.Key, Value); }
+		void operator()(const FCanvasField& Field, int32 Value) { Object.SetNumberField(Field.Key, Value); }
+		void operator()(const FCanvasField& Field, const FVector2D& Value) { Object.SetArrayField(Field.Key, MakeArray({ Value.X, Value.Y })); }
+		void operator()(const FCanvasField& Field, const FLinearColor& Value) { Object.SetArrayField(Field.Key, MakeArray({ Value.R, Value.G, Value.B, Value.A })); }
+	};
+
+	/** Reads the fields present in the item object, the others keep their defaults */
+	struct FItemReader
+	{
+		const FJsonObject& Object;
+
+		void operator()(const FCanvasField& Field, FName& Value)
+		{
+			FString String;
+			if (Object.TryGetStringField(Field.Key, String))
+			{
+				Value = FName(*String);
+			}
+		}
+
+		void operator()(const FCanvasField& Field, FString& Value) { Object.TryGetStringField(Field.Key, Value); }
+
+		void operator()(const FCanvasField& Field, float& Value)
+		{
+			double Number;
+			if (Object.TryGetNumberField(Field.Key, Number))
+			{
+				Value = static_cast<float>(Number);
+			}
+		}
+
+		void operator()(const FCanvasField& Field, int32& Value) { Object.TryGetNumberField(Field.Key, Value); }
+
+		void operator()(const FCanvasField& Field, FVector2D& Value)
+		{
+			const TArray<TSharedPtr<FJsonValue>>* Array;
+			if (Object.TryGetArrayField(Field.Key, Array) && Array->Num() == 2)
+			{
+				Value = FVector2D((*Array)[0]->AsNumber(), (*Array)[1]->AsNumber());
+			}
+		}
+
+		void operator()(const FCanvasField& Field, FLinearColor& Value)
+		{
+			const TArray<TSharedPtr<FJsonValue>>* Array;
+			if (Object.TryGetArrayField(Field.Key, Array) && Array->Num() == 4)
+			{
+				Value = FLinearColor((*Array)[0]->AsNumber(), (*Array)[1]->AsNumber(), (*Array)[2]->AsNumber(), (*Array)[3]->AsNumber());
+			}
+		}
+	};
+}
+
+FString FCanvasSceneSerializer::WriteJson(const FCanvasSceneData& Data)
+{
+	using namespace CanvasSceneJson;
+
+	TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+	Root->SetNumberField(TEXT("version"), JsonVersion);
+	FCanvasPrimitives::ForEach([&Data, &Root](auto Primitive)
+	{
+		TArray<TSharedPtr<FJsonValue>> Items;
+		for (const auto& Item : Data.*decltype(Primitive)::Items)
+		{
+			TSharedRef<FJsonObject> Object = MakeShared<FJsonObject>();
+			decltype(Primitive)::VisitFields(Item, FItemWriter{ *Object });
+			Items.Add(MakeShared<FJsonValueObject>(Object));
+		}
+		Root->SetArrayField(decltype(Primitive)::Key, Items);
+	});
+
+	FString Json;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+	FJsonSerializer::Serialize(Root, Writer);
+	return Json;
+}
+
+bool FCanvasSceneSerializer::ReadJson(const FString& Json, FCanvasSceneData& OutData)
+{
+	using namespace CanvasSceneJson;
+
+	TSharedPtr<FJsonObject> Root;
+	if (!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Json), Root) || !Root.IsValid())
+	{
+		UE_LOG(LogCustomWindow, Warning, TEXT("Scene JSON could not be parsed"));
+		return false;
+	}
+
+	int32 Version = 0;
+	if (!Root->TryGetNumberField(TEXT("version"), Version) || Version <= 0 || Version > JsonVersion)
+	{
+		UE_LOG(LogCustomWindow, Warning, TEXT("Scene JSON has a missing or unsupported version %d"), Version);
+		return false;
+	}
+
+	int32 NumSkipped = 0;
+	FCanvasPrimitives::ForEach([&Root, &OutData, &NumSkipped](auto Primitive)
+	{
+		const TArray<TSharedPtr<FJsonValue>>* Values;
+		if (Root->TryGetArrayField(decltype(Primitive)::Key, Values))
+		{
+			auto& Items = OutData.*decltype(Primitive)::Items;
+			for (const TSharedPtr<FJsonValue>& Value : *Values)
+			{
+				const TSharedPtr<FJsonObject>* Object;
+				if (Value.IsValid() && Value->TryGetObject(Object) && Object->IsValid())
+				{
+					decltype(Primitive)::VisitFields(Items.AddDefaulted_GetRef(), FItemReader{ **Object });
+				}
+				else
+				{
+					++NumSkipped;
+				}
+			}
+		}
+	});
+
+	if (NumSkipped > 0)
+	{
+		UE_LOG(LogCustomWindow, Warning, TEXT("Skipped %d scene JSON items that are not objects"), NumSkipped);
+	}
+	return true;
+}
+
+bool FCanvasSceneSerializer::SaveJson(const FCanvasSceneData& Data, const FString& Filename)
+{
+	if (!FFileHelper::SaveStringToFile(WriteJson(Data), *Filename, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM))
+	{
+		UE_LOG(LogCustomWindow, Warning, TEXT("Failed to write scene file %s"), *Filename);
+		return false;
+	}
+	return true;
+}
+
+bool FCanvasSceneSerializer::LoadJson(const FString& Filename, FCanvasSceneData& OutData)
+{
+	FString Json;
+	if (!FFileHelper::LoadFileToString(Json, *Filename))
+	{
+		UE_LOG(LogCustomWindow, Warning, TEXT("Failed to read scene file %s"), *Filename);
+		return false;
+	}
+	return ReadJson(Json, OutData);
+}
+
+bool FCanvasSceneSerializer::Save(const FCanvasSceneData& Data, const FString& Filename)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FCanvasSceneSerializer::Save);
+	return FPaths::GetExtension(Filename).Equals(TEXT("json"), ESearchCase::IgnoreCase) ? SaveJson(Data, Filename) : SaveBinary(Data, Filename);
+}
+
+bool FCanvasSceneSerializer::Load(const FString& Filename, FCanvasSceneData& OutData)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FCanvasSceneSerializer::Load);
+	return FPaths::GetExtension(Filename).Equals(TEXT("json"), ESearchCase::IgnoreCase) ? LoadJson(Filename, OutData) : LoadBinary(Filename, OutData);
+}
@@ -0,0 +1,109 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CanvasSpatialGrid.h"
+
+FCanvasSpatialGrid::FCanvasSpatialGrid(float InCellSize)
+	: CellSize(FMath::Max(InCellSize, 1.f))
+{
+}
+
+void FCanvasSpatialGrid::Update(int32 Id, const FBox2D& Bounds)
+{
+	if (!Entries.IsValidIndex(Id))
+	{
+		Entries.SetNum(Id + 1);
+	}
+
+	FEntry& Entry = Entries[Id];
+	const FIntRect CellRange = GetCellRange(Bounds);
+	const bool bOversized = GetNumCells(CellRange) > MaxCellsPerItem;
+	if (Entry.bIndexed && Entry.bOversized == bOversized && (bOversized || Entry.CellRange == CellRange))
+	{
+		Entry.Bounds = Bounds;
+		return;
+	}
+
+	Unlink(Id);
+	Entry.Bounds = Bounds;
+	Entry.CellRange = CellRange;
+	Entry.bIndexed = true;
+	Entry.bOversized = bOversized;
+
+	if (bOversized)
+	{
+		Oversized.Add(Id);
+		return;
+	}
+
+	for (int32 Y = CellRange.Min.Y; Y <= CellRange.Max.Y; ++Y)
+	{
+		for (int32 X = CellRange.Min.X; X <= CellRange.Max.X; ++X)
+		{
+			Cells.FindOrAdd(FIntPoint(X, Y)).Add(Id);
+		}
+	}
+}
+
+void FCanvasSpatialGrid::Remove(int32 Id)
+{
+	if (Contains(Id))
+	{
+		Unlink(Id);
+		Entries[Id].bIndexed = false;
+	}
+}
+
+void FCanvasSpatialGrid::Reset()
+{
+	Cells.Reset();
+	Oversized.Reset();
+	Entries.Reset();
+	QueryStamp = 0;
+}
+
+FIntRect FCanvasSpatialGrid::GetCellRange(const FBox2D& Bounds) const
+{
+	// Non-finite bounds span every cell, which makes them oversized
+	if (Bounds.Min.ContainsNaN() || Bounds.Max.ContainsNaN())
+	{
+		return FIntRect(-MaxCellCoord, -MaxCellCoord, MaxCellCoord, MaxCellCoord);
+	}
+
+	// Clamped in double precision, converting coordinates past the int32 range is undefined
+	auto ToCell = [this](double Coord)
+	{
+		return static_cast<int32>(FMath::Clamp(FMath::FloorToDouble(Coord / CellSize), static_cast<double>(-MaxCellCoord), static_cast<double>(MaxCellCoord)));
+	};
+	return FIntRect(ToCell(Bounds.Min.X), ToCell(Bounds.Min.Y), ToCell(Bounds.Max.X), ToCell(Bounds.Max.Y));
+}
+
+void FCanvasSpatialGrid::Unlink(int32 Id)
+{
+	const FEntry& Entry = Entries[Id];
+	if (!Entry.bIndexed)
+	{
+		return;
+	}
+
+	if (Entry.bOversized)
+	{
+		Oversized.RemoveSingleSwap(Id, false);
+		return;
+	}
+
+	for (int32 Y = Entry.CellRange.Min.Y; Y <= Entry.CellRange.Max.Y; ++Y)
+	{
+		for (int32 X = Entry.CellRange.Min.X; X <= Entry.CellRange.Max.X; ++X)
+		{
+			const FIntPoint CellKey(X, Y);
+			if (TArray<int32>* Cell = Cells.Find(CellKey))
+			{
+				Cell->RemoveSingleSwap(Id, false);
+				if (Cell->Num() == 0)
+				{
+					Cells.Remove(CellKey);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,365 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CanvasTextureAtlas.h"
+
+#include "CanvasItem.h"
+#include "CanvasTypes.h"
+#include "CustomWindowStats.h"
+#include "Engine/Texture2D.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "HAL/IConsoleManager.h"
+#include "TextureResource.h"
+#include "UObject/Package.h"
+
+static TAutoConsoleVariable<bool> CVarCustomWindowTextureAtlas(
+	TEXT("CustomWindow.TextureAtlas"),
+	false,
+	TEXT("Pack small tile textures into shared atlas pages so tiles with different textures are drawn in one batch, read when tiles are added"));
+
+static TAutoConsoleVariable<int32> CVarCustomWindowAtlasPageSize(
+	TEXT("CustomWindow.AtlasPageSize"),
+	1024,
+	TEXT("Width and height of new atlas pages in pixels"));
+
+static TAutoConsoleVariable<int32> CVarCustomWindowAtlasMaxTextureSize(
+	TEXT("CustomWindow.AtlasMaxTextureSize"),
+	128,
+	TEXT("Textures wider or taller than this are drawn from their own texture instead of being packed"));
+
+static TAutoConsoleVariable<int32> CVarCustomWindowAtlasBudget(
+	TEXT("CustomWindow.AtlasBudgetMB"),
+	32,
+	TEXT("Memory cap of the atlas pages, textures that don't fit in the existing pages are rejected above it"));
+
+/** Border around every packed texture, filled with its edge pixels so bilinear filtering doesn't pick up neighbours */
+static constexpr int32 AtlasPadding = 1;
+
+bool FCanvasTextureAtlas::Acquire(FName Path, UTexture2D* Texture, FCanvasAtlasRegion& OutRegion)
+{
+	if (!CVarCustomWindowTextureAtlas.GetValueOnGameThread() || Path.IsNone())
+	{
+		return false;
+	}
+
+	if (FEntry* Entry = Entries.Find(Path))
+	{
+		++Entry->RefCount;
+		OutRegion = Entry->Region;
+		return true;
+	}
+
+	if (!Texture)
+	{
+		return false;
+	}
+
+	const FIntPoint TextureSize(Texture->GetSizeX(), Texture->GetSizeY());
+	const int32 MaxTextureSize = CVarCustomWindowAtlasMaxTextureSize.GetValueOnGameThread();
+	FEntry Entry;
+	if (TextureSize.X <= 0 || TextureSize.Y <= 0 || TextureSize.X > MaxTextureSize || TextureSize.Y > MaxTextureSize
+		|| !Allocate(TextureSize + FIntPoint(2 * AtlasPadding, 2 * AtlasPadding), Entry))
+	{
+		++Stats.NumRejected;
+		return false;
+	}
+
+	const FPage& Page = Pages[Entry.PageIndex];
+	const FIntPoint Inner = Entry.Rect.Min + FIntPoint(AtlasPadding, AtlasPadding);
+	Entry.Region.Page = Page.Texture;
+	Entry.Region.UVMin = FVector2D(Inner) / Page.Size;
+	Entry.Region.UVMax = FVector2D(Inner + TextureSize) / Page.Size;
+	Entry.PendingSource = Texture;
+	Entry.RefCount = 1;
+	OutRegion = Entry.Region;
+
+	Entries.Add(Path, MoveTemp(Entry));
+	PendingUploads.Add(Path);
+	UpdateStats();
+	return true;
+}
+
+void FCanvasTextureAtlas::Release(FName Path)
+{
+	FEntry* Entry = Entries.Find(Path);
+	if (!Entry || !ensure(Entry->RefCount > 0) || --Entry->RefCount > 0)
+	{
+		return;
+	}
+
+	Free(*Entry);
+	Entries.Remove(Path);
+	PendingUploads.RemoveSwap(Path, false);
+	UpdateStats();
+}
+
+bool FCanvasTextureAtlas::FlushUploads()
+{
+	if (PendingUploads.Num() == 0)
+	{
+		return false;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_CustomWindow_AtlasUpload);
+	const int32 NumUploadsBefore = Stats.NumUploads;
+	PendingUploads.Sort([this](FName A, FName B) { return Entries[A].PageIndex < Entries[B].PageIndex; });
+
+	// Textures without a resource yet are retried on the next flush
+	TArray<FName> NotReady;
+	for (int32 RunStart = 0; RunStart < PendingUploads.Num();)
+	{
+		const int32 PageIndex = Entries[PendingUploads[RunStart]].PageIndex;
+		FCanvas Canvas(Pages[PageIndex].Texture->GameThread_GetRenderTargetResource(), nullptr, FGameTime::GetTimeSinceAppStart(), GMaxRHIFeatureLevel);
+
+		int32 RunEnd = RunStart;
+		for (; RunEnd < PendingUploads.Num() && Entries[PendingUploads[RunEnd]].PageIndex == PageIndex; ++RunEnd)
+		{
+			FEntry& Entry = Entries[PendingUploads[RunEnd]];
+			const FTexture* Source = Entry.PendingSource ? Entry.PendingSource->GetResource() : nullptr;
+			if (!Source)
+			{
+				NotReady.Add(PendingUploads[RunEnd]);
+				continue;
+			}
+
+			// Stretched over the padding first, then exactly over the inner rectangle
+			FCanvasTileItem TileItem(FVector2D(Entry.Rect.Min), Source, FVector2D(Entry.Rect.Size()), FLinearColor::White);
+			TileItem.BlendMode = ESimpleElementBlendMode::SE_BLEND_Opaque;
+			Canvas.DrawItem(TileItem);
+			TileItem.Position = FVector2D(Entry.Rect.Min + FIntPoint(AtlasPadding, AtlasPadding));
+			TileItem.Size = FVector2D(Entry.Rect.Size() - FIntPoint(2 * AtlasPadding, 2 * AtlasPadding));
+			Canvas.DrawItem(TileItem);
+
+			Entry.PendingSource = nullptr;
+			++Stats.NumUploads;
+		}
+
+		Canvas.Flush_GameThread();
+		RunStart = RunEnd;
+	}
+	PendingUploads = MoveTemp(NotReady);
+	return Stats.NumUploads != NumUploadsBefore;
+}
+
+float FCanvasTextureAtlas::GetPageOccupancy(int32 PageIndex) const
+{
+	if (!Pages.IsValidIndex(PageIndex) || !Pages[PageIndex].Texture)
+	{
+		return 0.f;
+	}
+	const FPage& Page = Pages[PageIndex];
+	return static_cast<float>(Page.UsedPixels) / (static_cast<int64>(Page.Size) * Page.Size);
+}
+
+void FCanvasTextureAtlas::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	for (FPage& Page : Pages)
+	{
+		Collector.AddReferencedObject(Page.Texture);
+	}
+	for (auto& Entry : Entries)
+	{
+		Collector.AddReferencedObject(Entry.Value.PendingSource);
+	}
+}
+
+bool FCanvasTextureAtlas::Allocate(const FIntPoint& Size, FEntry& OutEntry)
+{
+	for (int32 PageIndex = 0; PageIndex < Pages.Num(); ++PageIndex)
+	{
+		if (Pages[PageIndex].Texture && AllocateInPage(PageIndex, Size, OutEntry))
+		{
+			return true;
+		}
+	}
+
+	const int32 PageSize = FMath::Clamp(CVarCustomWindowAtlasPageSize.GetValueOnGameThread(), 256, 4096);
+	const int64 PageBytes = static_cast<int64>(PageSize) * PageSize * 4;
+	const int64 Budget = static_cast<int64>(CVarCustomWindowAtlasBudget.GetValueOnGameThread()) * 1024 * 1024;
+	if (Size.X > PageSize || Size.Y > PageSize || Stats.ResidentBytes + PageBytes > Budget)
+	{
+		return false;
+	}
+	return AllocateInPage(AddPage(), Size, OutEntry);
+}
+
+bool FCanvasTextureAtlas::AllocateInPage(int32 PageIndex, const FIntPoint& Size, FEntry& OutEntry)
+{
+	FPage& Page = Pages[PageIndex];
+	if (Size.X > Page.Size || Size.Y > Page.Size)
+	{
+		return false;
+	}
+
+	// Best fitting shelf by height, taking a released span before the untouched end of the shelf
+	int32 BestShelf = INDEX_NONE;
+	int32 BestSpan = INDEX_NONE;
+	int32 BestWaste = MAX_int32;
+	for (int32 ShelfIndex = 0; ShelfIndex < Page.Shelves.Num(); ++ShelfIndex)
+	{
+		const FShelf& Shelf = Page.Shelves[ShelfIndex];
+		const int32 Waste = Shelf.Height - Size.Y;
+		if (Waste < 0 || Waste >= BestWaste)
+		{
+			continue;
+		}
+
+		const int32 SpanIndex = Shelf.FreeSpans.IndexOfByPredicate([&Size](const FIntPoint& Span) { return Span.Y >= Size.X; });
+		if (SpanIndex != INDEX_NONE || Shelf.CursorX + Size.X <= Page.Size)
+		{
+			BestShelf = ShelfIndex;
+			BestSpan = SpanIndex;
+			BestWaste = Waste;
+		}
+	}
+
+	// Rather open a new shelf than waste more than the texture height on an existing one
+	const int32 ShelfHeight = FMath::Min(Align(Size.Y, 4), Page.Size);
+	const bool bCanOpenShelf = Page.NextShelfY + ShelfHeight <= Page.Size;
+	if (BestShelf == INDEX_NONE || (BestWaste > Size.Y && bCanOpenShelf))
+	{
+		if (!bCanOpenShelf)
+		{
+			return false;
+		}
+		FShelf& Shelf = Page.Shelves.AddDefaulted_GetRef();
+		Shelf.Y = Page.NextShelfY;
+		Shelf.Height = ShelfHeight;
+		Page.NextShelfY += ShelfHeight;
+		BestShelf = Page.Shelves.Num() - 1;
+		BestSpan = INDEX_NONE;
+	}
+
+	FShelf& Shelf = Page.Shelves[BestShelf];
+	int32 X = Shelf.CursorX;
+	if (BestSpan != INDEX_NONE)
+	{
+		FIntPoint& Span = Shelf.FreeSpans[BestSpan];
+		X = Span.X;
+		Span.X += Size.X;
+		Span.Y -= Size.X;
+		if (Span.Y == 0)
+		{
+			Shelf.FreeSpans.RemoveAtSwap(BestSpan, 1, false);
+		}
+	}
+	else
+	{
+		Shelf.CursorX += Size.X;
+	}
+
+	++Shelf.NumEntries;
+	++Page.NumEntries;
+	Page.UsedPixels += static_cast<int64>(Size.X) * Size.Y;
+	OutEntry.PageIndex = PageIndex;
+	OutEntry.ShelfIndex = BestShelf;
+	OutEntry.Rect = FIntRect(FIntPoint(X, Shelf.Y), FIntPoint(X, Shelf.Y) + Size);
+	return true;
+}
+
+void FCanvasTextureAtlas::Free(const FEntry& Entry)
+{
+	FPage& Page = Pages[Entry.PageIndex];
+	FShelf& Shelf = Page.Shelves[Entry.ShelfIndex];
+	Page.UsedPixels -= Entry.Rect.Area();
+	--Page.NumEntries;
+
+	if (--Shelf.NumEntries == 0)
+	{
+		Shelf.FreeSpans.Reset();
+		Shelf.CursorX = 0;
+	}
+	else
+	{
+		// Merge with the released neighbours, there is at most one on each side
+		int32 X = Entry.Rect.Min.X;
+		int32 Width = Entry.Rect.Width();
+		for (int32 SpanIndex = Shelf.FreeSpans.Num() - 1; SpanIndex >= 0; --SpanIndex)
+		{
+			const FIntPoint Span = Shelf.FreeSpans[SpanIndex];
+			if (Span.X + Span.Y == X || X + Width == Span.X)
+			{
+				X = FMath::Min(X, Span.X);
+				Width += Span.Y;
+				Shelf.FreeSpans.RemoveAtSwap(SpanIndex, 1, false);
+			}
+		}
+
+		if (X + Width == Shelf.CursorX)
+		{
+			Shelf.CursorX = X;
+		}
+		else
+		{
+			Shelf.FreeSpans.Emplace(X, Width);
+		}
+	}
+
+	// Give the space of empty shelves at the bottom back to the page, the others keep their index for their entries
+	while (Page.Shelves.Num() > 0 && Page.Shelves.Last().NumEntries == 0)
+	{
+		Page.NextShelfY = Page.Shelves.Last().Y;
+		Page.Shelves.Pop(false);
+	}
+
+	if (Page.NumEntries == 0)
+	{
+		const int32 NumLivePages = Pages.FilterByPredicate([](const FPage& Other) { return Other.Texture != nullptr; }).Num();
+		if (NumLivePages > 1)
+		{
+			// Keep one empty page around so a scene cycling through its textures doesn't create pages over and over
+			ReleasePage(Entry.PageIndex);
+		}
+	}
+}
+
+int32 FCanvasTextureAtlas::AddPage()
+{
+	const int32 PageSize = FMath::Clamp(CVarCustomWindowAtlasPageSize.GetValueOnGameThread(), 256, 4096);
+	UTextureRenderTarget2D* Texture = NewObject<UTextureRenderTarget2D>(GetTransientPackage(), NAME_None, RF_Transient);
+	Texture->RenderTargetFormat = RTF_RGBA8_SRGB;
+	Texture->ClearColor = FLinearColor::Transparent;
+	Texture->bAutoGenerateMips = false;
+	Texture->InitAutoFormat(PageSize, PageSize);
+	Texture->UpdateResourceImmediate(true);
+
+	int32 PageIndex = Pages.IndexOfByPredicate([](const FPage& Page) { return Page.Texture == nullptr; });
+	if (PageIndex == INDEX_NONE)
+	{
+		PageIndex = Pages.AddDefaulted();
+	}
+
+	FPage& Page = Pages[PageIndex];
+	Page = FPage();
+	Page.Texture = Texture;
+	Page.Size = PageSize;
+	UpdateStats();
+	return PageIndex;
+}
+
+void FCanvasTextureAtlas::ReleasePage(int32 PageIndex)
+{
+	Pages[PageIndex] = FPage();
+	UpdateStats();
+}
+
+void FCanvasTextureAtlas::UpdateStats()
+{
+	Stats.NumPages = 0;
+	Stats.NumEntries = Entries.Num();
+	Stats.UsedPixels = 0;
+	Stats.PagePixels = 0;
+	for (const FPage& Page : Pages)
+	{
+		if (Page.Texture)
+		{
+			++Stats.NumPages;
+			Stats.UsedPixels += Page.UsedPixels;
+			Stats.PagePixels += static_cast<int64>(Page.Size) * Page.Size;
+		}
+	}
+	Stats.ResidentBytes = Stats.PagePixels * 4;
+
+	SET_DWORD_STAT(STAT_CustomWindow_AtlasPages, Stats.NumPages);
+	SET_DWORD_STAT(STAT_CustomWindow_AtlasEntries, Stats.NumEntries);
+	SET_MEMORY_STAT(STAT_CustomWindow_AtlasMemory, Stats.ResidentBytes);
+}
@@ -0,0 +1,207 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CustomTextureCache.h"
+
+#include "CustomWindow.h"
+#include "CustomWindowStats.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "Engine/Texture2D.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<int32> CVarCustomWindowTextureCacheBudget(
+	TEXT("CustomWindow.TextureCacheBudgetMB"),
+	256,
+	TEXT("Memory budget of the CustomWindow texture cache. Unreferenced textures are evicted least recently used first above it"));
+
+FCustomTextureCache::FCustomTextureCache()
+{
+}
+
+FCustomTextureCache::~FCustomTextureCache()
+{
+	for (auto& Entry : Entries)
+	{
+		if (Entry.Value.Handle.IsValid())
+		{
+			Entry.Value.Handle->CancelHandle();
+		}
+	}
+	Entries.Empty();
+}
+
+UTexture2D* FCustomTextureCache::Acquire(FName Path)
+{
+	if (Path.IsNone())
+	{
+		return nullptr;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_CustomWindow_TextureAcquire);
+
+	if (FEntry* Entry = Entries.Find(Path))
+	{
+		++Entry->RefCount;
+		Entry->LastUsed = ++UseClock;
+		if (Entry->Texture)
+		{
+			++Stats.Hits;
+			INC_DWORD_STAT(STAT_CustomWindow_CacheHits);
+		}
+		else
+		{
+			++Stats.Misses;
+			INC_DWORD_STAT(STAT_CustomWindow_CacheMisses);
+			Stats.NumCoalesced += Entry->Handle.IsValid() ? 1 : 0;
+		}
+		return Entry->Texture;
+	}
+
+	++Stats.Misses;
+	INC_DWORD_STAT(STAT_CustomWindow_CacheMisses);
+	FEntry& Entry = Entries.Add(Path);
+	Entry.RefCount = 1;
+	Entry.LastUsed = ++UseClock;
+
+	const FSoftObjectPath ObjectPath(Path.ToString());
+	if (UTexture2D* Resident = Cast<UTexture2D>(ObjectPath.ResolveObject()))
+	{
+		SetResident(Entry, Resident);
+		Trim();
+		return Resident;
+	}
+
+	++Stats.NumRequested;
+	Entry.RequestTime = FPlatformTime::Seconds();
+	Entry.Handle = UAssetManager::GetStreamableManager().RequestAsyncLoad(ObjectPath,
+		FStreamableDelegate::CreateRaw(this, &FCustomTextureCache::OnLoaded, Path));
+	return nullptr;
+}
+
+void FCustomTextureCache::Release(FName Path)
+{
+	FEntry* Entry = Entries.Find(Path);
+	if (!Entry || !ensure(Entry->RefCount > 0))
+	{
+		return;
+	}
+
+	if (--Entry->RefCount == 0 && !Entry->Texture)
+	{
+		// Nothing resident to keep around, drop failed entries and abandon loads nobody waits for anymore
+		Evict(Path);
+		return;
+	}
+	Trim();
+}
+
+UTexture2D* FCustomTextureCache::Find(FName Path) const
+{
+	const FEntry* Entry = Entries.Find(Path);
+	return Entry ? Entry->Texture.Get() : nullptr;
+}
+
+void FCustomTextureCache::Trim()
+{
+	const int64 Budget = GetBudget();
+	if (Stats.ResidentBytes <= Budget)
+	{
+		return;
+	}
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(FCustomTextureCache::Trim);
+	TArray<TPair<uint64, FName>> Candidates;
+	for (const auto& Entry : Entries)
+	{
+		if (Entry.Value.RefCount == 0 && Entry.Value.Texture)
+		{
+			Candidates.Emplace(Entry.Value.LastUsed, Entry.Key);
+		}
+	}
+	Candidates.Sort([](const TPair<uint64, FName>& A, const TPair<uint64, FName>& B) { return A.Key < B.Key; });
+
+	for (const TPair<uint64, FName>& Candidate : Candidates)
+	{
+		if (Stats.ResidentBytes <= Budget)
+		{
+			break;
+		}
+		Evict(Candidate.Value);
+		++Stats.Evictions;
+	}
+}
+
+void FCustomTextureCache::SetBudget(int64 InBudgetBytes)
+{
+	BudgetBytes = InBudgetBytes;
+	Trim();
+}
+
+int64 FCustomTextureCache::GetBudget() const
+{
+	return BudgetBytes >= 0 ? BudgetBytes : static_cast<int64>(CVarCustomWindowTextureCacheBudget.GetValueOnGameThread()) * 1024 * 1024;
+}
+
+void FCustomTextureCache::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	for (auto& Entry : Entries)
+	{
+		Collector.AddReferencedObject(Entry.Value.Texture);
+	}
+}
+
+void FCustomTextureCache::OnLoaded(FName Path)
+{
+	FEntry* Entry = Entries.Find(Path);
+	if (!Entry || !Entry->Handle.IsValid())
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_CustomWindow_TextureLoaded);
+	const double Latency = FPlatformTime::Seconds() - Entry->RequestTime;
+	UTexture2D* Texture = Cast<UTexture2D>(Entry->Handle->GetLoadedAsset());
+	Entry->Handle->ReleaseHandle();
+	Entry->Handle.Reset();
+
+	if (!Texture)
+	{
+		++Stats.NumFailed;
+		Entry->bFailed = true;
+		UE_LOG(LogCustomWindow, Warning, TEXT("Failed to load texture %s, keeping placeholder"), *Path.ToString());
+		return;
+	}
+
+	++Stats.NumLoaded;
+	INC_DWORD_STAT(STAT_CustomWindow_TexturesLoaded);
+	Stats.LastLatency = Latency;
+	Stats.MaxLatency = FMath::Max(Stats.MaxLatency, Latency);
+	Stats.TotalLatency += Latency;
+	UE_LOG(LogCustomWindow, Verbose, TEXT("Loaded texture %s in %.2f ms"), *Path.ToString(), Latency * 1000.0);
+
+	SetResident(*Entry, Texture);
+	OnTextureReady.Broadcast(Path, Texture);
+	Trim();
+}
+
+void FCustomTextureCache::SetResident(FEntry& Entry, UTexture2D* Texture)
+{
+	Entry.Texture = Texture;
+	Entry.ResourceSize = Texture->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal);
+	Stats.ResidentBytes += Entry.ResourceSize;
+	SET_MEMORY_STAT(STAT_CustomWindow_TextureMemory, Stats.ResidentBytes);
+}
+
+void FCustomTextureCache::Evict(FName Path)
+{
+	FEntry Entry;
+	if (Entries.RemoveAndCopyValue(Path, Entry))
+	{
+		if (Entry.Handle.IsValid())
+		{
+			Entry.Handle->CancelHandle();
+		}
+		Stats.ResidentBytes -= Entry.ResourceSize;
+		SET_MEMORY_STAT(STAT_CustomWindow_TextureMemory, Stats.ResidentBytes);
+	}
+}
@@ -2,13 +2,23 @@
 
 #include "CustomWindow.h"
 
+#include "Async/Async.h"
 #include "AssetRegistry/AssetData.h"
+#include "CanvasAutosave.h"
+#include "CanvasCapture.h"
 #include "CanvasItem.h"
+#include "CanvasSceneSerializer.h"
 #include "CanvasTypes.h"
+#include "CustomWindowStats.h"
 #include "Engine/Font.h"
+#include "Engine/Texture2D.h"
 #include "Fonts/SlateFontInfo.h"
 #include "Framework/Docking/TabManager.h"
+#include "HAL/IConsoleManager.h"
+#include "InputCoreTypes.h"
+#include "Misc/Paths.h"
 #include "PropertyCustomizationHelpers.h"
+#include "RenderUtils.h"
 #include "Slate/SceneViewport.h"
 #include "Widgets/Colors/SColorSpectrum.h"
 #include "Widgets/Docking/SDockTab.h"
@@ -24,18 +34,111 @@
 
 #define LOCTEXT_NAMESPACE "FCustomWindowModule"
 
+DEFINE_LOG_CATEGORY(LogCustomWindow);
+
+DEFINE_STAT(STAT_CustomWindow_Draw);
+DEFINE_STAT(STAT_CustomWindow_BuildSnapshot);
+DEFINE_STAT(STAT_CustomWindow_ApplyCommands);
+DEFINE_STAT(STAT_CustomWindow_AddItems);
+DEFINE_STAT(STAT_CustomWindow_Animate);
+DEFINE_STAT(STAT_CustomWindow_TextureAcquire);
+DEFINE_STAT(STAT_CustomWindow_TextureLoaded);
+DEFINE_STAT(STAT_CustomWindow_AtlasUpload);
+DEFINE_STAT(STAT_CustomWindow_Capture);
+DEFINE_STAT(STAT_CustomWindow_PlotDecimate);
+DEFINE_STAT(STAT_CustomWindow_PixelUpload);
+DEFINE_STAT(STAT_CustomWindow_CreateTab);
+DEFINE_STAT(STAT_CustomWindow_CreateSettings);
+DEFINE_STAT(STAT_CustomWindow_Autosave);
+DEFINE_STAT(STAT_CustomWindow_ItemsSubmitted);
+DEFINE_STAT(STAT_CustomWindow_Batches);
+DEFINE_STAT(STAT_CustomWindow_CommandsApplied);
+DEFINE_STAT(STAT_CustomWindow_TexturesLoaded);
+DEFINE_STAT(STAT_CustomWindow_CacheHits);
+DEFINE_STAT(STAT_CustomWindow_CacheMisses);
+DEFINE_STAT(STAT_CustomWindow_PixelsUploaded);
+DEFINE_STAT(STAT_CustomWindow_SceneItems);
+DEFINE_STAT(STAT_CustomWindow_VisibleItems);
+DEFINE_STAT(STAT_CustomWindow_CulledItems);
+DEFINE_STAT(STAT_CustomWindow_AtlasPages);
+DEFINE_STAT(STAT_CustomWindow_AtlasEntries);
+DEFINE_STAT(STAT_CustomWindow_PanelsBuilt);
+DEFINE_STAT(STAT_CustomWindow_PanelsReused);
+DEFINE_STAT(STAT_CustomWindow_TextureMemory);
+DEFINE_STAT(STAT_CustomWindow_AtlasMemory);
+
 static const FName WindowDockTab("WindowDockTab");
 
-FCustomWindowModule::FCustomWindowModule() 
-: ActiveColor(FColor(ACTIVE_COLOR)), DisabledColor(FColor(DISABLED_COLOR)), BoxData(FBoxData())
-{
-}
+/** Widest decimation of a plot, a plot zoomed in further draws wider columns */
+static constexpr int32 MaxPlotColumns = 8192;
+
+/** Mouse travel in pixels under which a left click picks an item instead of starting a box selection */
+static constexpr int32 SelectionDragThreshold = 4;
+
+static TAutoConsoleVariable<bool> CVarCustomWindowBatchedDraw(
+	TEXT("CustomWindow.BatchedDraw"),
+	true,
+	TEXT("Submit boxes as one line batch and tiles as one triangle batch per texture instead of one DrawItem per item"));
+
+static TAutoConsoleVariable<int32> CVarCustomWindowCommandQueueCapacity(
+	TEXT("CustomWindow.CommandQueueCapacity"),
+	16384,
+	TEXT("Number of commands the thread safe command queue holds before rejecting new ones, read when a tab opens"));
+
+static TAutoConsoleVariable<bool> CVarCustomWindowAutosave(
+	TEXT("CustomWindow.Autosave"),
+	true,
+	TEXT("Keep the scene of the CustomWindow nomad tab saved in Saved/CustomWindow and restore it when the tab opens"));
+
+static TAutoConsoleVariable<float> CVarCustomWindowAutosaveInterval(
+	TEXT("CustomWindow.AutosaveInterval"),
+	2.f,
+	TEXT("Seconds between two writes of the autosave delta log, 0 only writes when the tab closes"));
+
+static TAutoConsoleVariable<int32> CVarCustomWindowUndoHistoryMB(
+	TEXT("CustomWindow.UndoHistoryMB"),
+	64,
+	TEXT("Megabytes of deltas the undo journal of a scene keeps before dropping the oldest edits, read when a tab opens"));
+
+static TAutoConsoleVariable<bool> CVarCustomWindowShowStats(
+	TEXT("CustomWindow.ShowStats"),
+	false,
+	TEXT("Draw frame, scene, texture cache and command queue statistics over the CustomWindow viewport"));
 
 void FCustomWindowModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
 	FGlobalTabmanager::Get()->RegisterNomadTabSpawner(WindowDockTab, FOnSpawnTab::CreateRaw(this, &FCustomWindowModule::CreateWindow))
 		.SetGroup(WorkspaceMenu::GetMenuStructure().GetDeveloperToolsMiscCategory());
+
+	ConsoleCommands.Add(IConsoleManager::Get().RegisterConsoleCommand(
+		TEXT("CustomWindow.OpenTab"),
+		TEXT("Opens another CustomWindow tab with its own scene, or showing the scene of the focused tab: CustomWindow.OpenTab [Mirror]"),
+		FConsoleCommandWithArgsDelegate::CreateRaw(this, &FCustomWindowModule::OpenTabCommand)));
+	ConsoleCommands.Add(IConsoleManager::Get().RegisterConsoleCommand(
+		TEXT("CustomWindow.SaveScene"),
+		TEXT("Saves the CustomWindow scene to a file, JSON when the extension is .json and the binary format otherwise"),
+		FConsoleCommandWithArgsDelegate::CreateRaw(this, &FCustomWindowModule::SaveScene)));
+	ConsoleCommands.Add(IConsoleManager::Get().RegisterConsoleCommand(
+		TEXT("CustomWindow.LoadScene"),
+		TEXT("Replaces the CustomWindow scene with the content of a file saved by CustomWindow.SaveScene"),
+		FConsoleCommandWithArgsDelegate::CreateRaw(this, &FCustomWindowModule::LoadScene)));
+	ConsoleCommands.Add(IConsoleManager::Get().RegisterConsoleCommand(
+		TEXT("CustomWindow.CaptureScene"),
+		TEXT("Renders the CustomWindow scene offscreen and writes it as PNG: CustomWindow.CaptureScene <File> [Width] [Height]"),
+		FConsoleCommandWithArgsDelegate::CreateRaw(this, &FCustomWindowModule::CaptureScene)));
+	ConsoleCommands.Add(IConsoleManager::Get().RegisterConsoleCommand(
+		TEXT("CustomWindow.StressCommandQueue"),
+		TEXT("Feeds the command queue from worker threads: CustomWindow.StressCommandQueue [Producers] [CommandsPerProducer]"),
+		FConsoleCommandWithArgsDelegate::CreateRaw(this, &FCustomWindowModule::StressCommandQueue)));
+	ConsoleCommands.Add(IConsoleManager::Get().RegisterConsoleCommand(
+		TEXT("CustomWindow.Undo"),
+		TEXT("Undoes the last edits of the CustomWindow scene: CustomWindow.Undo [Steps]"),
+		FConsoleCommandWithArgsDelegate::CreateRaw(this, &FCustomWindowModule::Undo)));
+	ConsoleCommands.Add(IConsoleManager::Get().RegisterConsoleCommand(
+		TEXT("CustomWindow.Redo"),
+		TEXT("Redoes the last undone edits of the CustomWindow scene: CustomWindow.Redo [Steps]"),
+		FConsoleCommandWithArgsDelegate::CreateRaw(this, &FCustomWindowModule::Redo)));
 }
 
 void FCustomWindowModule::ShutdownModule()
@@ -43,18 +146,139 @@ void FCustomWindowModule::ShutdownModule()
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
 	FGlobalTabmanager::Get()->UnregisterNomadTabSpawner(WindowDockTab);
-	Settings.Empty();
-	delete ViewportClient;
+	for (IConsoleObject* Command : ConsoleCommands)
+	{
+		IConsoleManager::Get().UnregisterConsoleObject(Command);
+	}
+	ConsoleCommands.Empty();
+
+	// Tabs still open keep their clients alive through their viewports, they just stop calling back into the module
+	for (const TSharedRef<FCustomWindowTab>& Tab : Tabs)
+	{
+		if (TSharedPtr<SDockTab> DockTab = Tab->DockTab.Pin())
+		{
+			DockTab->SetOnTabClosed(SDockTab::FOnTabClosedCallback());
+			DockTab->SetOnTabActivated(SDockTab::FOnTabActivatedCallback());
+		}
+	}
+	Tabs.Empty();
+	ReleasedPanels = decltype(ReleasedPanels)();
+	TextureCache.Reset();
+	TextureAtlas.Reset();
+}
+
+FCustomViewportClient* FCustomWindowModule::GetActiveClient() const
+{
+	return Tabs.Num() > 0 ? &Tabs.Last()->GetSceneClient() : nullptr;
 }
 
 TSharedRef<SDockTab> FCustomWindowModule::CreateWindow(const FSpawnTabArgs& TabArgs)
 {
-	ViewportClient = new FCustomViewportClient();	
-	TSharedPtr<SCustomViewport> Viewport = SNew(SCustomViewport);
-	TSharedRef<FSceneViewport> Scene = MakeShared<FSceneViewport>(ViewportClient, Viewport);
+	return SpawnTab(ETabRole::NomadTab);
+}
+
+TSharedRef<SDockTab> FCustomWindowModule::SpawnTab(ETabRole Role, TSharedPtr<FCustomViewportClient> MirrorSource)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CustomWindow_CreateTab);
+	if (!TextureCache.IsValid())
+	{
+		TextureCache = MakeShared<FCustomTextureCache>();
+		TextureAtlas = MakeShared<FCanvasTextureAtlas>();
+	}
+
+	TSharedRef<FCustomViewportClient> Client = MakeShared<FCustomViewportClient>(TextureCache, TextureAtlas);
+	Client->SetMirrorSource(MirrorSource);
+	// Document tabs are scratch scenes, only the nomad tab comes back with its scene
+	if (Role == ETabRole::NomadTab && !MirrorSource.IsValid() && CVarCustomWindowAutosave.GetValueOnGameThread())
+	{
+		Client->EnableAutosave(FPaths::ProjectSavedDir() / TEXT("CustomWindow") / TEXT("Autosave"));
+	}
+	TSharedRef<FCustomWindowTab> Tab = MakeShared<FCustomWindowTab>(Client);
+	TSharedRef<SDockTab> DockTab = Tab->CreateDockTab(Role);
+	DockTab->SetOnTabClosed(SDockTab::FOnTabClosedCallback::CreateRaw(this, &FCustomWindowModule::OnTabClosed));
+	DockTab->SetOnTabActivated(SDockTab::FOnTabActivatedCallback::CreateRaw(this, &FCustomWindowModule::OnTabActivated));
+	Tabs.Add(Tab);
+	return DockTab;
+}
+
+void FCustomWindowModule::OpenTab(bool bMirror)
+{
+	// The nomad tab only exists once, it is the one the spawner brings back
+	if (Tabs.Num() == 0)
+	{
+		FGlobalTabmanager::Get()->TryInvokeTab(WindowDockTab);
+		return;
+	}
+
+	TSharedPtr<FCustomViewportClient> MirrorSource = bMirror ? Tabs.Last()->ViewportClient : nullptr;
+	FGlobalTabmanager::Get()->InsertNewDocumentTab(WindowDockTab, FTabManager::FLiveTabSearch(), SpawnTab(ETabRole::DocumentTab, MirrorSource));
+}
+
+void FCustomWindowModule::OnTabClosed(TSharedRef<SDockTab> ClosedTab)
+{
+	// The client goes with the viewport widget, or with the last mirror still showing its scene
+	const int32 Index = Tabs.IndexOfByPredicate([&ClosedTab](const TSharedRef<FCustomWindowTab>& Tab) { return Tab->DockTab.HasSameObject(&ClosedTab.Get()); });
+	if (Index != INDEX_NONE)
+	{
+		// Written now rather than when the client goes, the next nomad tab may restore the files before that
+		Tabs[Index]->ViewportClient->DisableAutosave();
+		Tabs[Index]->ReleasePanels();
+		Tabs.RemoveAt(Index);
+	}
+}
+
+void FCustomWindowModule::OnTabActivated(TSharedRef<SDockTab> ActivatedTab, ETabActivationCause Cause)
+{
+	const int32 Index = Tabs.IndexOfByPredicate([&ActivatedTab](const TSharedRef<FCustomWindowTab>& Tab) { return Tab->DockTab.HasSameObject(&ActivatedTab.Get()); });
+	if (Index != INDEX_NONE && Index != Tabs.Num() - 1)
+	{
+		TSharedRef<FCustomWindowTab> Tab = Tabs[Index];
+		Tabs.RemoveAt(Index);
+		Tabs.Add(Tab);
+	}
+}
+
+void FCustomWindowModule::OpenTabCommand(const TArray<FString>& Args)
+{
+	OpenTab(Args.Num() > 0 && Args[0].Equals(TEXT("Mirror"), ESearchCase::IgnoreCase));
+}
+
+FCustomWindowTab::FCustomWindowTab(TSharedRef<FCustomViewportClient> InViewportClient)
+: ActiveColor(FColor(ACTIVE_COLOR)), DisabledColor(FColor(DISABLED_COLOR)), ViewportClient(InViewportClient)
+{
+}
+
+FCustomWindowTab::~FCustomWindowTab()
+{
+	// Mirrors and the viewport widget may keep the client around
+	ViewportClient->OnSelectionChanged.RemoveAll(this);
+}
+
+FCustomViewportClient& FCustomWindowTab::GetSceneClient() const
+{
+	return ViewportClient->GetMirrorSource().IsValid() ? *ViewportClient->GetMirrorSource() : *ViewportClient;
+}
+
+FReply FCustomWindowTab::OpenTab()
+{
+	FCustomWindowModule::Get().OpenTab(false);
+	return FReply::Handled();
+}
+
+FReply FCustomWindowTab::OpenMirror()
+{
+	FCustomWindowModule::Get().OpenTab(true);
+	return FReply::Handled();
+}
+
+TSharedRef<SDockTab> FCustomWindowTab::CreateDockTab(ETabRole Role)
+{
+	Viewport = SNew(SCustomViewport);
+	TSharedRef<FSceneViewport> Scene = MakeShared<FSceneViewport>(ViewportClient.Get(), Viewport);
 	Viewport->SetViewportInterface(Scene);
-	Viewport->SetSceneViewport(Scene);
+	Viewport->SetSceneViewport(Scene, ViewportClient);
 	Viewport->SetCanTick(true);	
+	ViewportClient->OnSelectionChanged.AddRaw(this, &FCustomWindowTab::LoadSelection);
 
 	Init();
 
@@ -63,8 +287,21 @@ TSharedRef<SDockTab> FCustomWindowModule::CreateWindow(const FSpawnTabArgs& TabA
 	{
 		VBox->AddSlot().AttachWidget(Setting.Value.Key.ToSharedRef());
 	}
+	VBox->AddSlot().AutoHeight().Padding(0.f, 5.f)
+		[
+			SNew(SHorizontalBox)
+			+SHorizontalBox::Slot().FillWidth(0.5f).Padding(0.f, 0.f, 2.f, 0.f)
+			[
+				CreateButton(FText::FromString("NEW TAB"), &FCustomWindowTab::OpenTab)
+			]
+			+SHorizontalBox::Slot().FillWidth(0.5f).Padding(2.f, 0.f, 0.f, 0.f)
+			[
+				CreateButton(FText::FromString("MIRROR"), &FCustomWindowTab::OpenMirror)
+			]
+		];
 
-	return SNew(SDockTab).TabRole(ETabRole::NomadTab)
+	TSharedRef<SDockTab> NewDockTab = SNew(SDockTab).TabRole(Role)
+		.Label(FText::FromString(ViewportClient->GetMirrorSource().IsValid() ? TEXT("CustomWindow (Mirror)") : TEXT("CustomWindow")))
 		[
 			SNew(SVerticalBox)
 			+SVerticalBox::Slot().Padding(0.f, 5.f)
@@ -90,22 +327,53 @@ TSharedRef<SDockTab> FCustomWindowModule::CreateWindow(const FSpawnTabArgs& TabA
 				]
 			]
 		];
+	DockTab = NewDockTab;
+	return NewDockTab;
 }
 
-void FCustomWindowModule::CreateToggle(FName Name, TSharedPtr<SWidget> WidgetToAdd)
+void FCustomWindowTab::CreateToggle(FName Name, TFunction<TSharedRef<SWidget>()> GetWidget)
 {
 	TSharedPtr<SBorder> Border = SNew(SBorder)
-		.OnMouseButtonDown_Lambda([this, Name, WidgetToAdd](const FGeometry& Geom, const FPointerEvent&)->FReply
-			{ Deselect(); Settings[Name].Key->SetBorderImage(&ActiveColor);
-			  SetOverlay(WidgetToAdd.ToSharedRef()); return FReply::Handled(); })
+		.OnMouseButtonDown_Lambda([this, Name](const FGeometry& Geom, const FPointerEvent&)->FReply
+			{ ShowSettings(Name); return FReply::Handled(); })
 		.VAlign(EVerticalAlignment::VAlign_Center)
 		.BorderImage(&DisabledColor);
 
 	Border->SetContent(SNew(STextBlock).Text(FText::FromName(Name)).Justification(ETextJustify::Center));
-	Settings.Emplace(Name, MakeTuple(Border, WidgetToAdd));
+	Settings.Emplace(Name, MakeTuple(Border, MoveTemp(GetWidget)));
+}
+
+void FCustomWindowTab::ShowSettings(FName Name)
+{
+	if (const TTuple<TSharedPtr<SBorder>, TFunction<TSharedRef<SWidget>()>>* Setting = Settings.Find(Name))
+	{
+		Deselect();
+		Setting->Key->SetBorderImage(&ActiveColor);
+		SetOverlay(Setting->Value());
+	}
+}
+
+void FCustomWindowTab::LoadSelection()
+{
+	const TArray<FCanvasItemHandle>& Selection = ViewportClient->GetSelection();
+	if (Selection.Num() == 0)
+	{
+		return;
+	}
+
+	// The panels read their data every frame, filling it is enough to show the item
+	const FCanvasItemHandle Handle = Selection.Last();
+	FCanvasPrimitives::ForEach([this, Handle](auto Primitive)
+	{
+		if (ViewportClient->Scene.GetType(Handle) == decltype(Primitive)::Type
+			&& ViewportClient->GetItemData(Handle, GetPanel<typename decltype(Primitive)::DataType>().Item))
+		{
+			ShowSettings(FName(decltype(Primitive)::Label));
+		}
+	});
 }
 
-void FCustomWindowModule::SetOverlay(TSharedRef<SWidget> NewWidget)
+void FCustomWindowTab::SetOverlay(TSharedRef<SWidget> NewWidget)
 {
 	if (Overlay->GetNumWidgets() > 0)
 	{
@@ -114,7 +382,7 @@ void FCustomWindowModule::SetOverlay(TSharedRef<SWidget> NewWidget)
 	Overlay->AddSlot(0).AttachWidget(NewWidget);
 }
 
-void FCustomWindowModule::Deselect()
+void FCustomWindowTab::Deselect()
 {
 	for (auto& Setting : Settings)
 	{		
@@ -123,194 +391,153 @@ void FCustomWindowModule::Deselect()
 	}
 }
 
-TSharedPtr<SWidget> FCustomWindowModule::CreateBoxSettings()
+template<typename DataType>
+TCanvasSettingsPanel<DataType>& FCustomWindowTab::GetPanel()
 {
-	auto OnNameCommit = [this](const FText& InText, ETextCommit::Type CommitType) -> void { BoxData.Name = FName(InText.ToString()); };
-	
-	auto OnThicknessCommit = [this](float InValue, ETextCommit::Type CommitType) -> void { BoxData.Thickness = InValue; };
-	auto OnThicknessUpdate = [this]() -> float { return BoxData.Thickness; };
-	TSharedRef<SHorizontalBox> ThicknessBox = SNew(SHorizontalBox);	
-	CreateNumericField<float, SHorizontalBox>(ThicknessBox, FText::FromString("Thickness"), ETextJustify::Left, 0.2f, 0.8f, OnThicknessCommit, OnThicknessUpdate);
-
-	auto OnPosXCommit = [this](uint32 InValue, ETextCommit::Type CommitType) -> void { BoxData.Position.X = InValue; };
-	auto OnPosXUpdate = [this]() -> uint32 { return BoxData.Position.X; };
-	auto OnPosYCommit = [this](uint32 InValue, ETextCommit::Type CommitType) -> void { BoxData.Position.Y = InValue; };
-	auto OnPosYUpdate = [this]() -> uint32 { return BoxData.Position.Y; };
-	TSharedRef<SHorizontalBox> PosBox = SNew(SHorizontalBox);
-	CreateNumericField<uint32, SHorizontalBox>(PosBox, FText::FromString("X"), ETextJustify::Center, 0.1f, 0.4f, OnPosXCommit, OnPosXUpdate);
-	CreateNumericField<uint32, SHorizontalBox>(PosBox, FText::FromString("Y"), ETextJustify::Center, 0.1f, 0.4f, OnPosYCommit, OnPosYUpdate);
-
-	auto OnSizeWCommit = [this](uint32 InValue, ETextCommit::Type CommitType) -> void { BoxData.Size.X = InValue; };
-	auto OnSizeWUpdate = [this]() -> uint32 { return BoxData.Size.X; };
-	auto OnSizeHCommit = [this](uint32 InValue, ETextCommit::Type CommitType) -> void { BoxData.Size.Y = InValue; };
-	auto OnSizeHUpdate = [this]() -> uint32 { return BoxData.Size.Y; };
-	TSharedRef<SHorizontalBox> SizeBox = SNew(SHorizontalBox);
-	CreateNumericField<uint32, SHorizontalBox>(SizeBox, FText::FromString("W"), ETextJustify::Center, 0.1f, 0.4f, OnSizeWCommit, OnSizeWUpdate);
-	CreateNumericField<uint32, SHorizontalBox>(SizeBox, FText::FromString("H"), ETextJustify::Center, 0.1f, 0.4f, OnSizeHCommit, OnSizeHUpdate);
-
-	auto OnColorSelected = [this](FLinearColor InColor) -> void { BoxData.Color = InColor.HSVToLinearRGB(); };
-
-	return SNew(SVerticalBox)
-		+ SVerticalBox::Slot().Padding(0.f, 5.f)
-		[
-			SNew(SHorizontalBox)
-			+SHorizontalBox::Slot().FillWidth(0.5f).Padding(5.f, 0.f) //Name hbox
-			[
-				CreateTextEditBox(FText::FromString("Name"), OnNameCommit)
-			]
-			+SHorizontalBox::Slot().FillWidth(0.5f).Padding(5.f, 0.f) //Pos hbox
-			[
-				PosBox
-			]
-		]
-		+SVerticalBox::Slot().Padding(0.f, 5.f)
-		[
-			SNew(SHorizontalBox)
-			+SHorizontalBox::Slot().FillWidth(0.5f).Padding(5.f, 0.f) //Thickness hbox
-			[
-				ThicknessBox
-			]
-			+SHorizontalBox::Slot().FillWidth(0.5f).Padding(5.f, 0.f) //Size hbox
-			[
-				SizeBox
-			]
-		]
-		+SVerticalBox::Slot().Padding(0.f, 5.f)
-		[
-			SNew(SHorizontalBox)
-			+SHorizontalBox::Slot().FillWidth(0.5f).Padding(5.f, 0.f) //Color hbox
-			[
-				CreateColorBox(FText::FromString("Color"), OnColorSelected)
-			]
-			+SHorizontalBox::Slot().FillWidth(0.5f).HAlign(EHorizontalAlignment::HAlign_Center)
-			[
-				CreateButton(FText::FromString("ENTER"), &FCustomWindowModule::Add<FCanvasBoxItem>)
-			]
-		];
+	TCanvasSettingsPanelPtr<DataType>& Panel = Panels.Get<FCanvasPrimitives::GetIndex<DataType>()>();
+	if (!Panel.IsValid())
+	{
+		TCanvasSettingsPanelPool<DataType>& Pool = FCustomWindowModule::Get().ReleasedPanels.Get<FCanvasPrimitives::GetIndex<DataType>()>();
+		if (Pool.Num() > 0)
+		{
+			Panel = Pool.Pop(false);
+			INC_DWORD_STAT(STAT_CustomWindow_PanelsReused);
+		}
+		else
+		{
+			Panel = MakeShared<TCanvasSettingsPanel<DataType>>();
+			CreateSettings(*Panel);
+			INC_DWORD_STAT(STAT_CustomWindow_PanelsBuilt);
+		}
+		Panel->Owner = this;
+	}
+	return *Panel;
 }
 
-TSharedRef<SWidget> FCustomWindowModule::CreateTextSettings()
+template<typename DataType>
+void FCustomWindowTab::CreateSettings(TCanvasSettingsPanel<DataType>& Panel)
 {
-	auto OnNameCommit = [this](const FText& InText, ETextCommit::Type CommitType) -> void { TextData.Name = FName(InText.ToString()); };
-	auto OnMessageCommit = [this](const FText& InText, ETextCommit::Type CommitType) -> void { TextData.Message = InText.ToString(); };
+	SCOPE_CYCLE_COUNTER(STAT_CustomWindow_CreateSettings);
+	TArray<TSharedRef<SWidget>> Fields;
+	TCanvasPrimitive<DataType>::VisitFields(Panel.Item, [this, &Fields](const FCanvasField& Field, auto& Value)
+	{
+		Fields.Add(CreateField(Field, Value));
+	});
+	// Bound to the panel rather than to the tab, the panel outlives the tab that built it
+	Fields.Add(SNew(SBox).HAlign(EHorizontalAlignment::HAlign_Center)
+		[
+			SNew(SButton)
+			.Text(FText::FromString("ENTER"))
+			.OnClicked_Lambda([&Panel]()
+			{
+				if (Panel.Owner)
+				{
+					Panel.Owner->GetSceneClient().AddItem(Panel.Item);
+				}
+				return FReply::Handled();
+			})
+			.VAlign(EVerticalAlignment::VAlign_Center)
+		]);
 
-	auto OnPosXCommit = [this](uint32 InValue, ETextCommit::Type CommitType) -> void { TextData.Position.X = InValue; };
-	auto OnPosXUpdate = [this]() -> uint32 { return TextData.Position.X; };
-	auto OnPosYCommit = [this](uint32 InValue, ETextCommit::Type CommitType) -> void { TextData.Position.Y = InValue; };
-	auto OnPosYUpdate = [this]() -> uint32 { return TextData.Position.Y; };
-	TSharedRef<SHorizontalBox> PosBox = SNew(SHorizontalBox);
-	CreateNumericField<uint32, SHorizontalBox>(PosBox, FText::FromString("X"), ETextJustify::Center, 0.1f, 0.4f, OnPosXCommit, OnPosXUpdate);
-	CreateNumericField<uint32, SHorizontalBox>(PosBox, FText::FromString("Y"), ETextJustify::Center, 0.1f, 0.4f, OnPosYCommit, OnPosYUpdate);
+	TSharedRef<SVerticalBox> Widget = SNew(SVerticalBox);
+	for (int32 Index = 0; Index < Fields.Num(); Index += 2)
+	{
+		TSharedRef<SHorizontalBox> Row = SNew(SHorizontalBox);
+		Row->AddSlot().FillWidth(0.5f).Padding(5.f, 0.f).AttachWidget(Fields[Index]);
+		Row->AddSlot().FillWidth(0.5f).Padding(5.f, 0.f).AttachWidget(Fields.IsValidIndex(Index + 1) ? Fields[Index + 1] : SNullWidget::NullWidget);
+		Widget->AddSlot().Padding(0.f, 5.f).AttachWidget(Row);
+	}
+	Panel.Widget = Widget;
+}
 
-	auto OnFontSizeCommit = [this](float InValue, ETextCommit::Type CommitType) -> void { TextData.FontSize = InValue; };
-	auto OnFontSizeUpdate = [this]() -> float { return TextData.FontSize; };
-	TSharedRef<SHorizontalBox> FontSizeBox = SNew(SHorizontalBox);
-	CreateNumericField<float, SHorizontalBox>(FontSizeBox, FText::FromString("Font Size"), ETextJustify::Left, 0.2f, 0.8f, OnFontSizeCommit, OnFontSizeUpdate);
+void FCustomWindowTab::ReleasePanels()
+{
+	// Detached from the overlay first, a widget can only have one parent
+	if (Overlay.IsValid())
+	{
+		Overlay->ClearChildren();
+	}
 
-	auto OnColorSelected = [this](FLinearColor InColor) -> void { TextData.Color = InColor.HSVToLinearRGB(); };
+	FCanvasPrimitives::ForEach([this](auto Primitive)
+	{
+		using DataType = typename decltype(Primitive)::DataType;
+		TCanvasSettingsPanelPtr<DataType>& Panel = Panels.Get<FCanvasPrimitives::GetIndex<DataType>()>();
+		if (Panel.IsValid())
+		{
+			Panel->Owner = nullptr;
+			FCustomWindowModule::Get().ReleasedPanels.Get<FCanvasPrimitives::GetIndex<DataType>()>().Add(Panel.ToSharedRef());
+			Panel.Reset();
+		}
+	});
+}
 
-	return SNew(SVerticalBox)
-		+ SVerticalBox::Slot().Padding(0.f, 5.f)
-		[
-			SNew(SHorizontalBox)
-			+ SHorizontalBox::Slot().FillWidth(0.5f).Padding(5.f, 0.f) //Name hbox
-			[
-				CreateTextEditBox(FText::FromString("Name"), OnNameCommit)
-			]
-			+ SHorizontalBox::Slot().FillWidth(0.5f).Padding(5.f, 0.f) //Pos hbox
-			[
-				PosBox
-			]
-		]
-		+ SVerticalBox::Slot().Padding(0.f, 5.f)
-		[
-			SNew(SHorizontalBox)
-			+ SHorizontalBox::Slot().FillWidth(0.5f).Padding(5.f, 0.f) //Thickness hbox
-			[
-				CreateTextEditBox(FText::FromString("Message"), OnMessageCommit)
-			]
-			+ SHorizontalBox::Slot().FillWidth(0.5f).Padding(5.f, 0.f) //Size hbox
-			[
-				FontSizeBox
-			]
-		]
-		+ SVerticalBox::Slot().Padding(0.f, 5.f)
-		[
-			SNew(SHorizontalBox)
-			+ SHorizontalBox::Slot().FillWidth(0.5f).Padding(5.f, 0.f) //Color hbox
-			[
-				CreateColorBox(FText::FromString("Color"), OnColorSelected)
-			]
-			+ SHorizontalBox::Slot().FillWidth(0.5f).HAlign(EHorizontalAlignment::HAlign_Center)
-			[
-				CreateButton(FText::FromString("ENTER"), &FCustomWindowModule::Add<FCanvasTextItem>)
-			]
-		];
+TSharedRef<SWidget> FCustomWindowTab::CreateField(const FCanvasField& Field, FName& Value)
+{
+	auto OnCommit = [&Value](const FText& InText, ETextCommit::Type CommitType) -> void { Value = FName(InText.ToString()); };
+	auto OnUpdate = [&Value]() -> FText { return Value.IsNone() ? FText::GetEmpty() : FText::FromName(Value); };
+	return CreateTextEditBox(FText::FromString(Field.Label), OnCommit, OnUpdate);
 }
 
-TSharedRef<SWidget> FCustomWindowModule::CreateTileSettings()
+TSharedRef<SWidget> FCustomWindowTab::CreateField(const FCanvasField& Field, FString& Value)
 {
-	auto OnNameCommit = [this](const FText& InText, ETextCommit::Type CommitType) -> void { TileData.Name = FName(InText.ToString()); };
+	if (Field.Hint == ECanvasFieldHint::FontPath || Field.Hint == ECanvasFieldHint::TexturePath)
+	{
+		UClass* AssetClass = Field.Hint == ECanvasFieldHint::FontPath ? UFont::StaticClass() : UTexture2D::StaticClass();
+		auto OnSelected = [&Value](const FAssetData& InAsset) -> void { Value = InAsset.ObjectPath.ToString(); };
+		auto OnUpdate = [&Value]() -> FString { return Value; };
+		return CreateAssetSelection(FText::FromString(Field.Label), AssetClass, OnSelected, OnUpdate);
+	}
 
-	auto OnPosXCommit = [this](uint32 InValue, ETextCommit::Type CommitType) -> void { TileData.Position.X = InValue; };
-	auto OnPosXUpdate = [this]() -> uint32 { return TileData.Position.X; };
-	auto OnPosYCommit = [this](uint32 InValue, ETextCommit::Type CommitType) -> void { TileData.Position.Y = InValue; };
-	auto OnPosYUpdate = [this]() -> uint32 { return TileData.Position.Y; };
-	TSharedRef<SHorizontalBox> PosBox = SNew(SHorizontalBox);
-	CreateNumericField<uint32, SHorizontalBox>(PosBox, FText::FromString("X"), ETextJustify::Center, 0.1f, 0.4f, OnPosXCommit, OnPosXUpdate);
-	CreateNumericField<uint32, SHorizontalBox>(PosBox, FText::FromString("Y"), ETextJustify::Center, 0.1f, 0.4f, OnPosYCommit, OnPosYUpdate);
+	auto OnCommit = [&Value](const FText& InText, ETextCommit::Type CommitType) -> void { Value = InText.ToString(); };
+	auto OnUpdate = [&Value]() -> FText { return FText::FromString(Value); };
+	return CreateTextEditBox(FText::FromString(Field.Label), OnCommit, OnUpdate);
+}
 
-	auto OnSizeWCommit = [this](uint32 InValue, ETextCommit::Type CommitType) -> void { TileData.Size.X = InValue; };
-	auto OnSizeWUpdate = [this]() -> uint32 { return TileData.Size.X; };
-	auto OnSizeHCommit = [this](uint32 InValue, ETextCommit::Type CommitType) -> void { TileData.Size.Y = InValue; };
-	auto OnSizeHUpdate = [this]() -> uint32 { return TileData.Size.Y; };
-	TSharedRef<SHorizontalBox> SizeBox = SNew(SHorizontalBox);
-	CreateNumericField<uint32, SHorizontalBox>(SizeBox, FText::FromString("W"), ETextJustify::Center, 0.1f, 0.4f, OnSizeWCommit, OnSizeWUpdate);
-	CreateNumericField<uint32, SHorizontalBox>(SizeBox, FText::FromString("H"), ETextJustify::Center, 0.1f, 0.4f, OnSizeHCommit, OnSizeHUpdate);
+TSharedRef<SWidget> FCustomWindowTab::CreateField(const FCanvasField& Field, float& Value)
+{
+	TSharedRef<SHorizontalBox> Box = SNew(SHorizontalBox);
+	CreateNumericField<float, SHorizontalBox>(Box, FText::FromString(Field.Label), ETextJustify::Left, 0.2f, 0.8f,
+		[&Value](float InValue, ETextCommit::Type CommitType) { Value = InValue; }, [&Value]() { return Value; }, 0.f);
+	return Box;
+}
 
-	auto OnColorSelected = [this](FLinearColor InColor) -> void { TileData.Color = InColor.HSVToLinearRGB(); TileData.Color.A = 1.0f; };
-	auto OnTextureSelected = [this](const FAssetData& InTexture) -> void { TileData.TexturePath = InTexture.ObjectPath.ToString(); };
+TSharedRef<SWidget> FCustomWindowTab::CreateField(const FCanvasField& Field, int32& Value)
+{
+	TSharedRef<SHorizontalBox> Box = SNew(SHorizontalBox);
+	CreateNumericField<int32, SHorizontalBox>(Box, FText::FromString(Field.Label), ETextJustify::Left, 0.2f, 0.8f,
+		[&Value](int32 InValue, ETextCommit::Type CommitType) { Value = InValue; }, [&Value]() { return Value; });
+	return Box;
+}
 
-	return SNew(SVerticalBox)
-		+ SVerticalBox::Slot().Padding(0.f, 5.f)
-		[
-			SNew(SHorizontalBox)
-			+ SHorizontalBox::Slot().FillWidth(0.5f).Padding(5.f, 0.f) //Name hbox
-			[
-				CreateTextEditBox(FText::FromString("Name"), OnNameCommit)
-			]
-			+ SHorizontalBox::Slot().FillWidth(0.5f).Padding(5.f, 0.f) //Pos hbox
-			[
-				PosBox
-			]
-		]
-		+ SVerticalBox::Slot().Padding(0.f, 5.f)
-		[
-			SNew(SHorizontalBox)
-			+ SHorizontalBox::Slot().FillWidth(0.5f).Padding(5.f, 0.f) //Thickness hbox
-			[
-				CreateColorBox(FText::FromString("Color"), OnColorSelected)
-			]
-			+ SHorizontalBox::Slot().FillWidth(0.5f).Padding(5.f, 0.f) //Size hbox
-			[
-				SizeBox
-			]
-		]
-		+ SVerticalBox::Slot().Padding(0.f, 5.f)
-		[
-			SNew(SHorizontalBox)
-			+ SHorizontalBox::Slot().FillWidth(0.5f).Padding(5.f, 0.f) //Color hbox
-			[
-				CreateAssetSelection(FText::FromString("Texture"), OnTextureSelected)
-			]
-			+ SHorizontalBox::Slot().FillWidth(0.5f).HAlign(EHorizontalAlignment::HAlign_Center)
-			[
-				CreateButton(FText::FromString("ENTER"), &FCustomWindowModule::Add<FCanvasTileItem>)
-			]
-		];
+TSharedRef<SWidget> FCustomWindowTab::CreateField(const FCanvasField& Field, FVector2D& Value)
+{
+	// Positions can be negative and fractional, picking loads whatever the item holds
+	const bool bExtent = Field.Hint == ECanvasFieldHint::Extent;
+	const TOptional<float> MinValue = bExtent ? TOptional<float>(0.f) : TOptional<float>();
+	TSharedRef<SHorizontalBox> Box = SNew(SHorizontalBox);
+	CreateNumericField<float, SHorizontalBox>(Box, FText::FromString(bExtent ? "W" : "X"), ETextJustify::Center, 0.1f, 0.4f,
+		[&Value](float InValue, ETextCommit::Type CommitType) { Value.X = InValue; }, [&Value]() { return static_cast<float>(Value.X); }, MinValue);
+	CreateNumericField<float, SHorizontalBox>(Box, FText::FromString(bExtent ? "H" : "Y"), ETextJustify::Center, 0.1f, 0.4f,
+		[&Value](float InValue, ETextCommit::Type CommitType) { Value.Y = InValue; }, [&Value]() { return static_cast<float>(Value.Y); }, MinValue);
+	return Box;
+}
+
+TSharedRef<SWidget> FCustomWindowTab::CreateField(const FCanvasField& Field, FLinearColor& Value)
+{
+	const bool bOpaque = Field.Hint == ECanvasFieldHint::OpaqueColor;
+	auto OnSelected = [&Value, bOpaque](FLinearColor InColor) -> void
+	{
+		Value = InColor.HSVToLinearRGB();
+		if (bOpaque)
+		{
+			Value.A = 1.0f;
+		}
+	};
+	auto OnUpdate = [&Value]() -> FLinearColor { return Value; };
+	return CreateColorBox(FText::FromString(Field.Label), OnSelected, OnUpdate);
 }
 
-TSharedRef<SWidget> FCustomWindowModule::CreateButton(const FText& Name, FReply(FCustomWindowModule::*InFunc)())
+TSharedRef<SWidget> FCustomWindowTab::CreateButton(const FText& Name, FReply(FCustomWindowTab::*InFunc)())
 {
 	return SNew(SButton)
 		.Text(Name)
@@ -318,7 +545,8 @@ TSharedRef<SWidget> FCustomWindowModule::CreateButton(const FText& Name, FReply(
 		.VAlign(EVerticalAlignment::VAlign_Center);
 }
 
-TSharedRef<SWidget> FCustomWindowModule::CreateAssetSelection(const FText& Name, const std::function<void(const FAssetData& InAsset)>& AssetSelectLambda)
+TSharedRef<SWidget> FCustomWindowTab::CreateAssetSelection(const FText& Name, UClass* AllowedClass, const std::function<void(const FAssetData& InAsset)>& AssetSelectLambda,
+	const std::function<FString()>& AssetUpdateLambda)
 {
 	return SNew(SHorizontalBox)
 		+ SHorizontalBox::Slot().FillWidth(0.2f).VAlign(EVerticalAlignment::VAlign_Center)
@@ -328,13 +556,15 @@ TSharedRef<SWidget> FCustomWindowModule::CreateAssetSelection(const FText& Name,
 		+ SHorizontalBox::Slot().FillWidth(0.8f)
 		[
 			SNew(SObjectPropertyEntryBox)
-			.AllowedClass(UTexture2D::StaticClass())
+			.AllowedClass(AllowedClass)
 			.DisplayThumbnail(true)
+			.ObjectPath_Lambda(AssetUpdateLambda)
 			.OnObjectChanged_Lambda(AssetSelectLambda)
 		];
 }
 
-TSharedRef<SWidget> FCustomWindowModule::CreateTextEditBox(const FText& Name, const std::function<void(const FText& InText, ETextCommit::Type CommitType)> &TextCommitLambda)
+TSharedRef<SWidget> FCustomWindowTab::CreateTextEditBox(const FText& Name, const std::function<void(const FText& InText, ETextCommit::Type CommitType)> &TextCommitLambda,
+	const std::function<FText()>& TextUpdateLambda)
 {
 	return SNew(SHorizontalBox)
 		+ SHorizontalBox::Slot().FillWidth(0.2f).VAlign(EVerticalAlignment::VAlign_Center)
@@ -344,12 +574,14 @@ TSharedRef<SWidget> FCustomWindowModule::CreateTextEditBox(const FText& Name, co
 		+ SHorizontalBox::Slot().FillWidth(0.8f)
 		[
 			SNew(SEditableTextBox)
-			.Text(FText::FromString("Enter..."))
+			.HintText(FText::FromString("Enter..."))
+			.Text_Lambda(TextUpdateLambda)
 			.OnTextCommitted_Lambda(TextCommitLambda)
 		];
 }
 
-TSharedRef<SWidget> FCustomWindowModule::CreateColorBox(const FText& Name, const std::function<void(FLinearColor InColor)>& ColorSelectLambda)
+TSharedRef<SWidget> FCustomWindowTab::CreateColorBox(const FText& Name, const std::function<void(FLinearColor InColor)>& ColorSelectLambda,
+	const std::function<FLinearColor()>& ColorUpdateLambda)
 {
 	return SNew(SHorizontalBox)
 		+ SHorizontalBox::Slot().FillWidth(0.2f).VAlign(EVerticalAlignment::VAlign_Center)
@@ -359,107 +591,1966 @@ TSharedRef<SWidget> FCustomWindowModule::CreateColorBox(const FText& Name, const
 		+ SHorizontalBox::Slot().FillWidth(0.8f)
 		[
 			SNew(SColorSpectrum)
+			.Color_Lambda([ColorUpdateLambda]() { return ColorUpdateLambda().LinearRGBToHSV(); })
 			.OnValueChanged_Lambda(ColorSelectLambda)
 		];
 }
 
-FReply FCustomWindowModule::AddBox()
+void FCustomWindowTab::Init()
 {
-	ViewportClient->AddBox(BoxData);
-	return FReply::Handled();
+	// Only the toggles, a panel is built or reused when it is first shown
+	FCanvasPrimitives::ForEach([this](auto Primitive)
+	{
+		using DataType = typename decltype(Primitive)::DataType;
+		CreateToggle(FName(decltype(Primitive)::Label), [this]() -> TSharedRef<SWidget> { return GetPanel<DataType>().Widget.ToSharedRef(); });
+	});
 }
 
-void FCustomWindowModule::Init()
+void FCustomWindowModule::SaveScene(const TArray<FString>& Args)
 {
-	CreateToggle(FName("Box"), CreateBoxSettings());
-	CreateToggle(FName("Text"), CreateTextSettings());
-	CreateToggle(FName("Texture"), CreateTileSettings());
+	FCustomViewportClient* ViewportClient = GetActiveClient();
+	if (!ViewportClient || Args.Num() < 1)
+	{
+		UE_LOG(LogCustomWindow, Warning, TEXT("Usage: CustomWindow.SaveScene <File>, with the CustomWindow tab open"));
+		return;
+	}
+
+	FCanvasSceneData Data;
+	ViewportClient->ExportScene(Data);
+	if (FCanvasSceneSerializer::Save(Data, Args[0]))
+	{
+		UE_LOG(LogCustomWindow, Log, TEXT("Saved %d items to %s"), Data.Num(), *Args[0]);
+	}
 }
 
-FCustomViewportClient::FCustomViewportClient() : BackgroundColor(FLinearColor::Black)
+void FCustomWindowModule::LoadScene(const TArray<FString>& Args)
 {
+	FCustomViewportClient* ViewportClient = GetActiveClient();
+	if (!ViewportClient || Args.Num() < 1)
+	{
+		UE_LOG(LogCustomWindow, Warning, TEXT("Usage: CustomWindow.LoadScene <File>, with the CustomWindow tab open"));
+		return;
+	}
+
+	FCanvasSceneData Data;
+	const double StartTime = FPlatformTime::Seconds();
+	if (FCanvasSceneSerializer::Load(Args[0], Data))
+	{
+		ViewportClient->ClearScene();
+		ViewportClient->ImportScene(MoveTemp(Data));
+		UE_LOG(LogCustomWindow, Log, TEXT("Loaded %d items from %s in %.1f ms"), ViewportClient->Scene.Num(), *Args[0], (FPlatformTime::Seconds() - StartTime) * 1000.0);
+	}
 }
 
-FCustomViewportClient::~FCustomViewportClient()
+void FCustomWindowModule::CaptureScene(const TArray<FString>& Args)
 {
-	CanvasItems.Empty();
-	LoadedTextures.Empty();
+	FCustomViewportClient* ViewportClient = GetActiveClient();
+	if (!ViewportClient || Args.Num() < 1)
+	{
+		UE_LOG(LogCustomWindow, Warning, TEXT("Usage: CustomWindow.CaptureScene <File> [Width] [Height], with the CustomWindow tab open"));
+		return;
+	}
+
+	// Defaults to the viewport size, like a screenshot of the tab
+	const FIntPoint ViewportSize = ViewportClient->GetViewportSize();
+	const int32 Width = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : FMath::Max(ViewportSize.X, 1);
+	const int32 Height = Args.Num() > 2 ? FCString::Atoi(*Args[2]) : FMath::Max(ViewportSize.Y, 1);
+	FCanvasCapture& Capture = ViewportClient->GetCapture();
+	Capture.GetTarget(FIntPoint(Width, Height));
+	Capture.SavePNG(Args[0]);
 }
 
-void FCustomViewportClient::Draw(FViewport* Viewport, FCanvas* Canvas)
+void FCustomWindowModule::Undo(const TArray<FString>& Args)
 {
-	Canvas->Clear(BackgroundColor);
+	FCustomViewportClient* ViewportClient = GetActiveClient();
+	const int32 NumSteps = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 1;
+	int32 NumUndone = 0;
+	while (ViewportClient && NumUndone < NumSteps && ViewportClient->Undo())
+	{
+		++NumUndone;
+	}
+	UE_LOG(LogCustomWindow, Log, TEXT("Undid %d of %d steps"), NumUndone, NumSteps);
+}
 
-	for (auto& Item : CanvasItems)
+void FCustomWindowModule::Redo(const TArray<FString>& Args)
+{
+	FCustomViewportClient* ViewportClient = GetActiveClient();
+	const int32 NumSteps = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 1;
+	int32 NumRedone = 0;
+	while (ViewportClient && NumRedone < NumSteps && ViewportClient->Redo())
 	{
-		Canvas->DrawItem(*Item.Value);
+		++NumRedone;
 	}
+	UE_LOG(LogCustomWindow, Log, TEXT("Redid %d of %d steps"), NumRedone, NumSteps);
 }
 
-void FCustomViewportClient::AddBox(const FBoxData& Data)
+void FCustomWindowModule::StressCommandQueue(const TArray<FString>& Args)
 {
-	FCanvasBoxItem* Box = new FCanvasBoxItem(Data.Position, Data.Size);
-	Box->SetColor(Data.Color);
-	Box->LineThickness = Data.Thickness;
+	FCustomViewportClient* Client = GetActiveClient();
+	if (!Client)
+	{
+		UE_LOG(LogCustomWindow, Warning, TEXT("CustomWindow.StressCommandQueue needs the CustomWindow tab open"));
+		return;
+	}
+
+	const int32 NumProducers = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 8;
+	const int32 NumPerProducer = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 10000;
+
+	struct FStressState
+	{
+		std::atomic<int32> RunningProducers{ 0 };
+		std::atomic<int64> NumRetries{ 0 };
+		std::atomic<int64> NumGivenUp{ 0 };
+		double StartTime = 0.0;
+	};
+	TSharedRef<FStressState, ESPMode::ThreadSafe> State = MakeShared<FStressState, ESPMode::ThreadSafe>();
+	State->RunningProducers = NumProducers;
+	State->StartTime = FPlatformTime::Seconds();
 
-	if (CanvasItems.Contains(Data.Name))
+	// The producers only hold the queue, the tab and its client may close while they run
+	const TSharedRef<FCanvasCommandQueue, ESPMode::ThreadSafe> Queue = Client->Commands;
+	for (int32 Producer = 0; Producer < NumProducers; ++Producer)
 	{
-		delete CanvasItems[Data.Name];
+		Async(EAsyncExecution::ThreadPool, [Queue, State, Producer, NumProducers, NumPerProducer]()
+		{
+			constexpr int32 MaxRetries = 10000;
+			for (int32 Index = 0; Index < NumPerProducer; ++Index)
+			{
+				FBoxData Box;
+				Box.Name = FName(TEXT("Stress"), Producer * NumPerProducer + Index + 1);
+				Box.Position = FVector2D((Index % 256) * 12.f, (Producer + (Index / 256) * NumProducers) * 12.f);
+				Box.Size = FVector2D(10.f, 10.f);
+				Box.Color = FLinearColor::MakeFromHSV8(static_cast<uint8>(Producer * 37), 200, 255);
+				Box.Thickness = 1.f;
+				Box.Layer = Producer;
+
+				// Backpressure: a full queue means the game thread hasn't drained yet, give it time instead of growing
+				int32 Retries = 0;
+				while (!Queue->Enqueue(MakeCanvasCommand(Box)) && ++Retries < MaxRetries)
+				{
+					FPlatformProcess::Yield();
+				}
+				State->NumRetries += Retries;
+				State->NumGivenUp += Retries == MaxRetries ? 1 : 0;
+			}
+
+			if (--State->RunningProducers == 0)
+			{
+				const FCanvasCommandQueueStats Stats = Queue->GetStats();
+				UE_LOG(LogCustomWindow, Log, TEXT("%d producers queued %d commands in %.1f ms, %lld retries, %lld given up, high water %d of %d"),
+					NumProducers, NumProducers * NumPerProducer, (FPlatformTime::Seconds() - State->StartTime) * 1000.0,
+					State->NumRetries.load(), State->NumGivenUp.load(), Stats.HighWater, Stats.Capacity);
+			}
+		});
 	}
+}
 
-	CanvasItems.Emplace(Data.Name, Box);
+FCustomViewportClient::FCustomViewportClient(TSharedPtr<FCustomTextureCache> InTextureCache, TSharedPtr<FCanvasTextureAtlas> InTextureAtlas)
+	: BackgroundColor(FLinearColor::Black)
+	, TextureCache(InTextureCache.IsValid() ? InTextureCache.ToSharedRef() : MakeShared<FCustomTextureCache>())
+	, TextureAtlas(InTextureAtlas.IsValid() ? InTextureAtlas.ToSharedRef() : MakeShared<FCanvasTextureAtlas>())
+	, Commands(MakeShared<FCanvasCommandQueue, ESPMode::ThreadSafe>(FMath::Max(CVarCustomWindowCommandQueueCapacity.GetValueOnGameThread(), 2)))
+	, Journal(static_cast<int64>(FMath::Max(CVarCustomWindowUndoHistoryMB.GetValueOnGameThread(), 1)) * 1024 * 1024)
+{
+	TextureCache->OnTextureReady.AddRaw(this, &FCustomViewportClient::ApplyTexture);
 }
 
-void FCustomViewportClient::AddText(const FTextData& Data)
+FCustomViewportClient::~FCustomViewportClient()
 {
-	FLinearColor Col = FLinearColor(Data.Color.R, Data.Color.G, Data.Color.B);
-	FCanvasTextItem* Text = new FCanvasTextItem(Data.Position, FText::FromString(Data.Message), GEngine->GetSmallFont(), Col);
-	Text->Scale = FVector2D(Data.FontSize);
+	DisableAutosave();
+	TextureCache->OnTextureReady.RemoveAll(this);
+	Capture.Reset();
+	// The cache and the atlas may be shared and outlive this client
+	for (const FTileInstance& Tile : Scene.GetItems<FTileInstance>())
+	{
+		ReleaseTileTextures(Tile);
+	}
+	Scene.Empty();
+}
 
-	if (CanvasItems.Contains(Data.Name))
+void FCustomViewportClient::SetMirrorSource(TSharedPtr<FCustomViewportClient> InSource)
+{
+	// Mirroring a mirror shows its source, so every view of a scene reads it from the client that owns it
+	if (InSource.IsValid() && InSource->MirrorSource.IsValid())
+	{
+		InSource = InSource->MirrorSource;
+	}
+	if (InSource.Get() == this || InSource == MirrorSource)
 	{
-		delete CanvasItems[Data.Name];
+		return;
 	}
 
-	CanvasItems.Emplace(Data.Name, Text);
+	MirrorSource = InSource;
+	MirroredVersion = 0;
+	ClearSelection();
+	MarkDirty();
 }
 
-void FCustomViewportClient::AddTile(const FTileData& Data)
+FCanvasCapture& FCustomViewportClient::GetCapture()
 {
-	UTexture2D* Texture;
-	if (!LoadedTextures.Contains(FName(Data.TexturePath)))
+	if (!Capture.IsValid())
 	{
-		Texture = LoadObject<UTexture2D>(nullptr, *Data.TexturePath);
-		LoadedTextures.Emplace(FName(Data.TexturePath), Texture);
+		Capture = MakeUnique<FCanvasCapture>(*this);
 	}
-	else
+	return *Capture;
+}
+
+void FCustomViewportClient::Draw(FViewport* Viewport, FCanvas* Canvas)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CustomWindow_Draw);
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	++RenderedFrames;
+
+	// Released by the previous draw when the viewport redraws without a new ConsumeRedraw, after a resize for example
+	if (!RenderSnapshot.Boxes.IsValid())
+	{
+		BuildSnapshot(Viewport ? Viewport->GetSizeXY() : LastViewportSize);
+	}
+
+	FCanvasDrawCounters Counters;
+	DrawSnapshot(Canvas, RenderSnapshot, Counters);
+	DrawSelection(Canvas, RenderSnapshot);
+	SubmittedItems = Counters.Items;
+	SubmittedBatches = Counters.Batches;
+
+	// The canvas has copied what it draws. Let go of the scene arrays right away, otherwise the first edit of every
+	// type until the next snapshot would copy the whole array to change one item
+	RenderSnapshot.Boxes.Reset();
+	RenderSnapshot.Texts.Reset();
+	RenderSnapshot.Tiles.Reset();
+	RetiredPixelTextures.Reset();
+
+	INC_DWORD_STAT_BY(STAT_CustomWindow_ItemsSubmitted, SubmittedItems);
+	INC_DWORD_STAT_BY(STAT_CustomWindow_Batches, SubmittedBatches);
+	if (RenderSnapshot.bShowStats)
+	{
+		DrawStats(Canvas);
+	}
+	LastDrawTime = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+}
+
+void FCustomViewportClient::DrawSnapshot(FCanvas* Canvas, const FCanvasRenderSnapshot& Snapshot, FCanvasDrawCounters& OutCounters)
+{
+	Canvas->Clear(Snapshot.BackgroundColor);
+	if (!Snapshot.Boxes.IsValid())
 	{
-		Texture = LoadedTextures[FName(Data.TexturePath)];
+		return;
 	}
 
-	float TextureRatio = static_cast<float>(Texture->GetSizeX()) / Texture->GetSizeY();
-	FCanvasTileItem* Tile = new FCanvasTileItem(Data.Position, Texture->GetResource(), FVector2D(Data.Size.X * TextureRatio, Data.Size.Y), Data.Color);
-	Tile->BlendMode = ESimpleElementBlendMode::SE_BLEND_AlphaBlend;
+	const TArray<FBoxInstance>& Boxes = *Snapshot.Boxes;
+	const TArray<FTextInstance>& Texts = *Snapshot.Texts;
+	const TArray<FTileInstance>& Tiles = *Snapshot.Tiles;
+	const TArray<int32>& VisibleBoxes = Snapshot.VisibleBoxes;
+	const TArray<int32>& VisibleTexts = Snapshot.VisibleTexts;
+	const TArray<int32>& VisibleTiles = Snapshot.VisibleTiles;
 
-	if (CanvasItems.Contains(Data.Name))
+	Canvas->PushRelativeTransform(FTranslationMatrix(FVector(-Snapshot.CameraOffset, 0.f)) * FScaleMatrix(FVector(Snapshot.CameraZoom, Snapshot.CameraZoom, 1.f)));
+
+	// Every visible list is sorted by layer, draw them layer by layer with tiles below boxes below texts
+	int32 TileCursor = 0;
+	int32 BoxCursor = 0;
+	int32 TextCursor = 0;
+	while (TileCursor < VisibleTiles.Num() || BoxCursor < VisibleBoxes.Num() || TextCursor < VisibleTexts.Num())
 	{
-		delete CanvasItems[Data.Name];
+		int32 Layer = MAX_int32;
+		Layer = TileCursor < VisibleTiles.Num() ? FMath::Min(Layer, Tiles[VisibleTiles[TileCursor]].Layer) : Layer;
+		Layer = BoxCursor < VisibleBoxes.Num() ? FMath::Min(Layer, Boxes[VisibleBoxes[BoxCursor]].Layer) : Layer;
+		Layer = TextCursor < VisibleTexts.Num() ? FMath::Min(Layer, Texts[VisibleTexts[TextCursor]].Layer) : Layer;
+
+		auto AdvanceRun = [Layer](const auto& Items, const TArray<int32>& Visible, int32& Cursor) -> TArrayView<const int32>
+		{
+			const int32 RunStart = Cursor;
+			while (Cursor < Visible.Num() && Items[Visible[Cursor]].Layer == Layer)
+			{
+				++Cursor;
+			}
+			return MakeArrayView(Visible).Slice(RunStart, Cursor - RunStart);
+		};
+
+		DrawTiles(Canvas, Snapshot, AdvanceRun(Tiles, VisibleTiles, TileCursor), OutCounters);
+		DrawBoxes(Canvas, Snapshot, AdvanceRun(Boxes, VisibleBoxes, BoxCursor), OutCounters);
+		DrawTexts(Canvas, Snapshot, AdvanceRun(Texts, VisibleTexts, TextCursor), OutCounters);
 	}
+	DrawPlots(Canvas, Snapshot, OutCounters);
 
-	CanvasItems.Emplace(Data.Name, Tile);
+	Canvas->PopTransform();
 }
 
-void SCustomViewport::Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime)
+void FCustomViewportClient::DrawPlots(FCanvas* Canvas, const FCanvasRenderSnapshot& Snapshot, FCanvasDrawCounters& Counters)
+{
+	if (Snapshot.Plots.Num() == 0)
+	{
+		return;
+	}
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(FCustomViewportClient::DrawPlots);
+	const FHitProxyId HitProxyId = Canvas->GetHitProxyId();
+	FBatchedElements* Lines = Canvas->GetBatchedElements(FCanvas::ET_Line);
+	for (const FCanvasPlotSnapshot& Plot : Snapshot.Plots)
+	{
+		const int32 NumColumns = Plot.Columns.Num();
+		if (NumColumns == 0)
+		{
+			continue;
+		}
+
+		const FVector2D PlotSize = Plot.Bounds.GetSize();
+		const double ColumnWidth = PlotSize.X / NumColumns;
+		const double Scale = PlotSize.Y / (Plot.MaxValue - Plot.MinValue);
+		auto ToY = [&Plot, Scale](float Value) { return Plot.Bounds.Max.Y - (FMath::Clamp(Value, Plot.MinValue, Plot.MaxValue) - Plot.MinValue) * Scale; };
+
+		// One strip: a vertical segment over the envelope of every column, entered from the end nearest to the previous one
+		Lines->AddReserveLines(NumColumns * 2);
+		FVector Last = FVector::ZeroVector;
+		for (int32 Column = 0; Column < NumColumns; ++Column)
+		{
+			const double X = Plot.Bounds.Min.X + (Column + 0.5) * ColumnWidth;
+			FVector First(X, ToY(Plot.Columns[Column].X), 0.f);
+			FVector Second(X, ToY(Plot.Columns[Column].Y), 0.f);
+			if (Column > 0)
+			{
+				if (FMath::Abs(Last.Y - Second.Y) < FMath::Abs(Last.Y - First.Y))
+				{
+					Swap(First, Second);
+				}
+				Lines->AddLine(Last, First, Plot.Color, HitProxyId);
+			}
+			if (First.Y != Second.Y)
+			{
+				Lines->AddLine(First, Second, Plot.Color, HitProxyId);
+			}
+			Last = Second;
+		}
+		++Counters.Items;
+	}
+	++Counters.Batches;
+}
+
+void FCustomViewportClient::DrawSelection(FCanvas* Canvas, const FCanvasRenderSnapshot& Snapshot)
+{
+	if (Snapshot.SelectionBounds.Num() == 0 && !Snapshot.Marquee.bIsValid)
+	{
+		return;
+	}
+
+	// Outlined in screen space so the outline keeps its width whatever the zoom
+	const FLinearColor SelectionColor(1.f, 0.6f, 0.f);
+	const FHitProxyId HitProxyId = Canvas->GetHitProxyId();
+	FBatchedElements* Lines = Canvas->GetBatchedElements(FCanvas::ET_Line);
+	auto AddRect = [Lines, &HitProxyId](const FVector2D& Min, const FVector2D& Max, const FLinearColor& Color)
+	{
+		Lines->AddLine(FVector(Min.X, Min.Y, 0.f), FVector(Max.X, Min.Y, 0.f), Color, HitProxyId);
+		Lines->AddLine(FVector(Max.X, Min.Y, 0.f), FVector(Max.X, Max.Y, 0.f), Color, HitProxyId);
+		Lines->AddLine(FVector(Max.X, Max.Y, 0.f), FVector(Min.X, Max.Y, 0.f), Color, HitProxyId);
+		Lines->AddLine(FVector(Min.X, Max.Y, 0.f), FVector(Min.X, Min.Y, 0.f), Color, HitProxyId);
+	};
+
+	Lines->AddReserveLines((Snapshot.SelectionBounds.Num() + 1) * 4);
+	for (const FBox2D& Bounds : Snapshot.SelectionBounds)
+	{
+		AddRect((Bounds.Min - Snapshot.CameraOffset) * Snapshot.CameraZoom, (Bounds.Max - Snapshot.CameraOffset) * Snapshot.CameraZoom, SelectionColor);
+	}
+	if (Snapshot.Marquee.bIsValid)
+	{
+		AddRect(Snapshot.Marquee.Min, Snapshot.Marquee.Max, FLinearColor::White);
+	}
+}
+
+void FCustomViewportClient::DrawStats(FCanvas* Canvas)
 {
-	if (SceneViewport.IsValid())
+	const FTextureCacheStats& CacheStats = TextureCache->GetStats();
+	const FCanvasCommandQueueStats QueueStats = Commands->GetStats();
+	const FCanvasAtlasStats& AtlasStats = TextureAtlas->GetStats();
+	const FCanvasJournal& ViewedJournal = MirrorSource.IsValid() ? MirrorSource->Journal : Journal;
+	const FString Lines[] =
+	{
+		FString::Printf(TEXT("Draw %.2f ms, %d items in %d batches (%s)"), LastDrawTime, SubmittedItems, SubmittedBatches,
+			DrawMode == ECanvasDrawMode::Batched ? TEXT("batched") : TEXT("per item")),
+		FString::Printf(TEXT("Scene %d items, %d visible, %d culled%s"), GetViewedScene().Num(), VisibleItems, CulledItems,
+			MirrorSource.IsValid() ? TEXT(", mirrored") : TEXT("")),
+		FString::Printf(TEXT("Frames %llu rendered, %llu skipped"), RenderedFrames, SkippedFrames),
+		FString::Printf(TEXT("Textures %d, %.1f MB resident, %d hits, %d misses, %d loaded, %d failed, %.1f ms average load"),
+			TextureCache->Num(), CacheStats.ResidentBytes / (1024.0 * 1024.0), CacheStats.Hits, CacheStats.Misses,
+			CacheStats.NumLoaded, CacheStats.NumFailed, CacheStats.GetAverageLatency() * 1000.0),
+		FString::Printf(TEXT("Commands %lld queued, %lld dropped, high water %d of %d"),
+			QueueStats.NumEnqueued, QueueStats.NumDropped, QueueStats.HighWater, QueueStats.Capacity),
+		FString::Printf(TEXT("Atlas %d pages, %d textures, %.0f%% occupied, %d rejected, %.1f MB"),
+			AtlasStats.NumPages, AtlasStats.NumEntries, AtlasStats.GetOccupancy() * 100.f, AtlasStats.NumRejected,
+			AtlasStats.ResidentBytes / (1024.0 * 1024.0)),
+		FString::Printf(TEXT("Journal %d undo, %d redo, %d deltas, %.1f MB"), ViewedJournal.NumUndo(), ViewedJournal.NumRedo(),
+			ViewedJournal.NumDeltas(), ViewedJournal.GetAllocatedSize() / (1024.0 * 1024.0)),
+	};
+
+	FCanvasTextItem TextItem(FVector2D(8.f, 8.f), FText::GetEmpty(), GEngine->GetSmallFont(), FLinearColor::Yellow);
+	TextItem.EnableShadow(FLinearColor::Black);
+	for (const FString& Line : Lines)
+	{
+		TextItem.Text = FText::FromString(Line);
+		Canvas->DrawItem(TextItem);
+		TextItem.Position.Y += GEngine->GetSmallFont()->GetMaxCharHeight() + 2.f;
+	}
+}
+
+bool FCustomViewportClient::InputKey(const FInputKeyEventArgs& EventArgs)
+{
+	if (EventArgs.Key == EKeys::MouseScrollUp || EventArgs.Key == EKeys::MouseScrollDown)
+	{
+		if (EventArgs.Event == IE_Pressed)
+		{
+			const FVector2D Anchor(EventArgs.Viewport->GetMouseX(), EventArgs.Viewport->GetMouseY());
+			ZoomAt(Anchor, EventArgs.Key == EKeys::MouseScrollUp ? 1.f : -1.f);
+		}
+		return true;
+	}
+
+	if (EventArgs.Key == EKeys::LeftMouseButton && !MirrorSource.IsValid())
+	{
+		const FIntPoint MousePosition(EventArgs.Viewport->GetMouseX(), EventArgs.Viewport->GetMouseY());
+		if (EventArgs.Event == IE_Pressed)
+		{
+			bSelecting = true;
+			bAddToSelection = EventArgs.Viewport->KeyState(EKeys::LeftShift) || EventArgs.Viewport->KeyState(EKeys::RightShift);
+			SelectionStart = MousePosition;
+			LastMousePosition = MousePosition;
+		}
+		else if (EventArgs.Event == IE_Released && bSelecting)
+		{
+			bSelecting = false;
+			if ((MousePosition - SelectionStart).SizeSquared() <= FMath::Square(SelectionDragThreshold))
+			{
+				SelectAt(FVector2D(MousePosition), bAddToSelection);
+			}
+			else
+			{
+				SelectInRect(FVector2D(SelectionStart), FVector2D(MousePosition), bAddToSelection);
+			}
+		}
+		return true;
+	}
+
+	if (EventArgs.Key == EKeys::RightMouseButton || EventArgs.Key == EKeys::MiddleMouseButton)
+	{
+		if (EventArgs.Event == IE_Pressed)
+		{
+			bPanning = true;
+			LastMousePosition = FIntPoint(EventArgs.Viewport->GetMouseX(), EventArgs.Viewport->GetMouseY());
+		}
+		else if (EventArgs.Event == IE_Released)
+		{
+			bPanning = false;
+		}
+		return true;
+	}
+
+	const bool bControl = EventArgs.Viewport->KeyState(EKeys::LeftControl) || EventArgs.Viewport->KeyState(EKeys::RightControl);
+	if ((EventArgs.Key == EKeys::Z || EventArgs.Key == EKeys::Y) && bControl && !MirrorSource.IsValid())
+	{
+		if (EventArgs.Event == IE_Pressed || EventArgs.Event == IE_Repeat)
+		{
+			const bool bShift = EventArgs.Viewport->KeyState(EKeys::LeftShift) || EventArgs.Viewport->KeyState(EKeys::RightShift);
+			if (EventArgs.Key == EKeys::Y || bShift)
+			{
+				Redo();
+			}
+			else
+			{
+				Undo();
+			}
+		}
+		return true;
+	}
+
+	if (EventArgs.Key == EKeys::Home && EventArgs.Event == IE_Pressed)
+	{
+		SetCamera(FVector2D::ZeroVector, 1.f);
+		return true;
+	}
+
+	return false;
+}
+
+bool FCustomViewportClient::InputAxis(FViewport* Viewport, int32 ControllerId, FKey Key, float Delta, float DeltaTime, int32 NumSamples, bool bGamepad)
+{
+	// Panning is driven by absolute mouse positions in MouseMove, axis deltas only handle gamepad style input
+	if (bGamepad && (Key == EKeys::Gamepad_RightX || Key == EKeys::Gamepad_RightY))
+	{
+		const float PanSpeed = 600.f / CameraZoom;
+		const FVector2D PanDelta = Key == EKeys::Gamepad_RightX ? FVector2D(Delta, 0.f) : FVector2D(0.f, -Delta);
+		SetCamera(CameraOffset + PanDelta * PanSpeed * DeltaTime, CameraZoom);
+		return true;
+	}
+	return false;
+}
+
+void FCustomViewportClient::MouseMove(FViewport* Viewport, int32 X, int32 Y)
+{
+	CapturedMouseMove(Viewport, X, Y);
+}
+
+void FCustomViewportClient::CapturedMouseMove(FViewport* Viewport, int32 X, int32 Y)
+{
+	const FIntPoint MousePosition(X, Y);
+	if (bPanning && MousePosition != LastMousePosition)
+	{
+		SetCamera(CameraOffset - FVector2D(MousePosition - LastMousePosition) / CameraZoom, CameraZoom);
+	}
+	if (bSelecting && MousePosition != LastMousePosition)
+	{
+		// Redraw the marquee
+		MarkDirty();
+	}
+	LastMousePosition = MousePosition;
+}
+
+/** The atlas page when the tile texture was packed, the texture itself otherwise */
+static const UTexture* GetTileTexture(const FTileInstance& Tile)
+{
+	return Tile.AtlasPage ? Tile.AtlasPage : Tile.Texture;
+}
+
+void FCustomViewportClient::DrawTiles(FCanvas* Canvas, const FCanvasRenderSnapshot& Snapshot, TArrayView<const int32> Tiles, FCanvasDrawCounters& Counters)
+{
+	if (Tiles.Num() == 0)
+	{
+		return;
+	}
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(FCustomViewportClient::DrawTiles);
+	Counters.Items += Tiles.Num();
+
+	const TArray<FTileInstance>& SceneTiles = *Snapshot.Tiles;
+	const ESimpleElementBlendMode TileBlendMode = ESimpleElementBlendMode::SE_BLEND_AlphaBlend;
+	if (Snapshot.DrawMode == ECanvasDrawMode::PerItem)
+	{
+		FCanvasTileItem TileItem(FVector2D::ZeroVector, nullptr, FVector2D::UnitVector, FLinearColor::White);
+		TileItem.BlendMode = TileBlendMode;
+		for (int32 Index : Tiles)
+		{
+			const FTileInstance& Tile = SceneTiles[Index];
+			const UTexture* Texture = GetTileTexture(Tile);
+			TileItem.Position = Tile.Position;
+			TileItem.Size = Tile.Size;
+			TileItem.Texture = Texture ? Texture->GetResource() : GWhiteTexture;
+			TileItem.UV0 = Tile.UVMin;
+			TileItem.UV1 = Tile.UVMax;
+			TileItem.SetColor(Tile.Color);
+			Canvas->DrawItem(TileItem);
+		}
+		Counters.Batches += Tiles.Num();
+		return;
+	}
+
+	// Overlapping tiles must keep their array order, so only runs that already share a texture or atlas page are merged;
+	// sorting by texture would order overlaps by pointer value, which changes between runs
+	const FHitProxyId HitProxyId = Canvas->GetHitProxyId();
+	for (int32 RunStart = 0; RunStart < Tiles.Num();)
+	{
+		const UTexture* Texture = GetTileTexture(SceneTiles[Tiles[RunStart]]);
+		int32 RunEnd = RunStart + 1;
+		while (RunEnd < Tiles.Num() && GetTileTexture(SceneTiles[Tiles[RunEnd]]) == Texture)
+		{
+			++RunEnd;
+		}
+
+		++Counters.Batches;
+		const FTexture* Resource = Texture ? Texture->GetResource() : GWhiteTexture;
+		FBatchedElements* Triangles = Canvas->GetBatchedElements(FCanvas::ET_Triangle, nullptr, Resource, TileBlendMode);
+		Triangles->AddReserveVertices((RunEnd - RunStart) * 4);
+		Triangles->AddReserveTriangles((RunEnd - RunStart) * 2, Resource, TileBlendMode);
+
+		for (int32 RunIndex = RunStart; RunIndex < RunEnd; ++RunIndex)
+		{
+			const FTileInstance& Tile = SceneTiles[Tiles[RunIndex]];
+			const FVector2D Min = Tile.Position;
+			const FVector2D Max = Tile.Position + Tile.Size;
+			const int32 V0 = Triangles->AddVertex(FVector4(Min.X, Min.Y, 0.f, 1.f), FVector2D(Tile.UVMin.X, Tile.UVMin.Y), Tile.Color, HitProxyId);
+			const int32 V1 = Triangles->AddVertex(FVector4(Max.X, Min.Y, 0.f, 1.f), FVector2D(Tile.UVMax.X, Tile.UVMin.Y), Tile.Color, HitProxyId);
+			const int32 V2 = Triangles->AddVertex(FVector4(Min.X, Max.Y, 0.f, 1.f), FVector2D(Tile.UVMin.X, Tile.UVMax.Y), Tile.Color, HitProxyId);
+			const int32 V3 = Triangles->AddVertex(FVector4(Max.X, Max.Y, 0.f, 1.f), FVector2D(Tile.UVMax.X, Tile.UVMax.Y), Tile.Color, HitProxyId);
+			Triangles->AddTriangle(V0, V1, V2, Resource, TileBlendMode);
+			Triangles->AddTriangle(V2, V1, V3, Resource, TileBlendMode);
+		}
+
+		RunStart = RunEnd;
+	}
+}
+
+void FCustomViewportClient::DrawBoxes(FCanvas* Canvas, const FCanvasRenderSnapshot& Snapshot, TArrayView<const int32> Boxes, FCanvasDrawCounters& Counters)
+{
+	if (Boxes.Num() == 0)
+	{
+		return;
+	}
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(FCustomViewportClient::DrawBoxes);
+	Counters.Items += Boxes.Num();
+
+	const TArray<FBoxInstance>& SceneBoxes = *Snapshot.Boxes;
+	if (Snapshot.DrawMode == ECanvasDrawMode::PerItem)
+	{
+		FCanvasBoxItem BoxItem(FVector2D::ZeroVector, FVector2D::UnitVector);
+		for (int32 Index : Boxes)
+		{
+			const FBoxInstance& Box = SceneBoxes[Index];
+			BoxItem.Position = Box.Position;
+			BoxItem.Size = Box.Size;
+			BoxItem.LineThickness = Box.Thickness;
+			BoxItem.SetColor(Box.Color);
+			Canvas->DrawItem(BoxItem);
+		}
+		Counters.Batches += Boxes.Num();
+		return;
+	}
+
+	++Counters.Batches;
+
+	const FHitProxyId HitProxyId = Canvas->GetHitProxyId();
+	int32 NumThickBoxes = 0;
+	for (int32 Index : Boxes)
+	{
+		NumThickBoxes += SceneBoxes[Index].Thickness > 0.f ? 1 : 0;
+	}
+
+	FBatchedElements* Lines = Canvas->GetBatchedElements(FCanvas::ET_Line);
+	Lines->AddReserveLines((Boxes.Num() - NumThickBoxes) * 4, false, false);
+	Lines->AddReserveLines(NumThickBoxes * 4, false, true);
+
+	for (int32 Index : Boxes)
+	{
+		const FBoxInstance& Box = SceneBoxes[Index];
+		const FVector TopLeft(Box.Position.X, Box.Position.Y, 0.f);
+		const FVector TopRight(Box.Position.X + Box.Size.X, Box.Position.Y, 0.f);
+		const FVector BottomRight(Box.Position.X + Box.Size.X, Box.Position.Y + Box.Size.Y, 0.f);
+		const FVector BottomLeft(Box.Position.X, Box.Position.Y + Box.Size.Y, 0.f);
+		Lines->AddLine(TopLeft, TopRight, Box.Color, HitProxyId, Box.Thickness);
+		Lines->AddLine(TopRight, BottomRight, Box.Color, HitProxyId, Box.Thickness);
+		Lines->AddLine(BottomRight, BottomLeft, Box.Color, HitProxyId, Box.Thickness);
+		Lines->AddLine(BottomLeft, TopLeft, Box.Color, HitProxyId, Box.Thickness);
+	}
+}
+
+void FCustomViewportClient::DrawTexts(FCanvas* Canvas, const FCanvasRenderSnapshot& Snapshot, TArrayView<const int32> Texts, FCanvasDrawCounters& Counters)
+{
+	if (Texts.Num() == 0)
+	{
+		return;
+	}
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(FCustomViewportClient::DrawTexts);
+	Counters.Items += Texts.Num();
+	const TArray<FTextInstance>& SceneTexts = *Snapshot.Texts;
+	FCanvasTextItem TextItem(FVector2D::ZeroVector, FText::GetEmpty(), GEngine->GetSmallFont(), FLinearColor::White);
+	const FHitProxyId HitProxyId = Canvas->GetHitProxyId();
+	const FTexture* LastGlyphResource = nullptr;
+
+	for (int32 Index : Texts)
+	{
+		const FTextInstance& Text = SceneTexts[Index];
+		if (Snapshot.DrawMode != ECanvasDrawMode::PerItem && Text.ShapedText.IsValid())
+		{
+			FCanvasShapedTextItem ShapedTextItem(Text.Position, Text.ShapedText.ToSharedRef(), Text.Color);
+			ShapedTextItem.Scale = Text.Scale;
+			Canvas->DrawItem(ShapedTextItem);
+			++Counters.Batches;
+			LastGlyphResource = nullptr;
+			continue;
+		}
+		if (Snapshot.DrawMode == ECanvasDrawMode::PerItem || Text.Glyphs.Num() == 0)
+		{
+			TextItem.Position = Text.Position;
+			TextItem.Text = Text.Message;
+			TextItem.Font = Text.Font;
+			TextItem.Scale = Text.Scale;
+			TextItem.SetColor(Text.Color);
+			Canvas->DrawItem(TextItem);
+			++Counters.Batches;
+			LastGlyphResource = nullptr;
+			continue;
+		}
+
+		// Replay the cached glyph quads, the canvas keeps appending to the same batch while the font page doesn't change
+		const ESimpleElementBlendMode BlendMode = Text.Font->ImportOptions.bUseDistanceFieldAlpha
+			? ESimpleElementBlendMode::SE_BLEND_TranslucentDistanceField
+			: ESimpleElementBlendMode::SE_BLEND_Translucent;
+		for (const FCanvasGlyphQuad& Glyph : Text.Glyphs)
+		{
+			const FTexture* Resource = Text.Font->Textures[Glyph.TextureIndex]->GetResource();
+			if (!Resource)
+			{
+				continue;
+			}
+			if (Resource != LastGlyphResource)
+			{
+				++Counters.Batches;
+				LastGlyphResource = Resource;
+			}
+
+			const FVector2D Min = Text.Position + Glyph.Min;
+			const FVector2D Max = Text.Position + Glyph.Max;
+			FBatchedElements* Triangles = Canvas->GetBatchedElements(FCanvas::ET_Triangle, nullptr, Resource, BlendMode);
+			const int32 V0 = Triangles->AddVertex(FVector4(Min.X, Min.Y, 0.f, 1.f), FVector2D(Glyph.UVMin.X, Glyph.UVMin.Y), Text.Color, HitProxyId);
+			const int32 V1 = Triangles->AddVertex(FVector4(Max.X, Min.Y, 0.f, 1.f), FVector2D(Glyph.UVMax.X, Glyph.UVMin.Y), Text.Color, HitProxyId);
+			const int32 V2 = Triangles->AddVertex(FVector4(Min.X, Max.Y, 0.f, 1.f), FVector2D(Glyph.UVMin.X, Glyph.UVMax.Y), Text.Color, HitProxyId);
+			const int32 V3 = Triangles->AddVertex(FVector4(Max.X, Max.Y, 0.f, 1.f), FVector2D(Glyph.UVMax.X, Glyph.UVMax.Y), Text.Color, HitProxyId);
+			Triangles->AddTriangle(V0, V1, V2, Resource, BlendMode);
+			Triangles->AddTriangle(V2, V1, V3, Resource, BlendMode);
+		}
+	}
+}
+
+FCanvasItemHandle FCustomViewportClient::AddBox(const FBoxData& Data)
+{
+	return AddItem(Data);
+}
+
+FCanvasItemHandle FCustomViewportClient::AddText(const FTextData& Data)
+{
+	return AddItem(Data);
+}
+
+FCanvasItemHandle FCustomViewportClient::AddTile(const FTileData& Data)
+{
+	return AddItem(Data);
+}
+
+template<typename FuncType>
+bool FCustomViewportClient::VisitItem(FCanvasItemHandle Handle, FuncType&& Func)
+{
+	const ECanvasItemType ItemType = Scene.GetType(Handle);
+	bool bFound = false;
+	FCanvasPrimitives::ForEach([this, Handle, ItemType, &Func, &bFound](auto Primitive)
+	{
+		using InstanceType = typename decltype(Primitive)::InstanceType;
+		if (ItemType == decltype(Primitive)::Type)
+		{
+			Func(*Scene.Edit<InstanceType>(Handle));
+			bFound = true;
+		}
+	});
+	return bFound;
+}
+
+template<typename FuncType>
+bool FCustomViewportClient::EditItem(FCanvasItemHandle Handle, FuncType&& Func)
+{
+	if (!VisitItem(Handle, Forward<FuncType>(Func)))
+	{
+		return false;
+	}
+
+	Scene.UpdateBounds(Handle.Slot);
+	MarkDirty();
+	return true;
+}
+
+static FVector4f MakeDeltaValue(const FVector2D& Value)
+{
+	return FVector4f(Value.X, Value.Y, 0.f, 0.f);
+}
+
+static FVector4f MakeDeltaValue(const FLinearColor& Value)
+{
+	return FVector4f(Value.R, Value.G, Value.B, Value.A);
+}
+
+bool FCustomViewportClient::SetItemPosition(FCanvasItemHandle Handle, const FVector2D& Position)
+{
+	FVector2D Before;
+	if (!EditItem(Handle, [&Position, &Before](auto& Item) { Before = Item.Position; Item.Position = Position; }))
+	{
+		return false;
+	}
+
+	RecordProperty(Handle, ECanvasDeltaProperty::Position, MakeDeltaValue(Before), MakeDeltaValue(Position));
+	return true;
+}
+
+bool FCustomViewportClient::SetItemColor(FCanvasItemHandle Handle, const FLinearColor& Color)
+{
+	FLinearColor Before;
+	if (!EditItem(Handle, [&Color, &Before](auto& Item) { Before = Item.Color; Item.Color = Color; }))
+	{
+		return false;
+	}
+
+	RecordProperty(Handle, ECanvasDeltaProperty::Color, MakeDeltaValue(Before), MakeDeltaValue(Color));
+	return true;
+}
+
+bool FCustomViewportClient::SetItemSize(FCanvasItemHandle Handle, const FVector2D& Size)
+{
+	FVector2D Before;
+	if (FBoxInstance* Box = Scene.Edit<FBoxInstance>(Handle))
+	{
+		Before = Box->Size;
+		Box->Size = Size;
+	}
+	else if (FTileInstance* Tile = Scene.Edit<FTileInstance>(Handle))
+	{
+		// Same convention as AddTile, the width follows the texture aspect ratio
+		Before = Tile->Size;
+		Tile->Size = Size;
+		if (Tile->Texture)
+		{
+			const float TextureRatio = static_cast<float>(Tile->Texture->GetSizeX()) / Tile->Texture->GetSizeY();
+			Before.X /= TextureRatio;
+			Tile->Size.X *= TextureRatio;
+		}
+	}
+	else
+	{
+		return false;
+	}
+
+	Scene.UpdateBounds(Handle.Slot);
+	MarkDirty();
+	RecordProperty(Handle, ECanvasDeltaProperty::Size, MakeDeltaValue(Before), MakeDeltaValue(Size));
+	return true;
+}
+
+bool FCustomViewportClient::SetItemText(FCanvasItemHandle Handle, const FString& Message)
+{
+	FTextInstance* Text = Scene.Edit<FTextInstance>(Handle);
+	if (!Text)
+	{
+		return false;
+	}
+
+	if (!bApplyingDeltas)
+	{
+		// A replace rather than a property, the message doesn't fit in a property value
+		FTextData Data;
+		GetItemData(Handle, Data);
+		DeltaBefore.Reset();
+		DeltaAfter.Reset();
+		CanvasDelta::WriteItem(Data, DeltaBefore);
+		Data.Message = Message;
+		CanvasDelta::WriteItem(Data, DeltaAfter);
+		RecordDelta(FCanvasDelta{ ECanvasDeltaOp::Replace, ECanvasItemType::Text, ECanvasDeltaProperty::None, DeltaBefore, DeltaAfter });
+	}
+
+	Text->Message = FText::FromString(Message);
+	BuildTextLayout(*Text);
+	Scene.UpdateBounds(Handle.Slot);
+	MarkDirty();
+	return true;
+}
+
+void FCustomViewportClient::Animate(FCanvasItemHandle Handle, ECanvasAnimatedProperty Property, const FVector4f& From, const FVector4f& To, float Duration, ECanvasAnimationLoop Loop)
+{
+	if (!Scene.IsValid(Handle))
+	{
+		return;
+	}
+
+	FCanvasAnimationTrack* Track = AnimationTracks.FindByPredicate([Handle, Property](const FCanvasAnimationTrack& Existing)
+	{
+		return Existing.Handle == Handle && Existing.Property == Property;
+	});
+	if (!Track)
+	{
+		Track = &AnimationTracks.AddDefaulted_GetRef();
+	}
+
+	Track->Handle = Handle;
+	Track->Property = Property;
+	Track->From = From;
+	Track->To = To;
+	Track->StartTime = FPlatformTime::Seconds();
+	Track->Duration = Duration;
+	Track->Loop = Loop;
+}
+
+void FCustomViewportClient::AnimatePosition(FCanvasItemHandle Handle, const FVector2D& From, const FVector2D& To, float Duration, ECanvasAnimationLoop Loop)
+{
+	Animate(Handle, ECanvasAnimatedProperty::Position, FVector4f(From.X, From.Y, 0.f, 0.f), FVector4f(To.X, To.Y, 0.f, 0.f), Duration, Loop);
+}
+
+void FCustomViewportClient::AnimateColor(FCanvasItemHandle Handle, const FLinearColor& From, const FLinearColor& To, float Duration, ECanvasAnimationLoop Loop)
+{
+	Animate(Handle, ECanvasAnimatedProperty::Color, FVector4f(From.R, From.G, From.B, From.A), FVector4f(To.R, To.G, To.B, To.A), Duration, Loop);
+}
+
+void FCustomViewportClient::StopAnimations(FCanvasItemHandle Handle)
+{
+	AnimationTracks.RemoveAllSwap([Handle](const FCanvasAnimationTrack& Track) { return Track.Handle == Handle; }, false);
+}
+
+void FCustomViewportClient::TickAnimations(double Time)
+{
+	if (AnimationTracks.Num() == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_CustomWindow_Animate);
+	for (int32 Index = 0; Index < AnimationTracks.Num();)
+	{
+		const FCanvasAnimationTrack& Track = AnimationTracks[Index];
+		bool bFinished = false;
+		const float Alpha = GetCanvasAnimationAlpha(Track, Time, bFinished);
+		const FVector4f Value = FMath::Lerp(Track.From, Track.To, Alpha);
+
+		const bool bApplied = VisitItem(Track.Handle, [&Track, &Value](auto& Item) { ApplyCanvasAnimationValue(Item, Track.Property, Value); });
+
+		if (bApplied && Track.Property != ECanvasAnimatedProperty::Color)
+		{
+			Scene.UpdateBounds(Track.Handle.Slot);
+		}
+
+		// Tracks of removed items go away here as well
+		if (!bApplied || bFinished)
+		{
+			AnimationTracks.RemoveAtSwap(Index, 1, false);
+		}
+		else
+		{
+			++Index;
+		}
+	}
+	MarkDirty();
+}
+
+FBoxInstance FCustomViewportClient::MakeInstance(const FBoxData& Data)
+{
+	FBoxInstance Box;
+	Box.Position = Data.Position;
+	Box.Size = Data.Size;
+	Box.Color = Data.Color;
+	Box.Thickness = Data.Thickness;
+	Box.Layer = Data.Layer;
+	return Box;
+}
+
+FTextInstance FCustomViewportClient::MakeInstance(const FTextData& Data)
+{
+	FTextInstance Text;
+	Text.Position = Data.Position;
+	Text.Scale = FVector2D(Data.FontSize);
+	Text.Color = Data.Color;
+	Text.Message = FText::FromString(Data.Message);
+	Text.Font = ResolveFont(Data.FontPath);
+	Text.Layer = Data.Layer;
+	BuildTextLayout(Text);
+	return Text;
+}
+
+FTextInstance FCustomViewportClient::MakeInstance(FTextData&& Data)
+{
+	FTextInstance Text;
+	Text.Position = Data.Position;
+	Text.Scale = FVector2D(Data.FontSize);
+	Text.Color = Data.Color;
+	Text.Message = FText::FromString(MoveTemp(Data.Message));
+	Text.Font = ResolveFont(Data.FontPath);
+	Text.Layer = Data.Layer;
+	BuildTextLayout(Text);
+	return Text;
+}
+
+FTileInstance FCustomViewportClient::MakeInstance(const FTileData& Data)
+{
+	FTileInstance Tile;
+	Tile.Position = Data.Position;
+	Tile.Size = Data.Size;
+	Tile.Color = Data.Color;
+	Tile.TexturePath = FName(Data.TexturePath);
+	Tile.Layer = Data.Layer;
+	Tile.Texture = TextureCache->Acquire(Tile.TexturePath);
+	if (Tile.Texture)
+	{
+		Tile.Size.X *= static_cast<float>(Tile.Texture->GetSizeX()) / Tile.Texture->GetSizeY();
+		AcquireAtlasRegion(Tile);
+	}
+	return Tile;
+}
+
+template<typename DataType>
+void FCustomViewportClient::ImportItems(TArrayView<DataType> Items)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CustomWindow_AddItems);
+	using InstanceType = decltype(MakeInstance(DeclVal<const DataType&>()));
+	FCanvasJournalScope Transaction(Journal);
+
+	TArray<FName> Names;
+	TArray<InstanceType> Instances;
+	Names.Reserve(Items.Num());
+	Instances.Reserve(Items.Num());
+
+	// An item replaces earlier items of the same name in the batch, skip those before they acquire resources that the
+	// scene would overwrite without releasing
+	TBitArray<> Replaced(false, Items.Num());
+	if (Items.Num() > 1)
+	{
+		TSet<FName> BatchNames;
+		BatchNames.Reserve(Items.Num());
+		for (int32 Index = Items.Num() - 1; Index >= 0; --Index)
+		{
+			bool bAlreadyInSet = false;
+			BatchNames.Add(Items[Index].Name, &bAlreadyInSet);
+			Replaced[Index] = bAlreadyInSet;
+		}
+	}
+
+	const bool bMayReplace = Scene.Num() > 0;
+	for (int32 Index = 0; Index < Items.Num(); ++Index)
+	{
+		if (Replaced[Index])
+		{
+			continue;
+		}
+
+		DataType& Data = Items[Index];
+		const FCanvasItemHandle Existing = bMayReplace ? Scene.Find(Data.Name) : FCanvasItemHandle();
+		RecordAdd(Data, Existing);
+		if (Scene.IsValid(Existing))
+		{
+			const InstanceType* Current = Scene.Get<InstanceType>(Existing);
+			if (!Current || Current->Layer != Data.Layer)
+			{
+				VacatedInBatch.Add(Existing);
+			}
+		}
+		Names.Add(Data.Name);
+		if constexpr (TIsConst<DataType>::Value)
+		{
+			Instances.Add(MakeInstance(Data));
+		}
+		else
+		{
+			Instances.Add(MakeInstance(MoveTemp(Data)));
+		}
+
+		if (bMayReplace)
+		{
+			ReleaseResources(Existing);
+		}
+	}
+
+	Scene.AddBatch(MakeArrayView(Names), MakeArrayView(Instances));
+	VacatedInBatch.Reset();
+}
+
+void FCustomViewportClient::AddBoxes(TArrayView<const FBoxData> Items)
+{
+	ImportItems(Items);
+	MarkDirty();
+}
+
+void FCustomViewportClient::AddBoxes(TArray<FBoxData>&& Items)
+{
+	ImportItems(MakeArrayView(Items));
+	MarkDirty();
+}
+
+void FCustomViewportClient::AddTexts(TArrayView<const FTextData> Items)
+{
+	ImportItems(Items);
+	MarkDirty();
+}
+
+void FCustomViewportClient::AddTexts(TArray<FTextData>&& Items)
+{
+	ImportItems(MakeArrayView(Items));
+	MarkDirty();
+}
+
+void FCustomViewportClient::AddTiles(TArrayView<const FTileData> Items)
+{
+	ImportItems(Items);
+	MarkDirty();
+}
+
+void FCustomViewportClient::AddTiles(TArray<FTileData>&& Items)
+{
+	ImportItems(MakeArrayView(Items));
+	MarkDirty();
+}
+
+int32 FCustomViewportClient::RemoveItems(TArrayView<const FName> Names)
+{
+	FCanvasJournalScope Transaction(Journal);
+	int32 NumRemoved = 0;
+	for (FName Name : Names)
+	{
+		const FCanvasItemHandle Handle = Scene.Find(Name);
+		RecordRemove(Handle);
+		ReleaseResources(Handle);
+		NumRemoved += Scene.Remove(Handle) ? 1 : 0;
+	}
+
+	if (NumRemoved > 0)
+	{
+		MarkDirty();
+	}
+	return NumRemoved;
+}
+
+void FCustomViewportClient::ApplyCommands()
+{
+	SCOPE_CYCLE_COUNTER(STAT_CustomWindow_ApplyCommands);
+	// Everything applied in a frame undoes together
+	FCanvasJournalScope Transaction(Journal);
+
+	// Bounded by the capacity so producers that keep up with the drain can't hold the game thread here
+	FCanvasCommand Command;
+	for (int32 Budget = Commands->GetCapacity(); Budget > 0 && Commands->Dequeue(Command); --Budget)
+	{
+		INC_DWORD_STAT(STAT_CustomWindow_CommandsApplied);
+		const FName Name = Visit([](const auto& Data) { return Data.Name; }, Command);
+		const SIZE_T Type = Command.GetIndex();
+
+		TTuple<SIZE_T, int32>* Pending = PendingNames.Find(Name);
+		if (Pending && Pending->Get<0>() != Type)
+		{
+			// The batches are applied one type after the other, flush so the earlier command for this name lands first
+			FlushPendingCommands();
+			Pending = nullptr;
+		}
+
+		auto Stage = [this, Name, Type, Pending](auto& PendingItems, auto& Data)
+		{
+			if (Pending)
+			{
+				PendingItems[Pending->Get<1>()] = MoveTemp(Data);
+			}
+			else
+			{
+				PendingNames.Add(Name, MakeTuple(Type, PendingItems.Add(MoveTemp(Data))));
+			}
+		};
+
+		bool bStaged = false;
+		FCanvasPrimitives::ForEach([this, &Command, &Stage, &bStaged](auto Primitive)
+		{
+			using DataType = typename decltype(Primitive)::DataType;
+			if (DataType* Data = Command.TryGet<DataType>())
+			{
+				Stage(PendingItems.Get<FCanvasPrimitives::GetIndex<DataType>()>(), *Data);
+				bStaged = true;
+			}
+		});
+		if (!bStaged && !Pending)
+		{
+			PendingNames.Add(Name, MakeTuple(Type, PendingRemoves.Add(Name)));
+		}
+	}
+	FlushPendingCommands();
+
+	const FCanvasCommandQueueStats Stats = Commands->GetStats();
+	if (Stats.NumDropped > ReportedDrops)
+	{
+		UE_LOG(LogCustomWindow, Warning, TEXT("Command queue full, dropped %lld commands (capacity %d, high water %d)"),
+			Stats.NumDropped - ReportedDrops, Stats.Capacity, Stats.HighWater);
+		ReportedDrops = Stats.NumDropped;
+	}
+}
+
+void FCustomViewportClient::FlushPendingCommands()
+{
+	if (PendingNames.Num() == 0)
+	{
+		return;
+	}
+
+	// Every pending name is unique, so the order between the batches doesn't matter
+	RemoveItems(PendingRemoves);
+	PendingRemoves.Reset();
+	FCanvasPrimitives::ForEach([this](auto Primitive)
+	{
+		using DataType = typename decltype(Primitive)::DataType;
+		TArray<DataType>& Items = PendingItems.Get<FCanvasPrimitives::GetIndex<DataType>()>();
+		ImportItems(MakeArrayView(Items));
+		Items.Reset();
+	});
+	PendingNames.Reset();
+	MarkDirty();
+}
+
+void FCustomViewportClient::ImportScene(const FCanvasSceneData& Data)
+{
+	FCanvasJournalScope Transaction(Journal);
+	FCanvasPrimitives::ForEach([this, &Data](auto Primitive)
+	{
+		ImportItems(MakeArrayView(Data.*decltype(Primitive)::Items));
+	});
+	MarkDirty();
+}
+
+void FCustomViewportClient::ImportScene(FCanvasSceneData&& Data)
+{
+	FCanvasJournalScope Transaction(Journal);
+	FCanvasPrimitives::ForEach([this, &Data](auto Primitive)
+	{
+		ImportItems(MakeArrayView(Data.*decltype(Primitive)::Items));
+	});
+	MarkDirty();
+}
+
+void FCustomViewportClient::ExportScene(FCanvasSceneData& OutData) const
+{
+	FCanvasPrimitives::ForEach([this, &OutData](auto Primitive)
+	{
+		using InstanceType = typename decltype(Primitive)::InstanceType;
+		auto& Items = OutData.*decltype(Primitive)::Items;
+		Items.Reset(Scene.GetItems<InstanceType>().Num());
+		for (const InstanceType& Instance : Scene.GetItems<InstanceType>())
+		{
+			if constexpr (TIsSame<InstanceType, FTileInstance>::Value)
+			{
+				if (IsPixelTile(Instance))
+				{
+					continue;
+				}
+			}
+			MakeData(Instance, Items.AddDefaulted_GetRef());
+		}
+	});
+}
+
+ECanvasItemType FCustomViewportClient::GetJournaledType(FCanvasItemHandle Handle) const
+{
+	const FTileInstance* Tile = Scene.Get<FTileInstance>(Handle);
+	return Tile && IsPixelTile(*Tile) ? ECanvasItemType::Num : Scene.GetType(Handle);
+}
+
+bool FCustomViewportClient::IsPixelTile(const FTileInstance& Tile) const
+{
+	return Tile.Texture && Tile.TexturePath.IsNone() && PixelTiles.ContainsByPredicate([&Tile](const FPixelTile& PixelTile)
+	{
+		return PixelTile.Handle.Slot == Tile.Slot && PixelTile.Texture.Get() == Tile.Texture;
+	});
+}
+
+void FCustomViewportClient::MakeData(const FBoxInstance& Box, FBoxData& OutData) const
+{
+	OutData.Name = Scene.GetName(Box.Slot);
+	OutData.Position = Box.Position;
+	OutData.Size = Box.Size;
+	OutData.Color = Box.Color;
+	OutData.Thickness = Box.Thickness;
+	OutData.Layer = Box.Layer;
+}
+
+void FCustomViewportClient::MakeData(const FTextInstance& Text, FTextData& OutData) const
+{
+	OutData.Name = Scene.GetName(Text.Slot);
+	OutData.Position = Text.Position;
+	OutData.FontSize = Text.Scale.X;
+	OutData.Color = Text.Color;
+	OutData.Message = Text.Message.ToString();
+	OutData.FontPath = Text.Font && Text.Font != GEngine->GetSmallFont() ? Text.Font->GetPathName() : FString();
+	OutData.Layer = Text.Layer;
+}
+
+void FCustomViewportClient::MakeData(const FTileInstance& Tile, FTileData& OutData) const
+{
+	OutData.Name = Scene.GetName(Tile.Slot);
+	OutData.Position = Tile.Position;
+	OutData.Size = Tile.Size;
+	if (Tile.Texture)
+	{
+		// Undo the aspect ratio applied when the texture became resident
+		OutData.Size.X /= static_cast<float>(Tile.Texture->GetSizeX()) / Tile.Texture->GetSizeY();
+	}
+	OutData.Color = Tile.Color;
+	OutData.TexturePath = Tile.TexturePath.ToString();
+	OutData.Layer = Tile.Layer;
+}
+
+FCanvasItemHandle FCustomViewportClient::SelectAt(const FVector2D& ScreenPosition, bool bAddToSelection)
+{
+	const FCanvasItemHandle Handle = Scene.Pick(ScreenToWorld(ScreenPosition));
+	if (!bAddToSelection)
+	{
+		Selection.Reset();
+	}
+	if (Scene.IsValid(Handle))
+	{
+		// Moved to the end so the last picked item is the one loaded into the settings
+		Selection.Remove(Handle);
+		Selection.Add(Handle);
+	}
+
+	MarkDirty();
+	OnSelectionChanged.Broadcast();
+	return Handle;
+}
+
+int32 FCustomViewportClient::SelectInRect(const FVector2D& ScreenStart, const FVector2D& ScreenEnd, bool bAddToSelection)
+{
+	FBox2D Rect(ForceInit);
+	Rect += ScreenToWorld(ScreenStart);
+	Rect += ScreenToWorld(ScreenEnd);
+
+	const int32 NumBefore = bAddToSelection ? Selection.Num() : 0;
+	if (!bAddToSelection)
+	{
+		Selection.Reset();
+	}
+	Scene.QueryRect(Rect, Selection);
+	if (bAddToSelection)
+	{
+		// Drop what was already selected, keeping the first occurrence
+		TSet<FCanvasItemHandle> Seen;
+		Seen.Reserve(Selection.Num());
+		Selection.RemoveAll([&Seen](FCanvasItemHandle Handle)
+		{
+			bool bAlreadySeen = false;
+			Seen.Add(Handle, &bAlreadySeen);
+			return bAlreadySeen;
+		});
+	}
+
+	MarkDirty();
+	OnSelectionChanged.Broadcast();
+	return Selection.Num() - NumBefore;
+}
+
+void FCustomViewportClient::ClearSelection()
+{
+	if (Selection.Num() > 0)
+	{
+		Selection.Reset();
+		MarkDirty();
+		OnSelectionChanged.Broadcast();
+	}
+}
+
+TSharedRef<FCanvasPlot, ESPMode::ThreadSafe> FCustomViewportClient::AddPlot(const FPlotData& Data)
+{
+	FCanvasPlotInstance* Plot = Plots.FindByPredicate([&Data](const FCanvasPlotInstance& Other) { return Other.Name == Data.Name; });
+	if (!Plot)
+	{
+		Plot = &Plots.AddDefaulted_GetRef();
+		Plot->Name = Data.Name;
+	}
+	if (!Plot->Buffer.IsValid() || Plot->Buffer->GetCapacity() != FCanvasPlot::AlignCapacity(Data.Capacity))
+	{
+		Plot->Buffer = MakeShared<FCanvasPlot, ESPMode::ThreadSafe>(Data.Capacity);
+	}
+	Plot->Position = Data.Position;
+	Plot->Size = Data.Size;
+	Plot->Color = Data.Color;
+	Plot->MinValue = Data.MinValue;
+	Plot->MaxValue = Data.MaxValue;
+	MarkDirty();
+	return Plot->Buffer.ToSharedRef();
+}
+
+TSharedPtr<FCanvasPlot, ESPMode::ThreadSafe> FCustomViewportClient::FindPlot(FName Name) const
+{
+	const FCanvasPlotInstance* Plot = Plots.FindByPredicate([Name](const FCanvasPlotInstance& Other) { return Other.Name == Name; });
+	return Plot ? Plot->Buffer : nullptr;
+}
+
+TSharedRef<FCanvasPixelBuffer, ESPMode::ThreadSafe> FCustomViewportClient::AddPixelTile(const FTileData& Data, const FIntPoint& Resolution)
+{
+	TSharedRef<FCanvasPixelBuffer, ESPMode::ThreadSafe> Buffer = MakeShared<FCanvasPixelBuffer, ESPMode::ThreadSafe>(Resolution);
+	const FIntPoint Size = Buffer->GetSize();
+	UTexture2D* Texture = UTexture2D::CreateTransient(Size.X, Size.Y, PF_B8G8R8A8);
+	Texture->SRGB = true;
+	Texture->Filter = TF_Nearest;
+	Texture->NeverStream = true;
+	Texture->UpdateResource();
+
+	// Not shared through the cache or packed in the atlas, every upload would touch a whole page
+	FTileData TileData = Data;
+	TileData.TexturePath.Reset();
+	FTileInstance Tile = MakeInstance(TileData);
+	Tile.Texture = Texture;
+	Tile.Size.X *= static_cast<float>(Size.X) / Size.Y;
+	const FCanvasItemHandle Existing = Scene.Find(Data.Name);
+	RecordRemove(Existing);
+	ReleaseResources(Existing);
+	const FCanvasItemHandle Handle = Scene.Add(Data.Name, MoveTemp(Tile));
+
+	// The whole buffer goes up on the first upload, the texture starts uninitialized
+	Buffer->Fill(FColor::Transparent);
+	PixelTiles.RemoveAll([this, Handle](FPixelTile& PixelTile)
+	{
+		if (PixelTile.Handle.Slot != Handle.Slot)
+		{
+			return false;
+		}
+		RetiredPixelTextures.Add(MoveTemp(PixelTile.Texture));
+		return true;
+	});
+	PixelTiles.Add({ Handle, Buffer, TStrongObjectPtr<UTexture2D>(Texture) });
+	MarkDirty();
+	return Buffer;
+}
+
+TSharedPtr<FCanvasPixelBuffer, ESPMode::ThreadSafe> FCustomViewportClient::FindPixelTile(FName Name) const
+{
+	const FCanvasItemHandle Handle = Scene.Find(Name);
+	const FPixelTile* PixelTile = PixelTiles.FindByPredicate([Handle](const FPixelTile& Other) { return Other.Handle == Handle; });
+	return PixelTile ? PixelTile->Buffer : nullptr;
+}
+
+bool FCustomViewportClient::UploadPixelTiles()
+{
+	bool bUploaded = false;
+	for (int32 Index = PixelTiles.Num() - 1; Index >= 0; --Index)
+	{
+		FPixelTile& PixelTile = PixelTiles[Index];
+		const FTileInstance* Tile = Scene.Get<FTileInstance>(PixelTile.Handle);
+		if (!Tile || Tile->Texture != PixelTile.Texture.Get())
+		{
+			RetiredPixelTextures.Add(MoveTemp(PixelTile.Texture));
+			PixelTiles.RemoveAtSwap(Index, 1, false);
+			continue;
+		}
+
+		const int64 NumPixels = PixelTile.Buffer->UploadDirtyRegions(PixelTile.Texture.Get());
+		INC_DWORD_STAT_BY(STAT_CustomWindow_PixelsUploaded, NumPixels);
+		bUploaded |= NumPixels > 0;
+	}
+	return bUploaded;
+}
+
+bool FCustomViewportClient::RemovePlot(FName Name)
+{
+	if (Plots.RemoveAll([Name](const FCanvasPlotInstance& Plot) { return Plot.Name == Name; }) == 0)
+	{
+		return false;
+	}
+
+	MarkDirty();
+	return true;
+}
+
+void FCustomViewportClient::ClearScene()
+{
+	for (const FTileInstance& Tile : Scene.GetItems<FTileInstance>())
+	{
+		ReleaseTileTextures(Tile);
+	}
+	Scene.Empty();
+	Selection.Reset();
+	AnimationTracks.Reset();
+	Plots.Reset();
+	for (FPixelTile& PixelTile : PixelTiles)
+	{
+		RetiredPixelTextures.Add(MoveTemp(PixelTile.Texture));
+	}
+	PixelTiles.Reset();
+	Journal.Reset();
+	if (Autosave.IsValid() && !bApplyingDeltas)
+	{
+		Autosave->Append(FCanvasDelta{ ECanvasDeltaOp::Clear });
+	}
+	MarkDirty();
+}
+
+void FCustomViewportClient::ApplyTexture(FName TexturePath, UTexture2D* Texture)
+{
+	// Broadcast to every client sharing the cache, most of them have no tile waiting for this texture
+	const float TextureRatio = static_cast<float>(Texture->GetSizeX()) / Texture->GetSizeY();
+	bool bChanged = false;
+	for (int32 Index = 0; Index < Scene.GetItems<FTileInstance>().Num(); ++Index)
+	{
+		const FTileInstance& SharedTile = Scene.GetItems<FTileInstance>()[Index];
+		if (SharedTile.TexturePath == TexturePath && SharedTile.Texture != Texture)
+		{
+			// Only copy the tile array away from the snapshot once a tile actually changes
+			FTileInstance& Tile = Scene.EditItems<FTileInstance>()[Index];
+			Tile.Texture = Texture;
+			Tile.Size.X *= TextureRatio;
+			AcquireAtlasRegion(Tile);
+			Scene.UpdateBounds(Tile.Slot);
+			bChanged = true;
+		}
+	}
+	if (bChanged)
+	{
+		MarkDirty();
+	}
+}
+
+const UFont* FCustomViewportClient::ResolveFont(const FString& FontPath)
+{
+	if (FontPath.IsEmpty())
+	{
+		return GEngine->GetSmallFont();
+	}
+
+	const FName FontKey(FontPath);
+	if (const TStrongObjectPtr<UFont>* Loaded = LoadedFonts.Find(FontKey))
+	{
+		return Loaded->Get();
+	}
+
+	// Fonts are small and picked by hand, loading them synchronously is fine unlike tile textures
+	UFont* Font = Cast<UFont>(FSoftObjectPath(FontPath).TryLoad());
+	if (!Font)
+	{
+		UE_LOG(LogCustomWindow, Warning, TEXT("Failed to load font %s, using the small font"), *FontPath);
+		return GEngine->GetSmallFont();
+	}
+
+	LoadedFonts.Emplace(FontKey, TStrongObjectPtr<UFont>(Font));
+	return Font;
+}
+
+void FCustomViewportClient::ReleaseResources(FCanvasItemHandle Handle)
+{
+	if (const FTileInstance* Tile = Scene.Get<FTileInstance>(Handle))
+	{
+		ReleaseTileTextures(*Tile);
+	}
+}
+
+void FCustomViewportClient::AcquireAtlasRegion(FTileInstance& Tile)
+{
+	FCanvasAtlasRegion Region;
+	if (TextureAtlas->Acquire(Tile.TexturePath, Tile.Texture, Region))
+	{
+		Tile.AtlasPage = Region.Page;
+		Tile.UVMin = Region.UVMin;
+		Tile.UVMax = Region.UVMax;
+	}
+}
+
+void FCustomViewportClient::ReleaseTileTextures(const FTileInstance& Tile)
+{
+	if (Tile.AtlasPage)
+	{
+		TextureAtlas->Release(Tile.TexturePath);
+	}
+	TextureCache->Release(Tile.TexturePath);
+}
+
+bool FCustomViewportClient::RemoveItem(FName Name)
+{
+	const FCanvasItemHandle Handle = Scene.Find(Name);
+	RecordRemove(Handle);
+	ReleaseResources(Handle);
+	if (!Scene.Remove(Handle))
+	{
+		return false;
+	}
+
+	MarkDirty();
+	return true;
+}
+
+bool FCustomViewportClient::Undo()
+{
+	return Journal.Undo([this](const FCanvasDelta& Delta)
+	{
+		ApplyDelta(Delta);
+		if (Autosave.IsValid())
+		{
+			Autosave->Append(Delta);
+		}
+	});
+}
+
+bool FCustomViewportClient::Redo()
+{
+	return Journal.Redo([this](const FCanvasDelta& Delta)
+	{
+		ApplyDelta(Delta);
+		if (Autosave.IsValid())
+		{
+			Autosave->Append(Delta);
+		}
+	});
+}
+
+void FCustomViewportClient::RecordDelta(const FCanvasDelta& Delta)
+{
+	Journal.Record(Delta);
+	if (Autosave.IsValid())
+	{
+		Autosave->Append(Delta);
+	}
+}
+
+void FCustomViewportClient::RecordRemove(FCanvasItemHandle Handle)
+{
+	const ECanvasItemType ItemType = GetJournaledType(Handle);
+	if (bApplyingDeltas || ItemType == ECanvasItemType::Num)
+	{
+		return;
+	}
+
+	DeltaBefore.Reset();
+	DeltaAfter.Reset();
+	FCanvasPrimitives::ForEach([this, Handle, ItemType](auto Primitive)
+	{
+		if (ItemType == decltype(Primitive)::Type)
+		{
+			typename decltype(Primitive)::DataType Data;
+			GetItemData(Handle, Data);
+			CanvasDelta::WriteItem(Data, DeltaBefore);
+		}
+	});
+	RecordDelta(FCanvasDelta{ ECanvasDeltaOp::Remove, ItemType, ECanvasDeltaProperty::None, DeltaBefore, DeltaAfter,
+		Scene.GetLayerPosition(Handle, VacatedInBatch) });
+}
+
+void FCustomViewportClient::RecordProperty(FCanvasItemHandle Handle, ECanvasDeltaProperty Property, const FVector4f& Before, const FVector4f& After)
+{
+	if (bApplyingDeltas || GetJournaledType(Handle) == ECanvasItemType::Num)
+	{
+		return;
+	}
+
+	const FName Name = Scene.GetName(Handle.Slot);
+	DeltaBefore.Reset();
+	DeltaAfter.Reset();
+	CanvasDelta::WriteProperty(Name, Before, DeltaBefore);
+	CanvasDelta::WriteProperty(Name, After, DeltaAfter);
+	RecordDelta(FCanvasDelta{ ECanvasDeltaOp::Property, Scene.GetType(Handle), Property, DeltaBefore, DeltaAfter });
+}
+
+void FCustomViewportClient::ApplyDelta(const FCanvasDelta& Delta)
+{
+	TGuardValue<bool> ApplyingDeltas(bApplyingDeltas, true);
+	switch (Delta.Op)
+	{
+	case ECanvasDeltaOp::Add:
+	case ECanvasDeltaOp::Replace:
+		FCanvasPrimitives::ForEach([this, &Delta](auto Primitive)
+		{
+			typename decltype(Primitive)::DataType Data;
+			if (Delta.Type == decltype(Primitive)::Type && CanvasDelta::ReadItem(Delta.After, Data))
+			{
+				const FCanvasItemHandle Handle = AddItem(Data);
+				if (Delta.AfterPosition != INDEX_NONE)
+				{
+					// Undoing a remove or a replace, the item goes back where it was instead of the end of its layer
+					Scene.SetLayerPosition(Handle, Delta.AfterPosition);
+				}
+			}
+		});
+		break;
+	case ECanvasDeltaOp::Remove:
+		RemoveItem(CanvasDelta::ReadName(Delta.Before));
+		break;
+	case ECanvasDeltaOp::Property:
+	{
+		FName Name;
+		FVector4f Value;
+		if (!CanvasDelta::ReadProperty(Delta.After, Name, Value))
+		{
+			break;
+		}
+
+		const FCanvasItemHandle Handle = Scene.Find(Name);
+		if (Delta.Property == ECanvasDeltaProperty::Position)
+		{
+			SetItemPosition(Handle, FVector2D(Value.X, Value.Y));
+		}
+		else if (Delta.Property == ECanvasDeltaProperty::Color)
+		{
+			SetItemColor(Handle, FLinearColor(Value.X, Value.Y, Value.Z, Value.W));
+		}
+		else if (Delta.Property == ECanvasDeltaProperty::Size)
+		{
+			SetItemSize(Handle, FVector2D(Value.X, Value.Y));
+		}
+		break;
+	}
+	case ECanvasDeltaOp::Clear:
+		ClearScene();
+		break;
+	}
+}
+
+void FCustomViewportClient::EnableAutosave(const FString& BasePath)
+{
+	DisableAutosave();
+
+	FCanvasSceneData Snapshot;
+	TArray<uint8> Log;
+	if (FCanvasAutosave::Load(BasePath, Snapshot, Log))
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		TGuardValue<bool> ApplyingDeltas(bApplyingDeltas, true);
+		ClearScene();
+		ImportScene(MoveTemp(Snapshot));
+		int32 NumDeltas = 0;
+		if (!FCanvasJournal::ReadDeltas(Log, [this, &NumDeltas](const FCanvasDelta& Delta) { ApplyDelta(Delta); ++NumDeltas; }))
+		{
+			UE_LOG(LogCustomWindow, Warning, TEXT("The autosave log of %s ends with a partial delta, restored up to it"), *BasePath);
+		}
+		UE_LOG(LogCustomWindow, Log, TEXT("Restored %d items and %d deltas from %s in %.1f ms"), Scene.Num(), NumDeltas, *BasePath,
+			(FPlatformTime::Seconds() - StartTime) * 1000.0);
+	}
+	Journal.Reset();
+
+	// The log starts over from the restored scene
+	Autosave = MakeUnique<FCanvasAutosave>(BasePath);
+	ExportScene(Snapshot);
+	Autosave->Compact(MoveTemp(Snapshot));
+	LastAutosaveTime = FPlatformTime::Seconds();
+}
+
+void FCustomViewportClient::DisableAutosave()
+{
+	if (Autosave.IsValid())
+	{
+		Autosave->Close([this](FCanvasSceneData& OutData) { ExportScene(OutData); });
+		Autosave.Reset();
+	}
+}
+
+void FCustomViewportClient::FlushAutosave()
+{
+	if (Autosave->IsWriting())
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_CustomWindow_Autosave);
+	if (Autosave->NeedsCompaction())
+	{
+		// Only copied here, the worker packs and writes it. The log has grown as large as the scene by now, so the copy
+		// costs about what recording the deltas already did
+		FCanvasSceneData Snapshot;
+		ExportScene(Snapshot);
+		Autosave->Compact(MoveTemp(Snapshot));
+	}
+	else
+	{
+		Autosave->Flush();
+	}
+}
+
+void FCustomViewportClient::SetBackgroundColor(const FLinearColor& InColor)
+{
+	if (!BackgroundColor.Equals(InColor))
+	{
+		BackgroundColor = InColor;
+		MarkDirty();
+	}
+}
+
+void FCustomViewportClient::SetDrawMode(ECanvasDrawMode InDrawMode)
+{
+	if (DrawMode != InDrawMode)
+	{
+		DrawMode = InDrawMode;
+		MarkDirty();
+	}
+}
+
+void FCustomViewportClient::SetCamera(const FVector2D& InOffset, float InZoom)
+{
+	InZoom = FMath::Clamp(InZoom, 0.02f, 64.f);
+	if (InOffset != CameraOffset || InZoom != CameraZoom)
+	{
+		CameraOffset = InOffset;
+		CameraZoom = InZoom;
+		MarkDirty();
+	}
+}
+
+void FCustomViewportClient::ZoomAt(const FVector2D& ScreenAnchor, float Steps)
+{
+	const FVector2D WorldAnchor = ScreenToWorld(ScreenAnchor);
+	const float NewZoom = FMath::Clamp(CameraZoom * FMath::Pow(1.15f, Steps), 0.02f, 64.f);
+	SetCamera(WorldAnchor - ScreenAnchor / NewZoom, NewZoom);
+}
+
+bool FCustomViewportClient::ConsumeRedraw(const FIntPoint& ViewportSize)
+{
+	SetDrawMode(CVarCustomWindowBatchedDraw.GetValueOnGameThread() ? ECanvasDrawMode::Batched : ECanvasDrawMode::PerItem);
+	if (MirrorSource.IsValid())
+	{
+		// The source keeps updating while only its mirrors are open
+		if (MirrorSource->LastSceneUpdateFrame != GFrameCounter)
+		{
+			MirrorSource->UpdateScene();
+		}
+		if (MirrorSource->GetVersion() != MirroredVersion)
+		{
+			MirroredVersion = MirrorSource->GetVersion();
+			bDirty = true;
+		}
+	}
+	UpdateScene();
+
+	if (ViewportSize != LastViewportSize)
+	{
+		LastViewportSize = ViewportSize;
+		bDirty = true;
+	}
+
+	// The HUD refreshes a few times per second on its own, without turning every frame into a redraw
+	const bool bShowStatsSetting = CVarCustomWindowShowStats.GetValueOnGameThread();
+	const double Now = FPlatformTime::Seconds();
+	if (bShowStatsSetting != bShowStats || (bShowStats && Now - LastStatsRefresh > 0.25))
+	{
+		bShowStats = bShowStatsSetting;
+		LastStatsRefresh = Now;
+		bDirty = true;
+	}
+
+	if (!bDirty && !bContinuousRedraw)
+	{
+		++SkippedFrames;
+		return false;
+	}
+
+	bDirty = false;
+	BuildSnapshot(ViewportSize);
+	return true;
+}
+
+void FCustomViewportClient::UpdateScene()
+{
+	LastSceneUpdateFrame = GFrameCounter;
+	ApplyCommands();
+	TickAnimations(FPlatformTime::Seconds());
+	TextureAtlas->FlushUploads();
+	if (TextureAtlas->GetStats().NumUploads != SeenAtlasUploads)
+	{
+		SeenAtlasUploads = TextureAtlas->GetStats().NumUploads;
+		MarkDirty();
+	}
+
+	uint64 PlotSamples = 0;
+	for (const FCanvasPlotInstance& Plot : Plots)
+	{
+		PlotSamples += Plot.Buffer->GetNumAppended();
+	}
+	if (PlotSamples != SeenPlotSamples)
+	{
+		SeenPlotSamples = PlotSamples;
+		MarkDirty();
+	}
+
+	if (UploadPixelTiles())
+	{
+		MarkDirty();
+	}
+
+	if (Capture.IsValid())
+	{
+		Capture->Update();
+	}
+
+	const float AutosaveInterval = CVarCustomWindowAutosaveInterval.GetValueOnGameThread();
+	if (Autosave.IsValid() && AutosaveInterval > 0.f && FPlatformTime::Seconds() - LastAutosaveTime >= AutosaveInterval)
+	{
+		LastAutosaveTime = FPlatformTime::Seconds();
+		FlushAutosave();
+	}
+}
+
+void FCustomViewportClient::FillSnapshot(FCanvasRenderSnapshot& Snapshot, const FVector2D& InCameraOffset, float InCameraZoom, const FIntPoint& TargetSize) const
+{
+	const FCanvasScene& ViewedScene = GetViewedScene();
+	Snapshot.Boxes = ViewedScene.ShareItems<FBoxInstance>();
+	Snapshot.Texts = ViewedScene.ShareItems<FTextInstance>();
+	Snapshot.Tiles = ViewedScene.ShareItems<FTileInstance>();
+	Snapshot.BackgroundColor = MirrorSource.IsValid() ? MirrorSource->BackgroundColor : BackgroundColor;
+	Snapshot.CameraOffset = InCameraOffset;
+	Snapshot.CameraZoom = InCameraZoom;
+	Snapshot.DrawMode = DrawMode;
+	Snapshot.bShowStats = false;
+	Snapshot.SelectionBounds.Reset();
+	Snapshot.Marquee = FBox2D(ForceInit);
+
+	const FBox2D VisibleRect(InCameraOffset, InCameraOffset + FVector2D(TargetSize) / InCameraZoom);
+	ViewedScene.QueryVisible(VisibleRect, Snapshot.VisibleBoxes, Snapshot.VisibleTexts, Snapshot.VisibleTiles);
+
+	// Decimated here rather than in Draw so the samples are read once per view change, on the game thread
+	SCOPE_CYCLE_COUNTER(STAT_CustomWindow_PlotDecimate);
+	int32 NumVisiblePlots = 0;
+	for (const FCanvasPlotInstance& Plot : MirrorSource.IsValid() ? MirrorSource->Plots : Plots)
+	{
+		const FBox2D Bounds(Plot.Position, Plot.Position + Plot.Size);
+		if (!Bounds.Intersect(VisibleRect))
+		{
+			continue;
+		}
+
+		if (Snapshot.Plots.Num() == NumVisiblePlots)
+		{
+			Snapshot.Plots.AddDefaulted();
+		}
+		FCanvasPlotSnapshot& PlotSnapshot = Snapshot.Plots[NumVisiblePlots++];
+		PlotSnapshot.Bounds = Bounds;
+		PlotSnapshot.Color = Plot.Color;
+		const int32 NumColumns = FMath::Clamp(FMath::CeilToInt(static_cast<float>(Plot.Size.X) * InCameraZoom), 1, MaxPlotColumns);
+		Plot.Buffer->Decimate(NumColumns, PlotSnapshot.Columns);
+
+		PlotSnapshot.MinValue = Plot.MinValue;
+		PlotSnapshot.MaxValue = Plot.MaxValue;
+		if (!(Plot.MinValue < Plot.MaxValue))
+		{
+			PlotSnapshot.MinValue = MAX_flt;
+			PlotSnapshot.MaxValue = -MAX_flt;
+			for (const FVector2f& MinMax : PlotSnapshot.Columns)
+			{
+				PlotSnapshot.MinValue = FMath::Min(PlotSnapshot.MinValue, MinMax.X);
+				PlotSnapshot.MaxValue = FMath::Max(PlotSnapshot.MaxValue, MinMax.Y);
+			}
+			if (!(PlotSnapshot.MinValue < PlotSnapshot.MaxValue))
+			{
+				// Flat or empty, centered
+				PlotSnapshot.MinValue = PlotSnapshot.Columns.Num() > 0 ? PlotSnapshot.MinValue - 1.f : 0.f;
+				PlotSnapshot.MaxValue = PlotSnapshot.MinValue + 2.f;
+			}
+		}
+	}
+	Snapshot.Plots.SetNum(NumVisiblePlots, false);
+}
+
+void FCustomViewportClient::BuildSnapshot(const FIntPoint& ViewportSize)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CustomWindow_BuildSnapshot);
+
+	// The scene no longer points at the retired textures, so neither does the new snapshot
+	RetiredPixelTextures.Reset();
+	FCanvasRenderSnapshot& Snapshot = RenderSnapshot;
+	FillSnapshot(Snapshot, CameraOffset, CameraZoom, ViewportSize);
+	Snapshot.bShowStats = bShowStats;
+
+	const FBox2D VisibleRect(ScreenToWorld(FVector2D::ZeroVector), ScreenToWorld(FVector2D(ViewportSize)));
+	VisibleItems = Snapshot.VisibleBoxes.Num() + Snapshot.VisibleTexts.Num() + Snapshot.VisibleTiles.Num();
+	CulledItems = GetViewedScene().Num() - VisibleItems;
+	SET_DWORD_STAT(STAT_CustomWindow_SceneItems, GetViewedScene().Num());
+	SET_DWORD_STAT(STAT_CustomWindow_VisibleItems, VisibleItems);
+	SET_DWORD_STAT(STAT_CustomWindow_CulledItems, CulledItems);
+
+	for (FCanvasItemHandle Handle : Selection)
+	{
+		const FBox2D Bounds = Scene.GetBounds(Handle);
+		if (Bounds.bIsValid && Bounds.Intersect(VisibleRect))
+		{
+			Snapshot.SelectionBounds.Add(Bounds);
+		}
+	}
+	if (bSelecting && (LastMousePosition - SelectionStart).SizeSquared() > FMath::Square(SelectionDragThreshold))
+	{
+		Snapshot.Marquee += FVector2D(SelectionStart);
+		Snapshot.Marquee += FVector2D(LastMousePosition);
+	}
+}
+
+void SCustomViewport::Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime)
+{
+	if (!SceneViewport.IsValid())
+	{
+		return;
+	}
+
+	if (!ViewportClient.IsValid() || ViewportClient->ConsumeRedraw(SceneViewport->GetSizeXY()))
 	{
 		SceneViewport->Invalidate();
 	}
 }
 
-void SCustomViewport::SetSceneViewport(TSharedPtr<FSceneViewport> InSceneViewport)
+void SCustomViewport::SetSceneViewport(TSharedPtr<FSceneViewport> InSceneViewport, TSharedPtr<FCustomViewportClient> InViewportClient)
 {
 	SceneViewport = InSceneViewport;
+	ViewportClient = InViewportClient;
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -0,0 +1,704 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CustomWindowBenchmarkCommandlet.h"
+
+#include "Async/Async.h"
+#include "CanvasCapture.h"
+#include "CanvasPixelBuffer.h"
+#include "CanvasPlot.h"
+#include "CanvasTypes.h"
+#include "CustomWindow.h"
+#include "Dom/JsonObject.h"
+#include "Engine/Texture2D.h"
+#include "HAL/IConsoleManager.h"
+#include "Interfaces/IPluginManager.h"
+#include "Math/RandomStream.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "RenderingThread.h"
+#include "RHI.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "UObject/StrongObjectPtr.h"
+#include <atomic>
+
+namespace CustomWindowBenchmark
+{
+	const FIntPoint ViewportSize(1920, 1080);
+	constexpr float Spacing = 20.f;
+
+	struct FResult
+	{
+		FString Case;
+		FString Type;
+		int32 Items = 0;
+		int32 Ops = 0;
+		double TotalMs = 0.0;
+		/** Case specific numbers, such as the batch count of a draw */
+		FString Detail;
+
+		double GetNsPerOp() const { return Ops > 0 ? TotalMs * 1000000.0 / Ops : 0.0; }
+	};
+
+	/** Only provides a size, the canvas is never flushed so nothing reaches the RHI */
+	class FBenchmarkRenderTarget : public FRenderTarget
+	{
+	public:
+		virtual FIntPoint GetSizeXY() const override { return ViewportSize; }
+	};
+
+	/** Slowest single pick allowed on scenes of up to PickTargetItems items */
+	constexpr double MaxPickTargetMs = 1.0;
+	constexpr int32 PickTargetItems = 100000;
+
+	struct FContext
+	{
+		int32 Iterations = 5;
+		TArray<FString> TexturePaths;
+		TArray<FResult> Results;
+		/** Targets that were missed, any of them fails the commandlet */
+		TArray<FString> Failures;
+
+		void Add(FResult&& Result)
+		{
+			UE_LOG(LogCustomWindow, Display, TEXT("%-24s %-8s %8d items %8d ops %10.2f ms %12.1f ns/op %s"),
+				*Result.Case, *Result.Type, Result.Items, Result.Ops, Result.TotalMs, Result.GetNsPerOp(), *Result.Detail);
+			Results.Add(MoveTemp(Result));
+		}
+	};
+
+	template<typename FuncType>
+	double TimeMs(FuncType&& Func)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		Func();
+		return (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	}
+
+	int32 GetColumns(int32 NumItems)
+	{
+		return FMath::Max(FMath::CeilToInt(FMath::Sqrt(static_cast<float>(NumItems))), 1);
+	}
+
+	FVector2D GetGridPosition(int32 Index, int32 NumItems)
+	{
+		const int32 Columns = GetColumns(NumItems);
+		return FVector2D((Index % Columns) * Spacing, (Index / Columns) * Spacing);
+	}
+
+	void FillItem(FBoxData& Item, int32 Index, int32 NumItems, FRandomStream& Random, const FContext& Context)
+	{
+		Item.Name = FName(TEXT("BenchBox"), Index + 1);
+		Item.Position = GetGridPosition(Index, NumItems);
+		Item.Size = FVector2D(16.f, 16.f);
+		Item.Color = FLinearColor(Random.FRand(), Random.FRand(), Random.FRand());
+		Item.Thickness = Index % 4 == 0 ? 2.f : 0.f;
+		Item.Layer = Random.RandRange(0, 7);
+	}
+
+	void FillItem(FTextData& Item, int32 Index, int32 NumItems, FRandomStream& Random, const FContext& Context)
+	{
+		Item.Name = FName(TEXT("BenchText"), Index + 1);
+		Item.Position = GetGridPosition(Index, NumItems);
+		Item.Color = FLinearColor(Random.FRand(), Random.FRand(), Random.FRand());
+		Item.Message = FString::Printf(TEXT("T%d"), Index);
+		Item.Layer = Random.RandRange(0, 7);
+	}
+
+	void FillItem(FTileData& Item, int32 Index, int32 NumItems, FRandomStream& Random, const FContext& Context)
+	{
+		Item.Name = FName(TEXT("BenchTile"), Index + 1);
+		Item.Position = GetGridPosition(Index, NumItems);
+		Item.Size = FVector2D(16.f, 16.f);
+		Item.Color = FLinearColor(Random.FRand(), Random.FRand(), Random.FRand());
+		Item.TexturePath = Context.TexturePaths.Num() > 0 ? Context.TexturePaths[Index % Context.TexturePaths.Num()] : FString();
+		Item.Layer = Random.RandRange(0, 7);
+	}
+
+	template<typename DataType>
+	void MakeItems(TArray<DataType>& OutItems, int32 NumItems, int32 Seed, const FContext& Context)
+	{
+		FRandomStream Random(Seed);
+		OutItems.SetNum(NumItems);
+		for (int32 Index = 0; Index < NumItems; ++Index)
+		{
+			FillItem(OutItems[Index], Index, NumItems, Random, Context);
+		}
+	}
+
+	void AddItems(FCustomViewportClient& Client, TArray<FBoxData>&& Items) { Client.AddBoxes(MoveTemp(Items)); }
+	void AddItems(FCustomViewportClient& Client, TArray<FTextData>&& Items) { Client.AddTexts(MoveTemp(Items)); }
+	void AddItems(FCustomViewportClient& Client, TArray<FTileData>&& Items) { Client.AddTiles(MoveTemp(Items)); }
+	void AddItem(FCustomViewportClient& Client, const FBoxData& Item) { Client.AddBox(Item); }
+	void AddItem(FCustomViewportClient& Client, const FTextData& Item) { Client.AddText(Item); }
+	void AddItem(FCustomViewportClient& Client, const FTileData& Item) { Client.AddTile(Item); }
+
+	/** Ops for the cases that are linear in the scene size per operation, so the largest scenes still finish */
+	int32 GetLinearCaseOps(int32 NumItems)
+	{
+		return FMath::Clamp(NumItems / 100, 10, 1000);
+	}
+
+	FResult MeasureDraw(FCustomViewportClient& Client, const FString& Type, const TCHAR* Case, bool bBatched, bool bFitAll, const FContext& Context)
+	{
+		IConsoleManager::Get().FindConsoleVariable(TEXT("CustomWindow.BatchedDraw"))->Set(bBatched, ECVF_SetByCode);
+
+		const float WorldSize = GetColumns(Client.Scene.Num()) * Spacing;
+		Client.SetCamera(FVector2D::ZeroVector, bFitAll ? FMath::Min(ViewportSize.X, ViewportSize.Y) / WorldSize : 1.f);
+		Client.MarkDirty();
+		Client.ConsumeRedraw(ViewportSize);
+
+		FBenchmarkRenderTarget RenderTarget;
+		FResult Result;
+		Result.Case = Case;
+		Result.Type = Type;
+		Result.Items = Client.Scene.Num();
+		Result.Ops = Context.Iterations;
+		for (int32 Iteration = 0; Iteration < Context.Iterations; ++Iteration)
+		{
+			// Draw releases the snapshot, build the next one outside of the timed part
+			if (Iteration > 0)
+			{
+				Client.MarkDirty();
+				Client.ConsumeRedraw(ViewportSize);
+			}
+			FCanvas Canvas(&RenderTarget, nullptr, static_cast<UWorld*>(nullptr), GMaxRHIFeatureLevel);
+			Result.TotalMs += TimeMs([&Client, &Canvas]() { Client.Draw(nullptr, &Canvas); });
+		}
+		Result.Detail = FString::Printf(TEXT("visible=%d submitted=%d batches=%d"), Client.VisibleItems, Client.SubmittedItems, Client.SubmittedBatches);
+		return Result;
+	}
+
+	template<typename DataType>
+	void RunTypeSuite(const FString& Type, int32 NumItems, FContext& Context)
+	{
+		FCustomViewportClient Client;
+		TArray<DataType> Items;
+		MakeItems(Items, NumItems, NumItems, Context);
+
+		TArray<FName> Names;
+		Names.Reserve(NumItems);
+		for (const DataType& Item : Items)
+		{
+			Names.Add(Item.Name);
+		}
+		DataType Probe = Items[NumItems / 2];
+
+		auto MakeResult = [&Type, NumItems](const TCHAR* Case, int32 Ops, double TotalMs)
+		{
+			FResult Result;
+			Result.Case = Case;
+			Result.Type = Type;
+			Result.Items = NumItems;
+			Result.Ops = Ops;
+			Result.TotalMs = TotalMs;
+			return Result;
+		};
+
+		Context.Add(MakeResult(TEXT("Add"), NumItems, TimeMs([&Client, &Items]() { AddItems(Client, MoveTemp(Items)); })));
+
+		// Same names and layers with new positions, every item is updated in place
+		MakeItems(Items, NumItems, NumItems, Context);
+		for (DataType& Item : Items)
+		{
+			Item.Position += FVector2D(1.f, 1.f);
+		}
+		Context.Add(MakeResult(TEXT("Replace"), NumItems, TimeMs([&Client, &Items]() { AddItems(Client, MoveTemp(Items)); })));
+		Items.Empty();
+
+		Context.Add(MeasureDraw(Client, Type, TEXT("DrawAllVisible"), true, true, Context));
+		Context.Add(MeasureDraw(Client, Type, TEXT("DrawAllVisiblePerItem"), false, true, Context));
+		Context.Add(MeasureDraw(Client, Type, TEXT("DrawCulled"), true, false, Context));
+
+		// Same-name churn: updating one item over and over, then flipping its layer so it moves across the whole array
+		const int32 NumInPlace = FMath::Min(NumItems, 100000);
+		Context.Add(MakeResult(TEXT("ChurnInPlace"), NumInPlace, TimeMs([&Client, &Probe, NumInPlace]()
+		{
+			for (int32 Op = 0; Op < NumInPlace; ++Op)
+			{
+				Probe.Position.X += 1.f;
+				AddItem(Client, Probe);
+			}
+		})));
+
+		// Same churn through the retained handle, no name lookup and no item rebuild
+		const FCanvasItemHandle ProbeHandle = Client.FindItem(Probe.Name);
+		Context.Add(MakeResult(TEXT("SetPositionByHandle"), NumInPlace, TimeMs([&Client, &Probe, ProbeHandle, NumInPlace]()
+		{
+			for (int32 Op = 0; Op < NumInPlace; ++Op)
+			{
+				Probe.Position.X += 1.f;
+				Client.SetItemPosition(ProbeHandle, Probe.Position);
+			}
+		})));
+
+		// One item animated frame after frame in the full scene. The animation edit is timed on its own and has to stay flat
+		// across scene sizes, an edit finding its array still shared with the drawn snapshot would copy the whole array
+		const int32 NumFrames = Context.Iterations * 20;
+		Client.SetCamera(FVector2D::ZeroVector, 1.f);
+		Client.AnimatePosition(ProbeHandle, Probe.Position, Probe.Position + FVector2D(Spacing, 0.f), 1.f, ECanvasAnimationLoop::PingPong);
+		FBenchmarkRenderTarget RenderTarget;
+		FResult AnimateResult = MakeResult(TEXT("AnimateOne"), NumFrames, 0.0);
+		double FrameMs = 0.0;
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			AnimateResult.TotalMs += TimeMs([&Client]() { Client.UpdateScene(); });
+			FCanvas Canvas(&RenderTarget, nullptr, static_cast<UWorld*>(nullptr), GMaxRHIFeatureLevel);
+			FrameMs += TimeMs([&Client, &Canvas]()
+			{
+				Client.ConsumeRedraw(ViewportSize);
+				Client.Draw(nullptr, &Canvas);
+			});
+		}
+		Client.StopAnimations(ProbeHandle);
+		AnimateResult.Detail = FString::Printf(TEXT("frame_ms=%.4f"), FrameMs / NumFrames);
+		Context.Add(MoveTemp(AnimateResult));
+
+		// Clicks at random points of the scene, the slowest one is what a user would notice
+		const int32 NumPicks = FMath::Min(NumItems, 10000);
+		const float WorldSize = GetColumns(NumItems) * Spacing;
+		FRandomStream PickRandom(NumItems);
+		double MaxPickMs = 0.0;
+		int32 NumHits = 0;
+		FResult PickResult = MakeResult(TEXT("Pick"), NumPicks, 0.0);
+		for (int32 Op = 0; Op < NumPicks; ++Op)
+		{
+			const FVector2D Point(PickRandom.FRand() * WorldSize, PickRandom.FRand() * WorldSize);
+			const double PickMs = TimeMs([&Client, &Point, &NumHits]() { NumHits += Client.Scene.Pick(Point).Slot != INDEX_NONE ? 1 : 0; });
+			PickResult.TotalMs += PickMs;
+			MaxPickMs = FMath::Max(MaxPickMs, PickMs);
+		}
+		PickResult.Detail = FString::Printf(TEXT("hits=%d max_ms=%.4f"), NumHits, MaxPickMs);
+		Context.Add(PickResult);
+		if (NumItems <= PickTargetItems && MaxPickMs > MaxPickTargetMs)
+		{
+			Context.Failures.Add(FString::Printf(TEXT("%s pick took %.4f ms at %d items, the target is %.1f ms up to %d items"),
+				*Type, MaxPickMs, NumItems, MaxPickTargetMs, PickTargetItems));
+		}
+
+		TArray<FCanvasItemHandle> Picked;
+		const FBox2D SelectRect(FVector2D::ZeroVector, FVector2D(WorldSize * 0.25f));
+		FResult SelectResult = MakeResult(TEXT("SelectRect"), 1, TimeMs([&Client, &SelectRect, &Picked]() { Client.Scene.QueryRect(SelectRect, Picked); }));
+		SelectResult.Detail = FString::Printf(TEXT("selected=%d"), Picked.Num());
+		Context.Add(SelectResult);
+
+		const int32 NumLinearOps = GetLinearCaseOps(NumItems);
+		Context.Add(MakeResult(TEXT("ChurnLayerFlip"), NumLinearOps, TimeMs([&Client, &Probe, NumLinearOps]()
+		{
+			for (int32 Op = 0; Op < NumLinearOps; ++Op)
+			{
+				Probe.Layer = Op % 2 == 0 ? 100 : -100;
+				AddItem(Client, Probe);
+			}
+		})));
+
+		// Spread the removals over the whole array, removal is ordered so its cost depends on the position
+		FRandomStream Random(NumItems);
+		const int32 Stride = FMath::Max(NumItems / NumLinearOps, 1);
+		TArray<FName> RemovedNames;
+		for (int32 Op = 0; Op < NumLinearOps && Op * Stride < NumItems; ++Op)
+		{
+			RemovedNames.Add(Names[FMath::Min(Op * Stride + Random.RandRange(0, Stride - 1), NumItems - 1)]);
+		}
+		Context.Add(MakeResult(TEXT("Remove"), RemovedNames.Num(), TimeMs([&Client, &RemovedNames]()
+		{
+			for (FName Name : RemovedNames)
+			{
+				Client.RemoveItem(Name);
+			}
+		})));
+
+		const int32 NumLeft = Client.Scene.Num();
+		Context.Add(MakeResult(TEXT("Clear"), NumLeft, TimeMs([&Client]() { Client.ClearScene(); })));
+	}
+
+	void RunQueueSuite(int32 NumItems, FContext& Context)
+	{
+		FCustomViewportClient Client;
+		const int32 NumProducers = FMath::Clamp(FPlatformMisc::NumberOfWorkerThreadsToSpawn(), 2, 16);
+		std::atomic<int32> RunningProducers{ NumProducers };
+		std::atomic<int64> NumRetries{ 0 };
+
+		FResult Result;
+		Result.Case = TEXT("EnqueueAndApply");
+		Result.Type = TEXT("queue");
+		Result.Items = NumItems;
+		Result.Ops = NumItems;
+		Result.TotalMs = TimeMs([&]()
+		{
+			TArray<TFuture<void>> Producers;
+			for (int32 Producer = 0; Producer < NumProducers; ++Producer)
+			{
+				Producers.Add(Async(EAsyncExecution::ThreadPool, [&, Producer]()
+				{
+					FRandomStream Random(Producer);
+					FBoxData Box;
+					for (int32 Index = Producer; Index < NumItems; Index += NumProducers)
+					{
+						FillItem(Box, Index, NumItems, Random, Context);
+						while (!Client.Enqueue(Box))
+						{
+							++NumRetries;
+							FPlatformProcess::Yield();
+						}
+					}
+					--RunningProducers;
+				}));
+			}
+
+			// This thread plays the game thread and drains while the producers run
+			while (RunningProducers > 0)
+			{
+				Client.ApplyCommands();
+				FPlatformProcess::Yield();
+			}
+			for (TFuture<void>& Producer : Producers)
+			{
+				Producer.Wait();
+			}
+			Client.ApplyCommands();
+		});
+
+		const FCanvasCommandQueueStats Stats = Client.Commands->GetStats();
+		Result.Detail = FString::Printf(TEXT("producers=%d applied=%d retries=%lld highwater=%d capacity=%d"),
+			NumProducers, Client.Scene.Num(), NumRetries.load(), Stats.HighWater, Stats.Capacity);
+		Context.Add(MoveTemp(Result));
+	}
+
+	/** A plot of NumItems samples: appending one by one, decimating to a few widths, and a plain scan of every sample to compare */
+	void RunPlotSuite(int32 NumItems, FContext& Context)
+	{
+		FCanvasPlot Plot(NumItems);
+		FRandomStream Random(NumItems);
+		TArray<float> Samples;
+		Samples.SetNumUninitialized(NumItems);
+		for (float& Sample : Samples)
+		{
+			Sample = Random.FRandRange(-1.f, 1.f);
+		}
+
+		auto MakeResult = [NumItems](const TCHAR* Case, int32 Ops, double TotalMs)
+		{
+			FResult Result;
+			Result.Case = Case;
+			Result.Type = TEXT("plot");
+			Result.Items = NumItems;
+			Result.Ops = Ops;
+			Result.TotalMs = TotalMs;
+			return Result;
+		};
+
+		Context.Add(MakeResult(TEXT("PlotAppend"), NumItems, TimeMs([&Plot, &Samples]()
+		{
+			for (float Sample : Samples)
+			{
+				Plot.Append(Sample);
+			}
+		})));
+
+		TArray<FVector2f> Columns;
+		for (int32 Width : { 512, 2048 })
+		{
+			FResult Result = MakeResult(Width == 512 ? TEXT("PlotDecimate512") : TEXT("PlotDecimate2048"), Context.Iterations, TimeMs([&Plot, &Columns, &Context, Width]()
+			{
+				for (int32 Iteration = 0; Iteration < Context.Iterations; ++Iteration)
+				{
+					Plot.Decimate(Width, Columns);
+				}
+			}));
+			Result.Detail = FString::Printf(TEXT("columns=%d"), Columns.Num());
+			Context.Add(MoveTemp(Result));
+		}
+
+		float Min = MAX_flt;
+		float Max = -MAX_flt;
+		FResult Scan = MakeResult(TEXT("PlotScanAll"), Context.Iterations, TimeMs([&Samples, &Context, &Min, &Max]()
+		{
+			for (int32 Iteration = 0; Iteration < Context.Iterations; ++Iteration)
+			{
+				CanvasPlotMinMax(Samples.GetData(), Samples.Num(), Min, Max);
+			}
+		}));
+		Scan.Detail = FString::Printf(TEXT("min=%.3f max=%.3f"), Min, Max);
+		Context.Add(MoveTemp(Scan));
+	}
+
+	/**
+	 * A square pixel buffer of about NumItems pixels and its texture: a strip of rows written and uploaded per frame
+	 * against the whole buffer, what a dynamic tile costs without dirty regions. Uploads run on the render thread, the
+	 * timings include waiting for them.
+	 */
+	void RunPixelSuite(int32 NumItems, FContext& Context)
+	{
+		const int32 Side = FMath::Clamp(FMath::RoundToInt(FMath::Sqrt(static_cast<float>(NumItems))), 16, 4096);
+		FCanvasPixelBuffer Buffer(FIntPoint(Side, Side));
+		TStrongObjectPtr<UTexture2D> Texture(UTexture2D::CreateTransient(Side, Side, PF_B8G8R8A8));
+		Texture->UpdateResource();
+		Buffer.UploadDirtyRegions(Texture.Get());
+		FlushRenderingCommands();
+
+		const int32 StripRows = FMath::Max(Side / 16, 1);
+		TArray<FColor> Strip;
+		Strip.Init(FColor::Red, Side * StripRows);
+
+		auto MakeResult = [Side](const TCHAR* Case, int32 Ops, double TotalMs, int64 NumPixels)
+		{
+			FResult Result;
+			Result.Case = Case;
+			Result.Type = TEXT("pixels");
+			Result.Items = Side * Side;
+			Result.Ops = Ops;
+			Result.TotalMs = TotalMs;
+			Result.Detail = FString::Printf(TEXT("side=%d uploaded=%lld"), Side, NumPixels);
+			return Result;
+		};
+
+		int64 NumPixels = 0;
+		double TotalMs = TimeMs([&]()
+		{
+			for (int32 Iteration = 0; Iteration < Context.Iterations; ++Iteration)
+			{
+				const int32 Row = (Iteration * StripRows) % (Side - StripRows + 1);
+				Buffer.WritePixels(FIntRect(0, Row, Side, Row + StripRows), Strip);
+				NumPixels += Buffer.UploadDirtyRegions(Texture.Get());
+			}
+			FlushRenderingCommands();
+		});
+		Context.Add(MakeResult(TEXT("PixelUploadStrip"), Context.Iterations, TotalMs, NumPixels));
+
+		NumPixels = 0;
+		TotalMs = TimeMs([&]()
+		{
+			for (int32 Iteration = 0; Iteration < Context.Iterations; ++Iteration)
+			{
+				Buffer.Fill(Iteration % 2 ? FColor::Black : FColor::White);
+				NumPixels += Buffer.UploadDirtyRegions(Texture.Get());
+			}
+			FlushRenderingCommands();
+		});
+		Context.Add(MakeResult(TEXT("PixelUploadFull"), Context.Iterations, TotalMs, NumPixels));
+	}
+
+	/** Offscreen capture of a box scene: full renders, skipped renders of an unchanged scene, and the PNG pipeline */
+	void RunCaptureSuite(int32 NumItems, FContext& Context)
+	{
+		FCustomViewportClient Client;
+		TArray<FBoxData> Items;
+		MakeItems(Items, NumItems, NumItems, Context);
+		Client.AddBoxes(MoveTemp(Items));
+
+		FCanvasCapture& Capture = Client.GetCapture();
+		Capture.GetTarget(ViewportSize);
+		Capture.SetView(FBox2D(FVector2D::ZeroVector, FVector2D(GetColumns(NumItems) * Spacing)));
+
+		auto MakeResult = [NumItems](const TCHAR* Case, int32 Ops, double TotalMs)
+		{
+			FResult Result;
+			Result.Case = Case;
+			Result.Type = TEXT("capture");
+			Result.Items = NumItems;
+			Result.Ops = Ops;
+			Result.TotalMs = TotalMs;
+			return Result;
+		};
+
+		Context.Add(MakeResult(TEXT("CaptureRender"), Context.Iterations, TimeMs([&Capture, &Context]()
+		{
+			for (int32 Iteration = 0; Iteration < Context.Iterations; ++Iteration)
+			{
+				Capture.Update(true);
+			}
+		})));
+
+		const int32 NumRendersBefore = Capture.GetNumRenders();
+		FResult Unchanged = MakeResult(TEXT("CaptureUnchanged"), Context.Iterations, TimeMs([&Capture, &Context]()
+		{
+			for (int32 Iteration = 0; Iteration < Context.Iterations; ++Iteration)
+			{
+				Capture.Update();
+			}
+		}));
+		Unchanged.Detail = FString::Printf(TEXT("renders=%d"), Capture.GetNumRenders() - NumRendersBefore);
+		Context.Add(MoveTemp(Unchanged));
+
+		// The game thread part is what SavePNG costs the caller, the rest runs on the render thread and a worker
+		const FString FilePath = FPaths::ProjectSavedDir() / TEXT("CustomWindowBenchmark") / FString::Printf(TEXT("Capture-%d.png"), NumItems);
+		bool bSaved = false;
+		FResult Save = MakeResult(TEXT("CapturePNGGameThread"), 1, TimeMs([&Capture, &FilePath, &bSaved]()
+		{
+			Capture.SavePNG(FilePath, FOnCanvasCaptureSaved::CreateLambda([&bSaved](bool bSuccess) { bSaved = bSuccess; }));
+		}));
+		const double WaitMs = TimeMs([&Capture]()
+		{
+			const double Timeout = FPlatformTime::Seconds() + 30.0;
+			while (Capture.GetNumPendingSaves() > 0 && FPlatformTime::Seconds() < Timeout)
+			{
+				// Update polls the GPU copy, like the viewport tick does
+				Capture.Update();
+				FlushRenderingCommands();
+				FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+			}
+		});
+		Save.Detail = FString::Printf(TEXT("saved=%d total_ms=%.2f"), bSaved ? 1 : 0, Save.TotalMs + WaitMs);
+		Context.Add(MoveTemp(Save));
+	}
+
+	bool WriteResults(const FContext& Context, const FString& OutputBase)
+	{
+		const TSharedPtr<IPlugin> Plugin = IPluginManager::Get().FindPlugin(TEXT("CustomWindow"));
+		const FString PluginVersion = Plugin.IsValid() ? Plugin->GetDescriptor().VersionName : FString();
+
+		FString Csv = TEXT("Case,Type,Items,Ops,TotalMs,NsPerOp,Detail\n");
+		TArray<TSharedPtr<FJsonValue>> JsonResults;
+		for (const FResult& Result : Context.Results)
+		{
+			Csv += FString::Printf(TEXT("%s,%s,%d,%d,%.4f,%.1f,%s\n"), *Result.Case, *Result.Type, Result.Items, Result.Ops,
+				Result.TotalMs, Result.GetNsPerOp(), *Result.Detail);
+
+			TSharedRef<FJsonObject> Item = MakeShared<FJsonObject>();
+			Item->SetStringField(TEXT("case"), Result.Case);
+			Item->SetStringField(TEXT("type"), Result.Type);
+			Item->SetNumberField(TEXT("items"), Result.Items);
+			Item->SetNumberField(TEXT("ops"), Result.Ops);
+			Item->SetNumberField(TEXT("totalMs"), Result.TotalMs);
+			Item->SetNumberField(TEXT("nsPerOp"), Result.GetNsPerOp());
+			Item->SetStringField(TEXT("detail"), Result.Detail);
+			JsonResults.Add(MakeShared<FJsonValueObject>(Item));
+		}
+
+		TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+		Root->SetStringField(TEXT("pluginVersion"), PluginVersion);
+		Root->SetStringField(TEXT("engineVersion"), FEngineVersion::Current().ToString());
+		Root->SetStringField(TEXT("platform"), FPlatformProperties::IniPlatformName());
+		Root->SetStringField(TEXT("cpu"), FPlatformMisc::GetCPUBrand().TrimStartAndEnd());
+		Root->SetNumberField(TEXT("cores"), FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+		Root->SetStringField(TEXT("timestamp"), FDateTime::UtcNow().ToIso8601());
+		Root->SetNumberField(TEXT("iterations"), Context.Iterations);
+		Root->SetArrayField(TEXT("results"), JsonResults);
+
+		FString Json;
+		const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+		FJsonSerializer::Serialize(Root, Writer);
+
+		const bool bWritten = FFileHelper::SaveStringToFile(Csv, *(OutputBase + TEXT(".csv")))
+			&& FFileHelper::SaveStringToFile(Json, *(OutputBase + TEXT(".json")));
+		if (bWritten)
+		{
+			UE_LOG(LogCustomWindow, Display, TEXT("Wrote %s.csv and %s.json"), *OutputBase, *OutputBase);
+		}
+		else
+		{
+			UE_LOG(LogCustomWindow, Error, TEXT("Failed to write the results to %s"), *OutputBase);
+		}
+		return bWritten;
+	}
+}
+
+UCustomWindowBenchmarkCommandlet::UCustomWindowBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UCustomWindowBenchmarkCommandlet::Main(const FString& Params)
+{
+	using namespace CustomWindowBenchmark;
+
+	FString SizesParam = TEXT("1000,10000,100000,1000000");
+	FParse::Value(*Params, TEXT("sizes="), SizesParam, false);
+	FString TypesParam = TEXT("box,text,tile,texture,queue,capture,plot,pixels");
+	FParse::Value(*Params, TEXT("types="), TypesParam, false);
+	int32 NumTextures = 4096;
+	FParse::Value(*Params, TEXT("textures="), NumTextures);
+
+	FContext Context;
+	FParse::Value(*Params, TEXT("iterations="), Context.Iterations);
+	Context.Iterations = FMath::Max(Context.Iterations, 1);
+
+	TArray<FString> SizeStrings;
+	SizesParam.ParseIntoArray(SizeStrings, TEXT(","));
+	TArray<int32> Sizes;
+	for (const FString& Size : SizeStrings)
+	{
+		Sizes.Add(FMath::Max(FCString::Atoi(*Size), 1));
+	}
+
+	TArray<FString> Types;
+	TypesParam.ParseIntoArray(Types, TEXT(","));
+
+	// Tiny transient textures, one unique texture per tile up to NumTextures, the worst case for texture batching
+	TArray<TStrongObjectPtr<UTexture2D>> Textures;
+	TArray<FString> TexturePaths;
+	if (Types.Contains(TEXT("texture")))
+	{
+		for (int32 Index = 0; Index < NumTextures; ++Index)
+		{
+			UTexture2D* Texture = UTexture2D::CreateTransient(4, 4, PF_B8G8R8A8,
+				MakeUniqueObjectName(GetTransientPackage(), UTexture2D::StaticClass(), TEXT("CustomWindowBenchmark")));
+			Texture->UpdateResource();
+			Textures.Emplace(Texture);
+			TexturePaths.Add(Texture->GetPathName());
+		}
+	}
+
+	for (int32 NumItems : Sizes)
+	{
+		for (const FString& Type : Types)
+		{
+			if (Type == TEXT("box"))
+			{
+				RunTypeSuite<FBoxData>(Type, NumItems, Context);
+			}
+			else if (Type == TEXT("text"))
+			{
+				RunTypeSuite<FTextData>(Type, NumItems, Context);
+			}
+			else if (Type == TEXT("tile"))
+			{
+				RunTypeSuite<FTileData>(Type, NumItems, Context);
+			}
+			else if (Type == TEXT("texture"))
+			{
+				Context.TexturePaths = TexturePaths;
+				RunTypeSuite<FTileData>(Type, NumItems, Context);
+				Context.TexturePaths.Reset();
+			}
+			else if (Type == TEXT("queue"))
+			{
+				RunQueueSuite(NumItems, Context);
+			}
+			else if (Type == TEXT("capture"))
+			{
+				RunCaptureSuite(NumItems, Context);
+			}
+			else if (Type == TEXT("plot"))
+			{
+				RunPlotSuite(NumItems, Context);
+			}
+			else if (Type == TEXT("pixels"))
+			{
+				RunPixelSuite(NumItems, Context);
+			}
+			else
+			{
+				UE_LOG(LogCustomWindow, Warning, TEXT("Unknown benchmark type %s, expected box, text, tile, texture, queue, capture, plot or pixels"), *Type);
+			}
+		}
+	}
+
+	FString OutputBase;
+	if (!FParse::Value(*Params, TEXT("output="), OutputBase))
+	{
+		OutputBase = FPaths::ProjectSavedDir() / TEXT("CustomWindowBenchmark") / FString::Printf(TEXT("CustomWindowBenchmark-%s"), *FDateTime::Now().ToString());
+	}
+	const bool bWritten = WriteResults(Context, OutputBase);
+
+	for (const FString& Failure : Context.Failures)
+	{
+		UE_LOG(LogCustomWindow, Error, TEXT("Missed target: %s"), *Failure);
+	}
+	return bWritten && Context.Failures.Num() == 0 ? 0 : 1;
+}
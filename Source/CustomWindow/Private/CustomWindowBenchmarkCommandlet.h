@@ -0,0 +1,39 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "CustomWindowBenchmarkCommandlet.generated.h"
+
+/**
+ * Times FCustomViewportClient on synthetic scenes without a window or a GPU:
+ *
+ *   UnrealEditor-Cmd <Project> -run=CustomWindowBenchmark -nullrhi [-sizes=1000,10000,100000,1000000] [-iterations=5]
+ *       [-types=box,text,tile,texture,queue,capture,plot,pixels] [-textures=4096] [-output=<Path without extension>]
+ *
+ * Every type runs once per size, the size being the number of items, samples or pixels:
+ *
+ *   box, text, tile  Add, replace, draw (all visible, per item, culled), same-name churn, handle edits, one
+ *                    animated item, pick, rectangle select, layer flips, remove and clear on a scene of that one
+ *                    primitive
+ *   texture          The tile suite with -textures unique transient textures spread over the tiles, the worst case
+ *                    for texture batching
+ *   queue            Worker threads enqueueing boxes while this thread drains the command queue
+ *   capture          Offscreen renders of a box scene, skipped renders of an unchanged scene, and a PNG save
+ *   plot             Appending samples to a plot, decimating them to screen columns, and a plain scan to compare
+ *   pixels           Writing a strip of rows of a pixel buffer and uploading it, against uploading the whole buffer
+ *
+ * Results are written as CSV and JSON to Saved/CustomWindowBenchmark unless -output is given. The commandlet returns 1
+ * when it couldn't write them or when a target was missed: a single pick slower than 1 ms on up to 100k items.
+ */
+UCLASS()
+class UCustomWindowBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UCustomWindowBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,137 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CustomWindowBlueprintLibrary.h"
+
+#include "CanvasCapture.h"
+#include "CustomWindow.h"
+
+static FCustomViewportClient* GetCustomViewportClient()
+{
+	return FCustomWindowModule::IsAvailable() ? FCustomWindowModule::Get().GetActiveClient() : nullptr;
+}
+
+bool UCustomWindowBlueprintLibrary::AddBoxes(const TArray<FBoxData>& Boxes)
+{
+	FCustomViewportClient* ViewportClient = GetCustomViewportClient();
+	if (ViewportClient)
+	{
+		ViewportClient->AddBoxes(Boxes);
+	}
+	return ViewportClient != nullptr;
+}
+
+bool UCustomWindowBlueprintLibrary::AddTexts(const TArray<FTextData>& Texts)
+{
+	FCustomViewportClient* ViewportClient = GetCustomViewportClient();
+	if (ViewportClient)
+	{
+		ViewportClient->AddTexts(Texts);
+	}
+	return ViewportClient != nullptr;
+}
+
+bool UCustomWindowBlueprintLibrary::AddTiles(const TArray<FTileData>& Tiles)
+{
+	FCustomViewportClient* ViewportClient = GetCustomViewportClient();
+	if (ViewportClient)
+	{
+		ViewportClient->AddTiles(Tiles);
+	}
+	return ViewportClient != nullptr;
+}
+
+bool UCustomWindowBlueprintLibrary::RemoveItems(const TArray<FName>& Names)
+{
+	FCustomViewportClient* ViewportClient = GetCustomViewportClient();
+	if (ViewportClient)
+	{
+		ViewportClient->RemoveItems(Names);
+	}
+	return ViewportClient != nullptr;
+}
+
+bool UCustomWindowBlueprintLibrary::ClearScene()
+{
+	FCustomViewportClient* ViewportClient = GetCustomViewportClient();
+	if (ViewportClient)
+	{
+		ViewportClient->ClearScene();
+	}
+	return ViewportClient != nullptr;
+}
+
+bool UCustomWindowBlueprintLibrary::AddPlot(const FPlotData& Plot)
+{
+	FCustomViewportClient* ViewportClient = GetCustomViewportClient();
+	if (ViewportClient)
+	{
+		ViewportClient->AddPlot(Plot);
+	}
+	return ViewportClient != nullptr;
+}
+
+bool UCustomWindowBlueprintLibrary::AppendPlotSamples(FName PlotName, const TArray<float>& Samples)
+{
+	FCustomViewportClient* ViewportClient = GetCustomViewportClient();
+	TSharedPtr<FCanvasPlot, ESPMode::ThreadSafe> Plot = ViewportClient ? ViewportClient->FindPlot(PlotName) : nullptr;
+	if (Plot.IsValid())
+	{
+		Plot->Append(Samples);
+	}
+	return Plot.IsValid();
+}
+
+bool UCustomWindowBlueprintLibrary::AddPixelTile(const FTileData& Tile, int32 Width, int32 Height)
+{
+	FCustomViewportClient* ViewportClient = GetCustomViewportClient();
+	if (ViewportClient)
+	{
+		ViewportClient->AddPixelTile(Tile, FIntPoint(Width, Height));
+	}
+	return ViewportClient != nullptr;
+}
+
+bool UCustomWindowBlueprintLibrary::WritePixelTile(FName TileName, int32 X, int32 Y, int32 Width, const TArray<FColor>& Pixels)
+{
+	FCustomViewportClient* ViewportClient = GetCustomViewportClient();
+	TSharedPtr<FCanvasPixelBuffer, ESPMode::ThreadSafe> Buffer = ViewportClient ? ViewportClient->FindPixelTile(TileName) : nullptr;
+	if (!Buffer.IsValid())
+	{
+		return false;
+	}
+	if (Width <= 0 || Pixels.Num() % Width != 0)
+	{
+		UE_LOG(LogCustomWindow, Warning, TEXT("WritePixelTile %s: %d pixels are not whole rows of width %d, nothing written"),
+			*TileName.ToString(), Pixels.Num(), Width);
+		return false;
+	}
+
+	Buffer->WritePixels(FIntRect(X, Y, X + Width, Y + Pixels.Num() / Width), Pixels);
+	return true;
+}
+
+UTextureRenderTarget2D* UCustomWindowBlueprintLibrary::GetSceneTexture(int32 Width, int32 Height)
+{
+	FCustomViewportClient* ViewportClient = GetCustomViewportClient();
+	if (!ViewportClient)
+	{
+		return nullptr;
+	}
+
+	FCanvasCapture& Capture = ViewportClient->GetCapture();
+	UTextureRenderTarget2D* Target = Capture.GetTarget(FIntPoint(Width, Height));
+	Capture.Update();
+	return Target;
+}
+
+bool UCustomWindowBlueprintLibrary::SaveSceneImage(const FString& FilePath, int32 Width, int32 Height)
+{
+	FCustomViewportClient* ViewportClient = GetCustomViewportClient();
+	if (ViewportClient)
+	{
+		FCanvasCapture& Capture = ViewportClient->GetCapture();
+		Capture.GetTarget(FIntPoint(Width, Height));
+		Capture.SavePNG(FilePath);
+	}
+	return ViewportClient != nullptr;
+}
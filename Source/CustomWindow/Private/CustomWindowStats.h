@@ -0,0 +1,42 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Stats/Stats.h"
+
+DECLARE_STATS_GROUP(TEXT("CustomWindow"), STATGROUP_CustomWindow, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Draw"), STAT_CustomWindow_Draw, STATGROUP_CustomWindow, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build Snapshot"), STAT_CustomWindow_BuildSnapshot, STATGROUP_CustomWindow, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Apply Commands"), STAT_CustomWindow_ApplyCommands, STATGROUP_CustomWindow, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Add Items"), STAT_CustomWindow_AddItems, STATGROUP_CustomWindow, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Animate"), STAT_CustomWindow_Animate, STATGROUP_CustomWindow, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Texture Acquire"), STAT_CustomWindow_TextureAcquire, STATGROUP_CustomWindow, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Texture Loaded"), STAT_CustomWindow_TextureLoaded, STATGROUP_CustomWindow, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Atlas Upload"), STAT_CustomWindow_AtlasUpload, STATGROUP_CustomWindow, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Capture"), STAT_CustomWindow_Capture, STATGROUP_CustomWindow, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Plot Decimate"), STAT_CustomWindow_PlotDecimate, STATGROUP_CustomWindow, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Pixel Upload"), STAT_CustomWindow_PixelUpload, STATGROUP_CustomWindow, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Create Tab"), STAT_CustomWindow_CreateTab, STATGROUP_CustomWindow, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build Settings Panel"), STAT_CustomWindow_CreateSettings, STATGROUP_CustomWindow, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Autosave"), STAT_CustomWindow_Autosave, STATGROUP_CustomWindow, );
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Items Submitted"), STAT_CustomWindow_ItemsSubmitted, STATGROUP_CustomWindow, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Batches"), STAT_CustomWindow_Batches, STATGROUP_CustomWindow, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Commands Applied"), STAT_CustomWindow_CommandsApplied, STATGROUP_CustomWindow, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Textures Loaded"), STAT_CustomWindow_TexturesLoaded, STATGROUP_CustomWindow, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Texture Cache Hits"), STAT_CustomWindow_CacheHits, STATGROUP_CustomWindow, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Texture Cache Misses"), STAT_CustomWindow_CacheMisses, STATGROUP_CustomWindow, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Pixels Uploaded"), STAT_CustomWindow_PixelsUploaded, STATGROUP_CustomWindow, );
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Scene Items"), STAT_CustomWindow_SceneItems, STATGROUP_CustomWindow, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Visible Items"), STAT_CustomWindow_VisibleItems, STATGROUP_CustomWindow, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Culled Items"), STAT_CustomWindow_CulledItems, STATGROUP_CustomWindow, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Atlas Pages"), STAT_CustomWindow_AtlasPages, STATGROUP_CustomWindow, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Atlas Textures"), STAT_CustomWindow_AtlasEntries, STATGROUP_CustomWindow, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Settings Panels Built"), STAT_CustomWindow_PanelsBuilt, STATGROUP_CustomWindow, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Settings Panels Reused"), STAT_CustomWindow_PanelsReused, STATGROUP_CustomWindow, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Resident Textures"), STAT_CustomWindow_TextureMemory, STATGROUP_CustomWindow, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Atlas Pages"), STAT_CustomWindow_AtlasMemory, STATGROUP_CustomWindow, );
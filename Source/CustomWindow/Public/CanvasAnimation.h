@@ -0,0 +1,44 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CanvasScene.h"
+
+enum class ECanvasAnimatedProperty : uint8
+{
+	/** XY */
+	Position,
+	/** RGBA */
+	Color,
+	/** XY, boxes and tiles only */
+	Size
+};
+
+enum class ECanvasAnimationLoop : uint8
+{
+	/** Stops at the end value and the track is removed */
+	Once,
+	Repeat,
+	PingPong
+};
+
+/** Linear interpolation of one property of one item, evaluated every tick by the viewport client */
+struct FCanvasAnimationTrack
+{
+	FCanvasItemHandle Handle;
+	FVector4f From;
+	FVector4f To;
+	double StartTime = 0.0;
+	float Duration = 1.f;
+	ECanvasAnimatedProperty Property = ECanvasAnimatedProperty::Position;
+	ECanvasAnimationLoop Loop = ECanvasAnimationLoop::Once;
+};
+
+/** Interpolation factor of the track at Time, sets bOutFinished once a Once track reached its end */
+float GetCanvasAnimationAlpha(const FCanvasAnimationTrack& Track, double Time, bool& bOutFinished);
+
+/** Writes Value to the animated property of Item */
+void ApplyCanvasAnimationValue(FBoxInstance& Item, ECanvasAnimatedProperty Property, const FVector4f& Value);
+void ApplyCanvasAnimationValue(FTextInstance& Item, ECanvasAnimatedProperty Property, const FVector4f& Value);
+void ApplyCanvasAnimationValue(FTileInstance& Item, ECanvasAnimatedProperty Property, const FVector4f& Value);
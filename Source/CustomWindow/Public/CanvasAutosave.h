@@ -0,0 +1,64 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "CanvasItemData.h"
+#include "Templates/Function.h"
+
+struct FCanvasDelta;
+
+/**
+ * Keeps a scene on disk as a binary snapshot plus a log of the deltas applied since, written on a worker thread. Append
+ * only copies the delta into the pending bytes, Flush appends those to the log, and Compact replaces the snapshot and
+ * starts an empty log once the log has outgrown it. The log header holds the CRC of its snapshot, so the log of an
+ * interrupted compaction is never replayed over the wrong snapshot.
+ */
+class FCanvasAutosave
+{
+public:
+	static constexpr uint32 LogMagic = 0x4C445743; // "CWDL"
+	static constexpr uint32 LogVersion = 2;
+	/** Logs below this are never compacted, whatever the size of the snapshot */
+	static constexpr int64 MinCompactionBytes = 256 * 1024;
+
+	explicit FCanvasAutosave(const FString& InBasePath);
+	/** Waits for the write in flight and writes what is still pending, unless a failed write left the log behind */
+	~FCanvasAutosave();
+
+	void Append(const FCanvasDelta& Delta);
+	/** True while a worker thread writes, Flush does nothing until then and Compact waits for it */
+	bool IsWriting();
+	/** True once the log is larger than the snapshot, or after a failed write left the files behind the scene */
+	bool NeedsCompaction() const;
+	/** Appends the pending deltas to the log on a worker thread */
+	void Flush();
+	/** Writes Snapshot, which must hold every delta appended so far, and starts an empty log against it */
+	void Compact(FCanvasSceneData&& Snapshot);
+	/**
+	 * Waits for the write in flight, then appends what is still pending. When a write failed the log no longer follows
+	 * the snapshot, so the scene from ExportScene is written in their place instead, on the calling thread.
+	 */
+	void Close(TFunctionRef<void(FCanvasSceneData&)> ExportScene);
+
+	int64 GetPendingBytes() const { return Pending.Num(); }
+	/** Bytes appended to the log since the last compaction */
+	int64 GetLogBytes() const { return LogBytes; }
+
+	static FString GetSnapshotPath(const FString& BasePath) { return BasePath + TEXT(".cwscene"); }
+	static FString GetLogPath(const FString& BasePath) { return BasePath + TEXT(".cwdelta"); }
+
+	/** Reads the snapshot saved at BasePath and the deltas logged against it, false when there is no valid snapshot */
+	static bool Load(const FString& BasePath, FCanvasSceneData& OutSnapshot, TArray<uint8>& OutLog);
+
+private:
+	FString SnapshotPath;
+	FString LogPath;
+	TArray<uint8> Pending;
+	int64 LogBytes = 0;
+	int64 SnapshotBytes = 0;
+	bool bWriteFailed = false;
+	/** Size of the written snapshot for compactions, negative for log appends and failures */
+	TFuture<int64> Writing;
+};
@@ -0,0 +1,79 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CustomWindow.h"
+#include "UObject/GCObject.h"
+#include "UObject/ObjectPtr.h"
+
+class UTextureRenderTarget2D;
+
+DECLARE_DELEGATE_OneParam(FOnCanvasCaptureSaved, bool /*bSuccess*/);
+
+/**
+ * Offscreen copy of a viewport client's scene, for HUDs and materials that sample the render target, and for PNG
+ * snapshots. The target is only re-rendered when the client version changed since the last render.
+ *
+ * By default the capture shows what the viewport shows, scaled to the target width. SetView pins it to a world
+ * rectangle instead.
+ */
+class FCanvasCapture : public FGCObject
+{
+public:
+	explicit FCanvasCapture(FCustomViewportClient& InClient);
+	/** Waits for the readbacks still in flight, so every SavePNG reports back */
+	virtual ~FCanvasCapture();
+
+	/** Creates the target on first use and resizes it when Resolution changed */
+	UTextureRenderTarget2D* GetTarget(const FIntPoint& Resolution);
+	UTextureRenderTarget2D* GetTarget() const { return Target; }
+
+	/** An invalid rectangle goes back to following the viewport */
+	void SetView(const FBox2D& InWorldRect);
+
+	/**
+	 * Renders the scene into the target if it changed, game thread only. Returns true when it rendered. Also polls the
+	 * readbacks of SavePNG, so it has to be called every frame while saves are pending.
+	 */
+	bool Update(bool bForce = false);
+
+	/**
+	 * Copies the target to a staging texture without stalling on the GPU, Update picks the pixels up once the copy
+	 * finished and a worker compresses and writes the PNG, the game thread never waits on it. OnSaved runs on the game
+	 * thread. Under -nullrhi there is nothing to read back and the image is filled with the background color, so the
+	 * rest of the pipeline still runs.
+	 */
+	void SavePNG(const FString& FilePath, FOnCanvasCaptureSaved OnSaved = FOnCanvasCaptureSaved());
+
+	int32 GetNumRenders() const { return NumRenders; }
+	/** Items and batches of the last render, kept apart from the viewport counters */
+	const FCanvasDrawCounters& GetRenderCounters() const { return RenderCounters; }
+	int32 GetNumPendingSaves() const { return PendingSaves->GetValue(); }
+
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override { return TEXT("FCanvasCapture"); }
+
+private:
+	FCustomViewportClient& Client;
+	TObjectPtr<UTextureRenderTarget2D> Target;
+	FBox2D WorldRect = FBox2D(ForceInit);
+	/** Client version, view and viewport size of the last render, the version starts at 0 so unset is all ones */
+	uint64 RenderedVersion = MAX_uint64;
+	FBox2D RenderedRect = FBox2D(ForceInit);
+	FIntPoint RenderedViewportSize = FIntPoint::ZeroValue;
+	int32 NumRenders = 0;
+	FCanvasDrawCounters RenderCounters;
+	/** Kept between renders for its index list allocations */
+	FCanvasRenderSnapshot Snapshot;
+	/** Shared with the render thread and worker tasks, which may outlive the capture */
+	TSharedRef<FThreadSafeCounter, ESPMode::ThreadSafe> PendingSaves = MakeShared<FThreadSafeCounter, ESPMode::ThreadSafe>();
+
+	/** A save waiting for its GPU copy, owned by the game thread and referenced by render commands */
+	struct FPendingReadback;
+	TArray<TSharedRef<FPendingReadback, ESPMode::ThreadSafe>> Readbacks;
+
+	void GetCamera(FVector2D& OutOffset, float& OutZoom) const;
+	/** Queues a render command that picks up the finished copies, or with bWait every copy after the GPU went idle */
+	void PollReadbacks(bool bWait);
+};
@@ -0,0 +1,165 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CanvasPrimitive.h"
+#include "Misc/TVariant.h"
+#include <atomic>
+
+struct FCanvasRemoveCommand
+{
+	FName Name;
+};
+
+/** Add or update for every primitive's data, remove by name otherwise. The index of a primitive is its ECanvasItemType */
+using FCanvasCommand = FCanvasPrimitives::TVariantWith<FCanvasRemoveCommand>;
+
+template<typename DataType>
+FCanvasCommand MakeCanvasCommand(DataType&& Data)
+{
+	return FCanvasCommand(TInPlaceType<typename TDecay<DataType>::Type>(), Forward<DataType>(Data));
+}
+
+struct FCanvasCommandQueueStats
+{
+	int64 NumEnqueued = 0;
+	/** Enqueue calls rejected because the queue was full */
+	int64 NumDropped = 0;
+	int64 NumDequeued = 0;
+	/** Highest number of pending commands seen by a producer */
+	int32 HighWater = 0;
+	int32 Capacity = 0;
+};
+
+/**
+ * Bounded lock-free queue with any number of producers and a single consumer. Every cell carries a sequence number
+ * telling whose turn it is, producers claim a position with a CAS and consumers never touch the producer counter, so
+ * there are no locks and no allocations after construction. A full queue rejects the command instead of growing.
+ */
+template<typename T>
+class TCanvasBoundedQueue
+{
+public:
+	/** Capacity is rounded up to a power of two */
+	explicit TCanvasBoundedQueue(uint32 InCapacity)
+		: Capacity(FMath::RoundUpToPowerOfTwo(FMath::Max<uint32>(InCapacity, 2)))
+		, Mask(Capacity - 1)
+		, Cells(new FCell[Capacity])
+	{
+		for (uint32 Index = 0; Index < Capacity; ++Index)
+		{
+			Cells[Index].Sequence.store(Index, std::memory_order_relaxed);
+		}
+	}
+
+	~TCanvasBoundedQueue()
+	{
+		T Discarded;
+		while (Dequeue(Discarded))
+		{
+		}
+		delete[] Cells;
+	}
+
+	TCanvasBoundedQueue(const TCanvasBoundedQueue&) = delete;
+	TCanvasBoundedQueue& operator=(const TCanvasBoundedQueue&) = delete;
+
+	/** Callable from any thread, returns false and counts a drop when the queue is full */
+	template<typename ItemType>
+	bool Enqueue(ItemType&& Item)
+	{
+		FCell* Cell = nullptr;
+		uint64 Position = EnqueuePosition.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Cell = &Cells[Position & Mask];
+			const uint64 Sequence = Cell->Sequence.load(std::memory_order_acquire);
+			const int64 Difference = static_cast<int64>(Sequence - Position);
+			if (Difference == 0)
+			{
+				if (EnqueuePosition.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed))
+				{
+					break;
+				}
+			}
+			else if (Difference < 0)
+			{
+				NumDropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			else
+			{
+				Position = EnqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+
+		new (Cell->Storage.GetTypedPtr()) T(Forward<ItemType>(Item));
+		Cell->Sequence.store(Position + 1, std::memory_order_release);
+		NumEnqueued.fetch_add(1, std::memory_order_relaxed);
+
+		const int32 Pending = static_cast<int32>(Position + 1 - DequeuePosition.load(std::memory_order_relaxed));
+		int32 HighWaterSeen = HighWater.load(std::memory_order_relaxed);
+		while (Pending > HighWaterSeen && !HighWater.compare_exchange_weak(HighWaterSeen, Pending, std::memory_order_relaxed))
+		{
+		}
+		return true;
+	}
+
+	/** Consumer thread only */
+	bool Dequeue(T& OutItem)
+	{
+		const uint64 Position = DequeuePosition.load(std::memory_order_relaxed);
+		FCell& Cell = Cells[Position & Mask];
+		const uint64 Sequence = Cell.Sequence.load(std::memory_order_acquire);
+		if (static_cast<int64>(Sequence - (Position + 1)) < 0)
+		{
+			return false;
+		}
+
+		T* Item = Cell.Storage.GetTypedPtr();
+		OutItem = MoveTemp(*Item);
+		Item->~T();
+		DequeuePosition.store(Position + 1, std::memory_order_relaxed);
+		Cell.Sequence.store(Position + Capacity, std::memory_order_release);
+		return true;
+	}
+
+	/** Approximate while producers are running */
+	int32 Num() const
+	{
+		return static_cast<int32>(EnqueuePosition.load(std::memory_order_relaxed) - DequeuePosition.load(std::memory_order_relaxed));
+	}
+
+	int32 GetCapacity() const { return static_cast<int32>(Capacity); }
+
+	FCanvasCommandQueueStats GetStats() const
+	{
+		FCanvasCommandQueueStats Stats;
+		Stats.NumEnqueued = NumEnqueued.load(std::memory_order_relaxed);
+		Stats.NumDropped = NumDropped.load(std::memory_order_relaxed);
+		Stats.NumDequeued = static_cast<int64>(DequeuePosition.load(std::memory_order_relaxed));
+		Stats.HighWater = HighWater.load(std::memory_order_relaxed);
+		Stats.Capacity = GetCapacity();
+		return Stats;
+	}
+
+private:
+	struct FCell
+	{
+		std::atomic<uint64> Sequence;
+		TTypeCompatibleBytes<T> Storage;
+	};
+
+	const uint32 Capacity;
+	const uint32 Mask;
+	FCell* const Cells;
+
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint64> EnqueuePosition{ 0 };
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint64> DequeuePosition{ 0 };
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<int64> NumEnqueued{ 0 };
+	std::atomic<int64> NumDropped{ 0 };
+	std::atomic<int32> HighWater{ 0 };
+};
+
+using FCanvasCommandQueue = TCanvasBoundedQueue<FCanvasCommand>;
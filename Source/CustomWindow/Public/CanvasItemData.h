@@ -0,0 +1,100 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CanvasItemData.generated.h"
+
+USTRUCT(BlueprintType)
+struct FBoxData
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CustomWindow")
+	FName Name;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CustomWindow")
+	FVector2D Position = FVector2D::ZeroVector;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CustomWindow")
+	FVector2D Size = FVector2D::UnitVector;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CustomWindow")
+	FLinearColor Color;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CustomWindow")
+	float Thickness = 0.1f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CustomWindow")
+	int32 Layer = 0;
+};
+
+USTRUCT(BlueprintType)
+struct FTextData
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CustomWindow")
+	FName Name;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CustomWindow")
+	FVector2D Position = FVector2D::ZeroVector;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CustomWindow")
+	float FontSize = 1.f;
+	/** Drawn with its alpha, so the default is opaque */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CustomWindow")
+	FLinearColor Color = FLinearColor::Black;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CustomWindow")
+	FString Message;
+	/** Object path of the UFont to use, the engine small font when empty */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CustomWindow")
+	FString FontPath;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CustomWindow")
+	int32 Layer = 0;
+};
+
+USTRUCT(BlueprintType)
+struct FTileData
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CustomWindow")
+	FName Name;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CustomWindow")
+	FVector2D Position = FVector2D::ZeroVector;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CustomWindow")
+	FVector2D Size = FVector2D::UnitVector;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CustomWindow")
+	FLinearColor Color = FLinearColor::White;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CustomWindow")
+	FString TexturePath;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CustomWindow")
+	int32 Layer = 0;
+};
+
+/** A line graph of the last Capacity samples appended to it, drawn over the scene items */
+USTRUCT(BlueprintType)
+struct FPlotData
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CustomWindow")
+	FName Name;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CustomWindow")
+	FVector2D Position = FVector2D::ZeroVector;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CustomWindow")
+	FVector2D Size = FVector2D(400.f, 100.f);
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CustomWindow")
+	FLinearColor Color = FLinearColor::Green;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CustomWindow")
+	int32 Capacity = 4096;
+	/** Values mapped to the bottom and top of the plot, the range of the buffered samples when Min isn't below Max */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CustomWindow")
+	float MinValue = 0.f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CustomWindow")
+	float MaxValue = 0.f;
+};
+
+/** Plain copy of a scene's items, the unit of import and export */
+struct FCanvasSceneData
+{
+	TArray<FBoxData> Boxes;
+	TArray<FTextData> Texts;
+	TArray<FTileData> Tiles;
+
+	int32 Num() const { return Boxes.Num() + Texts.Num() + Tiles.Num(); }
+};
@@ -0,0 +1,212 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CanvasPrimitive.h"
+#include "Templates/Function.h"
+
+enum class ECanvasDeltaOp : uint8
+{
+	/** After holds the added item */
+	Add,
+	/** Before and After hold the replaced item and the one replacing it, of the same type */
+	Replace,
+	/** Before holds the removed item */
+	Remove,
+	/** Before and After hold the name of the item and the value of Property */
+	Property,
+	/** The scene was emptied. Only found in autosave logs, clearing also drops the undo history */
+	Clear,
+};
+
+/** Properties a Property delta can hold, the ones of SetItemPosition, SetItemColor and SetItemSize */
+enum class ECanvasDeltaProperty : uint8
+{
+	None,
+	Position,
+	Color,
+	Size,
+};
+
+/**
+ * One change of the scene, viewing bytes of the journal or of an autosave log. Items are stored as their fields in
+ * TCanvasPrimitive visiting order with the strings inline, so a delta decodes without the scene or a string table.
+ */
+struct CUSTOMWINDOW_API FCanvasDelta
+{
+	ECanvasDeltaOp Op = ECanvasDeltaOp::Add;
+	ECanvasItemType Type = ECanvasItemType::Num;
+	ECanvasDeltaProperty Property = ECanvasDeltaProperty::None;
+	TArrayView<const uint8> Before;
+	TArrayView<const uint8> After;
+	/** Position of the Before and After items among the items of their type and layer, INDEX_NONE when not recorded */
+	int32 BeforePosition = INDEX_NONE;
+	int32 AfterPosition = INDEX_NONE;
+
+	/** The delta undoing this one: Before and After swapped with their positions, adds and removes exchanged */
+	FCanvasDelta Inverse() const;
+};
+
+namespace CanvasDelta
+{
+	struct CUSTOMWINDOW_API FWriter
+	{
+		TArray<uint8>& Bytes;
+
+		template<typename T>
+		void Write(T Value)
+		{
+			Bytes.Append(reinterpret_cast<const uint8*>(&Value), sizeof(T));
+		}
+
+		void WriteString(const FString& String);
+
+		void operator()(const FCanvasField&, FName Value) { WriteString(Value.IsNone() ? FString() : Value.ToString()); }
+		void operator()(const FCanvasField&, const FString& Value) { WriteString(Value); }
+		void operator()(const FCanvasField&, float Value) { Write<float>(Value); }
+		void operator()(const FCanvasField&, int32 Value) { Write<int32>(Value); }
+		void operator()(const FCanvasField&, const FVector2D& Value);
+		void operator()(const FCanvasField&, const FLinearColor& Value);
+	};
+
+	/** Reads what FWriter wrote, bValid turns false instead of reading past End */
+	struct CUSTOMWINDOW_API FReader
+	{
+		const uint8* Cursor;
+		const uint8* End;
+		bool bValid = true;
+
+		template<typename T>
+		T Read()
+		{
+			T Value = T();
+			if (End - Cursor < static_cast<int64>(sizeof(T)))
+			{
+				bValid = false;
+				Cursor = End;
+				return Value;
+			}
+			FMemory::Memcpy(&Value, Cursor, sizeof(T));
+			Cursor += sizeof(T);
+			return Value;
+		}
+
+		FString ReadString();
+
+		void operator()(const FCanvasField&, FName& Value);
+		void operator()(const FCanvasField&, FString& Value) { Value = ReadString(); }
+		void operator()(const FCanvasField&, float& Value) { Value = Read<float>(); }
+		void operator()(const FCanvasField&, int32& Value) { Value = Read<int32>(); }
+		void operator()(const FCanvasField&, FVector2D& Value);
+		void operator()(const FCanvasField&, FLinearColor& Value);
+	};
+
+	template<typename DataType>
+	void WriteItem(const DataType& Data, TArray<uint8>& Bytes)
+	{
+		TCanvasPrimitive<DataType>::VisitFields(Data, FWriter{ Bytes });
+	}
+
+	template<typename DataType>
+	bool ReadItem(TArrayView<const uint8> Bytes, DataType& OutData)
+	{
+		FReader Reader{ Bytes.GetData(), Bytes.GetData() + Bytes.Num() };
+		TCanvasPrimitive<DataType>::VisitFields(OutData, Reader);
+		return Reader.bValid && Reader.Cursor == Reader.End;
+	}
+
+	/** Name of the item and value of the property, for Property deltas */
+	CUSTOMWINDOW_API void WriteProperty(FName Name, const FVector4f& Value, TArray<uint8>& Bytes);
+	CUSTOMWINDOW_API bool ReadProperty(TArrayView<const uint8> Bytes, FName& OutName, FVector4f& OutValue);
+
+	/** Name of the item of an item or property record, every primitive visits its name first */
+	CUSTOMWINDOW_API FName ReadName(TArrayView<const uint8> Bytes);
+}
+
+/**
+ * Undo history of a scene: deltas appended to an arena of fixed size blocks and grouped into transactions. Recording
+ * copies the delta behind the last one, and undo or redo only walk the deltas of one transaction, so an edit costs the
+ * size of its delta whatever the size of the scene. Recording after an undo drops the undone transactions, and the
+ * oldest ones are dropped once the blocks grow past the byte budget.
+ */
+class CUSTOMWINDOW_API FCanvasJournal
+{
+public:
+	static constexpr int32 BlockSize = 64 * 1024;
+
+	explicit FCanvasJournal(int64 InMaxBytes = 64 * 1024 * 1024);
+
+	/** Deltas recorded until the matching EndTransaction undo as one step, nested calls join the outer transaction */
+	void BeginTransaction();
+	void EndTransaction();
+	/** Appends Delta to the open transaction, or as a transaction of its own when none is open */
+	void Record(const FCanvasDelta& Delta);
+
+	bool CanUndo() const { return NumApplied > 0 && OpenDepth == 0; }
+	bool CanRedo() const { return NumApplied < Transactions.Num() && OpenDepth == 0; }
+	/** Calls Apply with the inverse of every delta of the last applied transaction, newest first */
+	bool Undo(TFunctionRef<void(const FCanvasDelta&)> Apply);
+	/** Calls Apply with every delta of the last undone transaction, oldest first */
+	bool Redo(TFunctionRef<void(const FCanvasDelta&)> Apply);
+	void Reset();
+
+	/** Past this the oldest transactions are dropped, the last one is always kept */
+	void SetMaxBytes(int64 InMaxBytes) { MaxBytes = FMath::Max<int64>(InMaxBytes, BlockSize); }
+	int32 NumUndo() const { return NumApplied; }
+	int32 NumRedo() const { return Transactions.Num() - NumApplied; }
+	int32 NumDeltas() const { return Entries.Num(); }
+	/** Bytes held by the blocks */
+	int64 GetAllocatedSize() const { return AllocatedBytes; }
+
+	/** Appends Delta as a header followed by Before and After, the format of the journal and of the autosave logs */
+	static void WriteDelta(const FCanvasDelta& Delta, TArray<uint8>& Bytes);
+	/** Calls Func with every delta of Bytes, returns false at the first truncated or corrupt one */
+	static bool ReadDeltas(TArrayView<const uint8> Bytes, TFunctionRef<void(const FCanvasDelta&)> Func);
+
+private:
+	struct FEntry
+	{
+		const uint8* Data;
+		int32 Size;
+		/** Serial number of the block holding the delta */
+		int64 Block;
+	};
+
+	/** Reserved once and never grown, so the entries can point into them */
+	TArray<TArray<uint8>> Blocks;
+	/** Serial number of Blocks[0], the blocks of dropped transactions are removed from the front */
+	int64 FirstBlock = 0;
+	int64 AllocatedBytes = 0;
+	int64 MaxBytes;
+	TArray<FEntry> Entries;
+	/** Index of the first entry of every transaction */
+	TArray<int32> Transactions;
+	/** Transactions applied, the ones after them were undone and can be redone */
+	int32 NumApplied = 0;
+	int32 OpenDepth = 0;
+	/** Set by the outermost BeginTransaction, the transaction is only added with its first delta */
+	bool bTransactionPending = false;
+
+	uint8* Allocate(int32 Size, int64& OutBlock);
+	int32 GetTransactionEnd(int32 Transaction) const;
+	void DropRedo();
+	void DropOldest();
+};
+
+/** Groups the deltas recorded during its lifetime into one transaction */
+struct FCanvasJournalScope
+{
+	explicit FCanvasJournalScope(FCanvasJournal& InJournal)
+		: Journal(InJournal)
+	{
+		Journal.BeginTransaction();
+	}
+
+	~FCanvasJournalScope()
+	{
+		Journal.EndTransaction();
+	}
+
+	FCanvasJournal& Journal;
+};
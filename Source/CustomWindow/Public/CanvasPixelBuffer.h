@@ -0,0 +1,53 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "Templates/Function.h"
+
+class UTexture2D;
+
+/**
+ * CPU side BGRA pixels of a dynamic tile, for heatmaps and grids that change every frame. Any thread can write while
+ * the tile is drawn: writers only hold the lock for their own copy, and the viewport draws the texture, never the
+ * buffer. Every write records its rectangle, and the game thread uploads only those rectangles to the tile texture.
+ */
+class FCanvasPixelBuffer
+{
+public:
+	/** Dirty rectangles above this are merged into their bounding box */
+	static constexpr int32 MaxDirtyRects = 8;
+
+	explicit FCanvasPixelBuffer(const FIntPoint& InSize);
+
+	FIntPoint GetSize() const { return Size; }
+
+	/** Copies Pixels, rows of Rect.Width() pixels, into Rect. Parts of Rect outside the buffer are skipped */
+	void WritePixels(const FIntRect& Rect, TArrayView<const FColor> Pixels);
+	void SetPixel(int32 X, int32 Y, const FColor& Color);
+	void Fill(const FColor& Color);
+	/** Calls Writer under the lock with the first pixel of Rect and the row stride in pixels, Writer must stay in Rect */
+	void Edit(const FIntRect& Rect, TFunctionRef<void(FColor* Pixels, int32 Stride)> Writer);
+
+	/**
+	 * Copies the rectangles written since the last call into upload buffers and queues them to Texture, which must be
+	 * Size and PF_B8G8R8A8. The copies are freed once the render thread is done with them. Game thread only, returns the
+	 * number of pixels queued.
+	 */
+	int64 UploadDirtyRegions(UTexture2D* Texture);
+
+	/** Total pixels queued for upload so far, against the pixels of the buffer tells how partial the uploads are */
+	int64 GetNumUploadedPixels() const { return NumUploadedPixels; }
+
+private:
+	FIntPoint Size;
+	TArray<FColor> Pixels;
+	TArray<FIntRect> DirtyRects;
+	int64 NumUploadedPixels = 0;
+	FCriticalSection Lock;
+
+	/** Clips Rect to the buffer, returns false when nothing is left */
+	bool ClipRect(FIntRect& Rect) const;
+	void AddDirtyRect(const FIntRect& Rect);
+};
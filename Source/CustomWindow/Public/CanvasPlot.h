@@ -0,0 +1,79 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include <atomic>
+
+/**
+ * Fixed capacity ring buffer of samples, shown by the viewport client as a line graph. Append can be called from any
+ * thread at high rates. Every time a block of BlockSize samples fills up its min and max are stored, so decimating to a
+ * pixel width reads one summary per block for the bulk of a column and only scans the samples at the column edges: the
+ * cost follows the number of columns rather than the number of samples.
+ */
+class FCanvasPlot
+{
+public:
+	static constexpr int32 BlockSize = 64;
+
+	/** Capacity is rounded up to a multiple of BlockSize, see AlignCapacity */
+	explicit FCanvasPlot(int32 InCapacity);
+
+	static int32 AlignCapacity(int32 InCapacity) { return Align(FMath::Clamp(InCapacity, 1, 1 << 26), BlockSize); }
+
+	void Append(float Sample);
+	void Append(TArrayView<const float> InSamples);
+	void Reset();
+
+	/**
+	 * Min and max of the buffered samples in NumColumns equal columns, oldest first. Writes fewer columns when there are
+	 * fewer samples than columns, and returns the number written.
+	 */
+	int32 Decimate(int32 NumColumns, TArray<FVector2f>& OutMinMax) const;
+
+	int32 GetCapacity() const { return Capacity; }
+	int32 Num() const { return static_cast<int32>(FMath::Min<uint64>(GetNumAppended(), Capacity)); }
+	/** Samples appended since the last Reset, polled by the client without taking the lock */
+	uint64 GetNumAppended() const { return PublishedCount.load(std::memory_order_relaxed); }
+
+private:
+	TArray<float> Samples;
+	/** Min and max of every block, valid for the blocks completely inside the buffered range */
+	TArray<float> BlockMin;
+	TArray<float> BlockMax;
+	int32 Capacity = 0;
+	uint64 NumAppended = 0;
+	std::atomic<uint64> PublishedCount{ 0 };
+	/** Writers hold it for a copy, the reader for one decimation */
+	mutable FCriticalSection Lock;
+
+	void AppendLocked(const float* InSamples, int32 Num);
+	void ScanRange(uint64 Begin, uint64 End, float& InOutMin, float& InOutMax) const;
+	void ScanSamples(uint64 Begin, uint64 End, float& InOutMin, float& InOutMax) const;
+};
+
+/** Plot placed in a viewport client, the buffer may also be held by the threads feeding it */
+struct FCanvasPlotInstance
+{
+	FName Name;
+	FVector2D Position = FVector2D::ZeroVector;
+	FVector2D Size = FVector2D::UnitVector;
+	FLinearColor Color = FLinearColor::Green;
+	float MinValue = 0.f;
+	float MaxValue = 0.f;
+	TSharedPtr<FCanvasPlot, ESPMode::ThreadSafe> Buffer;
+};
+
+/** Plot decimated to the pixel width it is drawn at, one min and max per column */
+struct FCanvasPlotSnapshot
+{
+	FBox2D Bounds = FBox2D(ForceInit);
+	FLinearColor Color = FLinearColor::Green;
+	float MinValue = 0.f;
+	float MaxValue = 1.f;
+	TArray<FVector2f> Columns;
+};
+
+/** Folds the min and max of Num contiguous samples into InOutMin and InOutMax, eight samples per iteration in SIMD lanes */
+void CanvasPlotMinMax(const float* Samples, int32 Num, float& InOutMin, float& InOutMax);
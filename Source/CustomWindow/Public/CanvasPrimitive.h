@@ -0,0 +1,149 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CanvasItemData.h"
+#include "CanvasScene.h"
+#include "Misc/TVariant.h"
+
+/** How the settings panel shows a field beyond what its type implies */
+enum class ECanvasFieldHint : uint8
+{
+	None,
+	/** FVector2D edited as W and H instead of X and Y */
+	Extent,
+	/** FString holding the object path of a UFont */
+	FontPath,
+	/** FString holding the object path of a UTexture2D */
+	TexturePath,
+	/** FLinearColor whose alpha the panel keeps at 1 */
+	OpaqueColor,
+};
+
+/** One field of a primitive's data, as the panel and the JSON format name it */
+struct FCanvasField
+{
+	const TCHAR* Label;
+	const TCHAR* Key;
+	ECanvasFieldHint Hint = ECanvasFieldHint::None;
+};
+
+/**
+ * Describes a primitive once: the instance type the scene stores for it, where it lives in FCanvasSceneData, and its
+ * fields. VisitFields calls Visitor(const FCanvasField&, FieldType&) for every field, and the settings panel, the JSON
+ * form and the binary records are all generated from it. The binary records are the fields in visiting order, so the
+ * order is part of the file format.
+ *
+ * Fields can be FName, FString, float, int32, FVector2D or FLinearColor.
+ */
+template<typename DataType>
+struct TCanvasPrimitive;
+
+template<>
+struct TCanvasPrimitive<FBoxData>
+{
+	using DataType = FBoxData;
+	using InstanceType = FBoxInstance;
+	static constexpr ECanvasItemType Type = ECanvasItemType::Box;
+	static constexpr const TCHAR* Label = TEXT("Box");
+	static constexpr const TCHAR* Key = TEXT("boxes");
+	static constexpr TArray<FBoxData> FCanvasSceneData::* Items = &FCanvasSceneData::Boxes;
+
+	template<typename ItemType, typename VisitorType>
+	static void VisitFields(ItemType& Data, VisitorType&& Visitor)
+	{
+		Visitor(FCanvasField{ TEXT("Name"), TEXT("name") }, Data.Name);
+		Visitor(FCanvasField{ TEXT("Layer"), TEXT("layer") }, Data.Layer);
+		Visitor(FCanvasField{ TEXT("Position"), TEXT("position") }, Data.Position);
+		Visitor(FCanvasField{ TEXT("Size"), TEXT("size"), ECanvasFieldHint::Extent }, Data.Size);
+		Visitor(FCanvasField{ TEXT("Color"), TEXT("color") }, Data.Color);
+		Visitor(FCanvasField{ TEXT("Thickness"), TEXT("thickness") }, Data.Thickness);
+	}
+};
+
+template<>
+struct TCanvasPrimitive<FTextData>
+{
+	using DataType = FTextData;
+	using InstanceType = FTextInstance;
+	static constexpr ECanvasItemType Type = ECanvasItemType::Text;
+	static constexpr const TCHAR* Label = TEXT("Text");
+	static constexpr const TCHAR* Key = TEXT("texts");
+	static constexpr TArray<FTextData> FCanvasSceneData::* Items = &FCanvasSceneData::Texts;
+
+	template<typename ItemType, typename VisitorType>
+	static void VisitFields(ItemType& Data, VisitorType&& Visitor)
+	{
+		Visitor(FCanvasField{ TEXT("Name"), TEXT("name") }, Data.Name);
+		Visitor(FCanvasField{ TEXT("Layer"), TEXT("layer") }, Data.Layer);
+		Visitor(FCanvasField{ TEXT("Position"), TEXT("position") }, Data.Position);
+		Visitor(FCanvasField{ TEXT("Color"), TEXT("color") }, Data.Color);
+		Visitor(FCanvasField{ TEXT("Font Size"), TEXT("fontSize") }, Data.FontSize);
+		Visitor(FCanvasField{ TEXT("Message"), TEXT("message") }, Data.Message);
+		Visitor(FCanvasField{ TEXT("Font"), TEXT("font"), ECanvasFieldHint::FontPath }, Data.FontPath);
+	}
+};
+
+template<>
+struct TCanvasPrimitive<FTileData>
+{
+	using DataType = FTileData;
+	using InstanceType = FTileInstance;
+	static constexpr ECanvasItemType Type = ECanvasItemType::Tile;
+	static constexpr const TCHAR* Label = TEXT("Texture");
+	static constexpr const TCHAR* Key = TEXT("tiles");
+	static constexpr TArray<FTileData> FCanvasSceneData::* Items = &FCanvasSceneData::Tiles;
+
+	template<typename ItemType, typename VisitorType>
+	static void VisitFields(ItemType& Data, VisitorType&& Visitor)
+	{
+		Visitor(FCanvasField{ TEXT("Name"), TEXT("name") }, Data.Name);
+		Visitor(FCanvasField{ TEXT("Layer"), TEXT("layer") }, Data.Layer);
+		Visitor(FCanvasField{ TEXT("Position"), TEXT("position") }, Data.Position);
+		Visitor(FCanvasField{ TEXT("Size"), TEXT("size"), ECanvasFieldHint::Extent }, Data.Size);
+		Visitor(FCanvasField{ TEXT("Color"), TEXT("color"), ECanvasFieldHint::OpaqueColor }, Data.Color);
+		Visitor(FCanvasField{ TEXT("Texture"), TEXT("texture"), ECanvasFieldHint::TexturePath }, Data.TexturePath);
+	}
+};
+
+/** The registered primitives, in ECanvasItemType order. Everything generic over primitives iterates this list */
+template<typename... DataTypes>
+struct TCanvasPrimitiveList
+{
+	static constexpr int32 Num = sizeof...(DataTypes);
+
+	/** Calls Func(TCanvasPrimitive<DataType>()) for every primitive, resolved at compile time */
+	template<typename FuncType>
+	static void ForEach(FuncType&& Func)
+	{
+		(Func(TCanvasPrimitive<DataTypes>()), ...);
+	}
+
+	/** One data or one array of data per primitive, index them with GetIndex */
+	using FData = TTuple<DataTypes...>;
+	using FDataArrays = TTuple<TArray<DataTypes>...>;
+
+	/** One Template<DataType> per primitive, index it with GetIndex */
+	template<template<typename> class Template>
+	using TTupleOf = TTuple<Template<DataTypes>...>;
+
+	template<typename ExtraType>
+	using TVariantWith = TVariant<DataTypes..., ExtraType>;
+
+	template<typename DataType>
+	static constexpr uint32 GetIndex() { return static_cast<uint32>(TCanvasPrimitive<DataType>::Type); }
+
+	static constexpr bool IsInTypeOrder()
+	{
+		uint32 Index = 0;
+		bool bOrdered = true;
+		((bOrdered &= static_cast<uint32>(TCanvasPrimitive<DataTypes>::Type) == Index++), ...);
+		return bOrdered;
+	}
+};
+
+using FCanvasPrimitives = TCanvasPrimitiveList<FBoxData, FTextData, FTileData>;
+
+static_assert(FCanvasPrimitives::Num == static_cast<int32>(ECanvasItemType::Num) && FCanvasPrimitives::IsInTypeOrder(),
+	"Every ECanvasItemType needs a primitive, listed in the order of the enum");
@@ -0,0 +1,424 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Algo/BinarySearch.h"
+#include "Algo/StableSort.h"
+#include "CanvasSpatialGrid.h"
+
+class FShapedGlyphSequence;
+class UFont;
+class UTexture2D;
+
+enum class ECanvasItemType : uint8
+{
+	Box,
+	Text,
+	Tile,
+	Num
+};
+
+struct FCanvasItemHandle
+{
+	int32 Slot = INDEX_NONE;
+	uint32 Generation = 0;
+
+	bool IsValid() const { return Slot != INDEX_NONE; }
+
+	bool operator==(const FCanvasItemHandle& Other) const { return Slot == Other.Slot && Generation == Other.Generation; }
+	bool operator!=(const FCanvasItemHandle& Other) const { return !(*this == Other); }
+
+	friend uint32 GetTypeHash(const FCanvasItemHandle& Handle) { return HashCombine(::GetTypeHash(Handle.Slot), ::GetTypeHash(Handle.Generation)); }
+};
+
+struct FBoxInstance
+{
+	FVector2D Position = FVector2D::ZeroVector;
+	FVector2D Size = FVector2D::UnitVector;
+	FLinearColor Color = FLinearColor::White;
+	float Thickness = 0.f;
+	int32 Layer = 0;
+	int32 Slot = INDEX_NONE;
+};
+
+/** One character of a cached text layout, relative to the text position with the text scale applied */
+struct FCanvasGlyphQuad
+{
+	FVector2D Min;
+	FVector2D Max;
+	FVector2D UVMin;
+	FVector2D UVMax;
+	int32 TextureIndex;
+};
+
+struct FTextInstance
+{
+	FVector2D Position = FVector2D::ZeroVector;
+	FVector2D Scale = FVector2D::UnitVector;
+	FLinearColor Color = FLinearColor::White;
+	FText Message;
+	const UFont* Font = nullptr;
+	/** Glyph quads built by BuildTextLayout, only filled for offline cached fonts */
+	TArray<FCanvasGlyphQuad> Glyphs;
+	/** Glyphs shaped by BuildTextLayout for single-line text in a runtime cached font */
+	TSharedPtr<const FShapedGlyphSequence> ShapedText;
+	FVector2D LayoutSize = FVector2D::ZeroVector;
+	int32 Layer = 0;
+	int32 Slot = INDEX_NONE;
+};
+
+/**
+ * Measures the text and lays it out once so drawing doesn't go through FCanvasTextItem: glyph quads for fonts with an
+ * offline glyph cache, a shaped glyph sequence for single-line text in a runtime font. Has to be called again when the
+ * message, font or scale changes.
+ */
+CUSTOMWINDOW_API void BuildTextLayout(FTextInstance& Text);
+
+struct FTileInstance
+{
+	FVector2D Position = FVector2D::ZeroVector;
+	FVector2D Size = FVector2D::UnitVector;
+	FLinearColor Color = FLinearColor::White;
+	/** Null while the texture is still streaming in, the tile is drawn as a placeholder until then */
+	UTexture2D* Texture = nullptr;
+	/** Atlas page holding a copy of the texture, drawn with UVMin and UVMax instead of the texture when set */
+	UTexture* AtlasPage = nullptr;
+	FVector2D UVMin = FVector2D::ZeroVector;
+	FVector2D UVMax = FVector2D::UnitVector;
+	FName TexturePath;
+	int32 Layer = 0;
+	int32 Slot = INDEX_NONE;
+};
+
+CUSTOMWINDOW_API FBox2D GetCanvasItemBounds(const FBoxInstance& Box);
+CUSTOMWINDOW_API FBox2D GetCanvasItemBounds(const FTextInstance& Text);
+CUSTOMWINDOW_API FBox2D GetCanvasItemBounds(const FTileInstance& Tile);
+
+/** Per-type item array shared between the scene and the render snapshots taken from it */
+template<typename T>
+using TCanvasItemArrayRef = TSharedRef<TArray<T>, ESPMode::ThreadSafe>;
+template<typename T>
+using TCanvasItemArrayConstRef = TSharedRef<const TArray<T>, ESPMode::ThreadSafe>;
+
+template<typename T>
+struct TCanvasItemStorage
+{
+	using ItemType = T;
+	TCanvasItemArrayRef<T> Items = MakeShared<TArray<T>, ESPMode::ThreadSafe>();
+	/** Array left to a snapshot by the last copy, the next copy reuses it once the snapshot let go of it */
+	TCanvasItemArrayRef<T> Spare = MakeShared<TArray<T>, ESPMode::ThreadSafe>();
+};
+
+/** Item type of each instance type, and where it is drawn among the items of the same layer */
+template<typename T> struct TCanvasItemType;
+template<> struct TCanvasItemType<FBoxInstance> { static constexpr ECanvasItemType Value = ECanvasItemType::Box; static constexpr int32 DrawOrder = 1; };
+template<> struct TCanvasItemType<FTextInstance> { static constexpr ECanvasItemType Value = ECanvasItemType::Text; static constexpr int32 DrawOrder = 2; };
+template<> struct TCanvasItemType<FTileInstance> { static constexpr ECanvasItemType Value = ECanvasItemType::Tile; static constexpr int32 DrawOrder = 0; };
+
+/**
+ * Item store of the custom viewport. Every primitive type lives packed in its own array so drawing is a linear walk,
+ * names resolve to a slot that records the type and the index of the item inside its array. Item bounds are kept in a
+ * spatial grid keyed by slot so drawing can be restricted to what is visible.
+ *
+ * Each array is kept sorted by layer, items of the same layer stay in insertion order. Replacing an item keeps its
+ * position unless its layer changes, so the draw order is deterministic.
+ *
+ * The arrays are copy-on-write: ShareItems hands out an immutable reference, and the first edit of a shared array
+ * copies it. A snapshot therefore costs nothing, and since the viewport releases its snapshot as soon as it has been
+ * drawn, edits normally find the arrays unshared and copy nothing. Holders that keep a reference longer make the next
+ * edit copy the whole array of that type; copies alternate between two arrays per type so they don't allocate.
+ */
+class CUSTOMWINDOW_API FCanvasScene
+{
+public:
+	/** Adds the item, or replaces it in place when an item with the same name already exists */
+	template<typename T>
+	FCanvasItemHandle Add(FName Name, T&& Instance)
+	{
+		using InstanceType = typename TDecay<T>::Type;
+		constexpr ECanvasItemType Type = TCanvasItemType<InstanceType>::Value;
+		TArray<InstanceType>& Items = EditItems<InstanceType>();
+
+		if (const int32* ExistingSlot = NameToSlot.Find(Name))
+		{
+			const int32 SlotIndex = *ExistingSlot;
+			const FSlot& Slot = Slots[SlotIndex];
+			if (Slot.Type == Type)
+			{
+				if (Items[Slot.Index].Layer == Instance.Layer)
+				{
+					InstanceType& Existing = Items[Slot.Index];
+					Existing = Forward<T>(Instance);
+					Existing.Slot = SlotIndex;
+					SpatialIndex.Update(SlotIndex, GetCanvasItemBounds(Existing));
+				}
+				else
+				{
+					RemoveFromArray<InstanceType>(Slot.Index);
+					InsertSorted(SlotIndex, Forward<T>(Instance));
+				}
+				return FCanvasItemHandle{ SlotIndex, Slot.Generation };
+			}
+			RemoveSlot(SlotIndex);
+		}
+
+		const int32 SlotIndex = AllocateSlot(Name, Type);
+		InsertSorted(SlotIndex, Forward<T>(Instance));
+		NameToSlot.Add(Name, SlotIndex);
+		return FCanvasItemHandle{ SlotIndex, Slots[SlotIndex].Generation };
+	}
+
+	/**
+	 * Adds or replaces many items of one type. New items are appended and the array is sorted by layer once at the end
+	 * when needed, instead of searching the insertion point for every item. Instances are moved from.
+	 */
+	template<typename T>
+	void AddBatch(TArrayView<const FName> Names, TArrayView<T> Instances)
+	{
+		check(Names.Num() == Instances.Num());
+		constexpr ECanvasItemType Type = TCanvasItemType<T>::Value;
+		TArray<T>& Items = EditItems<T>();
+		Items.Reserve(Items.Num() + Instances.Num());
+		Slots.Reserve(Slots.Num() + Instances.Num());
+		NameToSlot.Reserve(NameToSlot.Num() + Instances.Num());
+
+		bool bNeedsSort = false;
+		for (int32 Index = 0; Index < Instances.Num(); ++Index)
+		{
+			const FName Name = Names[Index];
+			T& Instance = Instances[Index];
+
+			if (const int32* ExistingSlot = NameToSlot.Find(Name))
+			{
+				const int32 SlotIndex = *ExistingSlot;
+				if (Slots[SlotIndex].Type == Type)
+				{
+					T& Existing = Items[Slots[SlotIndex].Index];
+					if (Existing.Layer == Instance.Layer)
+					{
+						Existing = MoveTemp(Instance);
+						Existing.Slot = SlotIndex;
+						SpatialIndex.Update(SlotIndex, GetCanvasItemBounds(Existing));
+						continue;
+					}
+
+					// Like Add, an item changing layer goes after the items already in its new layer
+					RemoveFromArray<T>(Slots[SlotIndex].Index);
+					AppendItem(SlotIndex, MoveTemp(Instance), bNeedsSort);
+					continue;
+				}
+				RemoveSlot(SlotIndex);
+			}
+
+			const int32 SlotIndex = AllocateSlot(Name, Type);
+			AppendItem(SlotIndex, MoveTemp(Instance), bNeedsSort);
+			NameToSlot.Add(Name, SlotIndex);
+		}
+
+		if (bNeedsSort)
+		{
+			Algo::StableSortBy(Items, [](const T& Item) { return Item.Layer; });
+			FixSlotIndices(Items, 0);
+		}
+	}
+
+	template<typename T>
+	const T* Get(FCanvasItemHandle Handle) const
+	{
+		if (!IsValid(Handle) || Slots[Handle.Slot].Type != TCanvasItemType<T>::Value)
+		{
+			return nullptr;
+		}
+		return &GetItems<T>()[Slots[Handle.Slot].Index];
+	}
+
+	/** Like Get but for modifying the item in place, call UpdateBounds afterwards if its bounds changed */
+	template<typename T>
+	T* Edit(FCanvasItemHandle Handle)
+	{
+		if (!IsValid(Handle) || Slots[Handle.Slot].Type != TCanvasItemType<T>::Value)
+		{
+			return nullptr;
+		}
+		return &EditItems<T>()[Slots[Handle.Slot].Index];
+	}
+
+	template<typename T>
+	const TArray<T>& GetItems() const { return *GetStorage<T>().Items; }
+
+	/** Mutable access, copies the array first when a snapshot still shares it */
+	template<typename T>
+	TArray<T>& EditItems()
+	{
+		TCanvasItemStorage<T>& Storage = GetStorage<T>();
+		if (!Storage.Items.IsUnique())
+		{
+			if (Storage.Spare.IsUnique())
+			{
+				// Assign item by item so the items of the spare array keep their own allocations, glyphs in particular
+				const TArray<T>& Source = *Storage.Items;
+				TArray<T>& Copy = *Storage.Spare;
+				Copy.SetNum(Source.Num(), false);
+				for (int32 Index = 0; Index < Source.Num(); ++Index)
+				{
+					Copy[Index] = Source[Index];
+				}
+				Swap(Storage.Items, Storage.Spare);
+			}
+			else
+			{
+				Storage.Spare = Storage.Items;
+				Storage.Items = MakeShared<TArray<T>, ESPMode::ThreadSafe>(*Storage.Spare);
+			}
+		}
+		return *Storage.Items;
+	}
+
+	template<typename T>
+	TCanvasItemArrayConstRef<T> ShareItems() const { return GetStorage<T>().Items; }
+
+	FCanvasItemHandle Find(FName Name) const;
+	bool IsValid(FCanvasItemHandle Handle) const;
+	/** ECanvasItemType::Num for stale handles */
+	ECanvasItemType GetType(FCanvasItemHandle Handle) const { return IsValid(Handle) ? Slots[Handle.Slot].Type : ECanvasItemType::Num; }
+	FName GetName(int32 SlotIndex) const { return Slots[SlotIndex].Name; }
+
+	/** Re-reads the bounds of the item in SlotIndex after it was modified in place */
+	void UpdateBounds(int32 SlotIndex);
+
+	/** Collects the array indices of the items intersecting Rect, sorted so they keep their array order */
+	void QueryVisible(const FBox2D& Rect, TArray<int32>& OutBoxes, TArray<int32>& OutTexts, TArray<int32>& OutTiles) const;
+
+	/**
+	 * Topmost item whose bounds contain Point, following the draw order: highest layer first, then texts over boxes over
+	 * tiles, then the last one in its array. Only the grid cell under the point is visited.
+	 */
+	FCanvasItemHandle Pick(const FVector2D& Point) const;
+	/** Appends the handles of the items intersecting Rect */
+	void QueryRect(const FBox2D& Rect, TArray<FCanvasItemHandle>& OutHandles) const;
+	/** Bounds indexed for the item, invalid for stale handles */
+	FBox2D GetBounds(FCanvasItemHandle Handle) const;
+	/** Index of the item among the items of its type and layer leaving out the Ignored ones, INDEX_NONE for stale handles */
+	int32 GetLayerPosition(FCanvasItemHandle Handle, TArrayView<const FCanvasItemHandle> Ignored = TArrayView<const FCanvasItemHandle>()) const;
+	/** Moves the item to Position among the items of its type and layer, clamped to the layer */
+	void SetLayerPosition(FCanvasItemHandle Handle, int32 Position);
+	const FCanvasSpatialGrid& GetSpatialIndex() const { return SpatialIndex; }
+
+	bool Remove(FName Name);
+	bool Remove(FCanvasItemHandle Handle);
+	/** Removes every item, the handles given out before stay stale */
+	void Empty();
+	int32 Num() const { return NameToSlot.Num(); }
+
+private:
+	struct FSlot
+	{
+		FName Name;
+		int32 Index = INDEX_NONE;
+		uint32 Generation = 0;
+		ECanvasItemType Type = ECanvasItemType::Num;
+	};
+
+	/** One storage per item type, in ECanvasItemType order */
+	TTuple<TCanvasItemStorage<FBoxInstance>, TCanvasItemStorage<FTextInstance>, TCanvasItemStorage<FTileInstance>> Storages;
+	TArray<FSlot> Slots;
+	TArray<int32> FreeSlots;
+	TMap<FName, int32> NameToSlot;
+	FCanvasSpatialGrid SpatialIndex;
+
+	template<typename T> TCanvasItemStorage<T>& GetStorage() { return Storages.template Get<static_cast<uint32>(TCanvasItemType<T>::Value)>(); }
+	template<typename T> const TCanvasItemStorage<T>& GetStorage() const { return const_cast<FCanvasScene*>(this)->GetStorage<T>(); }
+
+	int32 AllocateSlot(FName Name, ECanvasItemType Type);
+	void RemoveSlot(int32 SlotIndex);
+
+	/** Calls Func with the storage of the slot's type, so per-slot code needs no switch over the item types */
+	template<typename FuncType>
+	void VisitSlot(const FSlot& Slot, FuncType&& Func) const
+	{
+		VisitTupleElements([&Slot, &Func](const auto& Storage)
+		{
+			if (Slot.Type == TCanvasItemType<typename TDecay<decltype(Storage)>::Type::ItemType>::Value)
+			{
+				Func(Storage);
+			}
+		}, Storages);
+	}
+
+	template<typename T>
+	void FixSlotIndices(const TArray<T>& Items, int32 FirstIndex)
+	{
+		for (int32 Index = FirstIndex; Index < Items.Num(); ++Index)
+		{
+			Slots[Items[Index].Slot].Index = Index;
+		}
+	}
+
+	/** Inserts after every item of the same or a lower layer, appending is the common case and doesn't shift anything */
+	template<typename T>
+	void InsertSorted(int32 SlotIndex, T&& Instance)
+	{
+		using InstanceType = typename TDecay<T>::Type;
+		TArray<InstanceType>& Items = EditItems<InstanceType>();
+
+		int32 Index = Items.Num();
+		if (Index > 0 && Items.Last().Layer > Instance.Layer)
+		{
+			Index = Algo::UpperBoundBy(Items, Instance.Layer, [](const InstanceType& Item) { return Item.Layer; });
+		}
+
+		InstanceType& Inserted = Items.Insert_GetRef(Forward<T>(Instance), Index);
+		Inserted.Slot = SlotIndex;
+		SpatialIndex.Update(SlotIndex, GetCanvasItemBounds(Inserted));
+		FixSlotIndices(Items, Index);
+	}
+
+	/** Appends without keeping the layer order, AddBatch sorts once at the end when bNeedsSort was set */
+	template<typename T>
+	void AppendItem(int32 SlotIndex, T&& Instance, bool& bNeedsSort)
+	{
+		TArray<T>& Items = EditItems<T>();
+		bNeedsSort |= Items.Num() > 0 && Items.Last().Layer > Instance.Layer;
+		Slots[SlotIndex].Index = Items.Num();
+		T& Added = Items.Add_GetRef(MoveTemp(Instance));
+		Added.Slot = SlotIndex;
+		SpatialIndex.Update(SlotIndex, GetCanvasItemBounds(Added));
+	}
+
+	template<typename T>
+	static int32 GetLayerStart(const TArray<T>& Items, int32 Layer)
+	{
+		return Algo::LowerBoundBy(Items, Layer, [](const T& Item) { return Item.Layer; });
+	}
+
+	template<typename T>
+	void MoveInLayer(int32 SlotIndex, int32 Position)
+	{
+		const TArray<T>& Items = GetItems<T>();
+		const int32 From = Slots[SlotIndex].Index;
+		const int32 Layer = Items[From].Layer;
+		const int32 LayerStart = GetLayerStart(Items, Layer);
+		const int32 LayerEnd = Algo::UpperBoundBy(Items, Layer, [](const T& Item) { return Item.Layer; });
+		const int32 To = FMath::Clamp(LayerStart + Position, LayerStart, LayerEnd - 1);
+		if (To == From)
+		{
+			return;
+		}
+
+		TArray<T>& Edited = EditItems<T>();
+		T Item = MoveTemp(Edited[From]);
+		Edited.RemoveAt(From, 1, false);
+		Edited.Insert(MoveTemp(Item), To);
+		FixSlotIndices(Edited, FMath::Min(From, To));
+	}
+
+	template<typename T>
+	void RemoveFromArray(int32 Index)
+	{
+		TArray<T>& Items = EditItems<T>();
+		Items.RemoveAt(Index, 1, false);
+		FixSlotIndices(Items, Index);
+	}
+};
+
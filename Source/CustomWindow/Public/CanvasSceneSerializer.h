@@ -0,0 +1,38 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CustomWindow.h"
+
+/**
+ * Reads and writes FCanvasSceneData.
+ *
+ * The binary format is a fixed header followed by one packed array of fixed size records per primitive type and a
+ * deduplicated UTF-8 string table. Loading maps the file and walks the record arrays directly, there is nothing to
+ * tokenize. The JSON form carries the same fields and is meant for diffing and hand edits.
+ */
+class CUSTOMWINDOW_API FCanvasSceneSerializer
+{
+public:
+	static constexpr uint32 BinaryMagic = 0x43535743; // "CWSC"
+	static constexpr uint32 BinaryVersion = 1;
+	/** Written to the "version" field, ReadJson rejects documents without it or with a newer one */
+	static constexpr int32 JsonVersion = 1;
+
+	static void WriteBinary(const FCanvasSceneData& Data, TArray<uint8>& OutBytes);
+	static bool ReadBinary(TArrayView<const uint8> Bytes, FCanvasSceneData& OutData);
+
+	static bool SaveBinary(const FCanvasSceneData& Data, const FString& Filename);
+	static bool LoadBinary(const FString& Filename, FCanvasSceneData& OutData);
+
+	static FString WriteJson(const FCanvasSceneData& Data);
+	static bool ReadJson(const FString& Json, FCanvasSceneData& OutData);
+
+	static bool SaveJson(const FCanvasSceneData& Data, const FString& Filename);
+	static bool LoadJson(const FString& Filename, FCanvasSceneData& OutData);
+
+	/** Picks JSON for .json files and the binary format otherwise */
+	static bool Save(const FCanvasSceneData& Data, const FString& Filename);
+	static bool Load(const FString& Filename, FCanvasSceneData& OutData);
+};
@@ -0,0 +1,113 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Uniform grid over canvas item bounds, keyed by scene slot. Items spanning more than MaxCellsPerItem cells are kept
+ * in a separate list that every query tests, so a few huge items don't flood the cells.
+ */
+class CUSTOMWINDOW_API FCanvasSpatialGrid
+{
+public:
+	static constexpr int32 MaxCellsPerItem = 64;
+	/** Cell coordinates are clamped to this, so far away or non-finite bounds can't overflow the cell ranges */
+	static constexpr int32 MaxCellCoord = 1 << 30;
+
+	explicit FCanvasSpatialGrid(float InCellSize = 256.f);
+
+	/** Inserts the item, or moves it when it is already indexed */
+	void Update(int32 Id, const FBox2D& Bounds);
+	void Remove(int32 Id);
+	void Reset();
+
+	bool Contains(int32 Id) const { return Entries.IsValidIndex(Id) && Entries[Id].bIndexed; }
+	const FBox2D& GetBounds(int32 Id) const { return Entries[Id].Bounds; }
+	float GetCellSize() const { return CellSize; }
+
+	/** Calls Func(Id) once for every item whose bounds intersect Rect */
+	template<typename FuncType>
+	void Query(const FBox2D& Rect, FuncType&& Func) const
+	{
+		if (++QueryStamp == 0)
+		{
+			for (FEntry& Entry : Entries)
+			{
+				Entry.QueryStamp = 0;
+			}
+			QueryStamp = 1;
+		}
+
+		auto Visit = [this, &Rect, &Func](int32 Id)
+		{
+			FEntry& Entry = Entries[Id];
+			if (Entry.QueryStamp != QueryStamp)
+			{
+				Entry.QueryStamp = QueryStamp;
+				if (Entry.Bounds.Intersect(Rect))
+				{
+					Func(Id);
+				}
+			}
+		};
+
+		for (int32 Id : Oversized)
+		{
+			Visit(Id);
+		}
+
+		const FIntRect Range = GetCellRange(Rect);
+		if (GetNumCells(Range) > Cells.Num())
+		{
+			for (const auto& Cell : Cells)
+			{
+				if (Cell.Key.X >= Range.Min.X && Cell.Key.X <= Range.Max.X && Cell.Key.Y >= Range.Min.Y && Cell.Key.Y <= Range.Max.Y)
+				{
+					for (int32 Id : Cell.Value)
+					{
+						Visit(Id);
+					}
+				}
+			}
+			return;
+		}
+
+		for (int32 Y = Range.Min.Y; Y <= Range.Max.Y; ++Y)
+		{
+			for (int32 X = Range.Min.X; X <= Range.Max.X; ++X)
+			{
+				if (const TArray<int32>* Cell = Cells.Find(FIntPoint(X, Y)))
+				{
+					for (int32 Id : *Cell)
+					{
+						Visit(Id);
+					}
+				}
+			}
+		}
+	}
+
+private:
+	struct FEntry
+	{
+		FBox2D Bounds = FBox2D(ForceInit);
+		FIntRect CellRange;
+		uint32 QueryStamp = 0;
+		bool bIndexed = false;
+		bool bOversized = false;
+	};
+
+	float CellSize;
+	TMap<FIntPoint, TArray<int32>> Cells;
+	TArray<int32> Oversized;
+	mutable TArray<FEntry> Entries;
+	mutable uint32 QueryStamp = 0;
+
+	FIntRect GetCellRange(const FBox2D& Bounds) const;
+	static int64 GetNumCells(const FIntRect& Range)
+	{
+		return (static_cast<int64>(Range.Max.X) - Range.Min.X + 1) * (static_cast<int64>(Range.Max.Y) - Range.Min.Y + 1);
+	}
+	void Unlink(int32 Id);
+};
@@ -0,0 +1,104 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/GCObject.h"
+#include "UObject/ObjectPtr.h"
+
+class UTexture;
+class UTexture2D;
+class UTextureRenderTarget2D;
+
+/** Where a texture ended up in the atlas, tiles draw the page with these UVs instead of the source texture */
+struct FCanvasAtlasRegion
+{
+	UTexture* Page = nullptr;
+	FVector2D UVMin = FVector2D::ZeroVector;
+	FVector2D UVMax = FVector2D::UnitVector;
+};
+
+struct FCanvasAtlasStats
+{
+	int32 NumPages = 0;
+	int32 NumEntries = 0;
+	/** Textures that were too big or didn't fit in the memory cap, their tiles keep drawing the source texture */
+	int32 NumRejected = 0;
+	int32 NumUploads = 0;
+	/** Pixels covered by packed textures and their padding, against the pixels of all pages */
+	int64 UsedPixels = 0;
+	int64 PagePixels = 0;
+	int64 ResidentBytes = 0;
+
+	float GetOccupancy() const { return PagePixels > 0 ? static_cast<float>(UsedPixels) / PagePixels : 0.f; }
+};
+
+/**
+ * Packs small tile textures into shared render target pages so tiles using different textures still go out as one
+ * batch. Every page is split into shelves, rows of textures of similar height, and a texture takes the first span wide
+ * enough on the best fitting shelf. Entries are reference counted by path like the texture cache, the span of the last
+ * release goes back to its shelf and is reused by the next texture that fits, so pages are never repacked as a whole.
+ */
+class FCanvasTextureAtlas : public FGCObject
+{
+public:
+	/** Adds a reference to the packed copy of Texture, returns false when the atlas is disabled or the texture can't be packed */
+	bool Acquire(FName Path, UTexture2D* Texture, FCanvasAtlasRegion& OutRegion);
+	void Release(FName Path);
+
+	/** Copies the textures packed since the last call into their pages, game thread only. Returns true when a page changed */
+	bool FlushUploads();
+
+	float GetPageOccupancy(int32 PageIndex) const;
+	const FCanvasAtlasStats& GetStats() const { return Stats; }
+
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override { return TEXT("FCanvasTextureAtlas"); }
+
+private:
+	struct FShelf
+	{
+		int32 Y = 0;
+		int32 Height = 0;
+		/** Start of the never used part of the shelf */
+		int32 CursorX = 0;
+		/** Released spans left of CursorX as X and width */
+		TArray<FIntPoint> FreeSpans;
+		int32 NumEntries = 0;
+	};
+
+	struct FPage
+	{
+		/** Null once the page was released, the slot is reused by the next page */
+		TObjectPtr<UTextureRenderTarget2D> Texture;
+		TArray<FShelf> Shelves;
+		int32 Size = 0;
+		int32 NextShelfY = 0;
+		int32 NumEntries = 0;
+		int64 UsedPixels = 0;
+	};
+
+	struct FEntry
+	{
+		/** Kept until the copy into the page is done */
+		TObjectPtr<UTexture2D> PendingSource;
+		int32 PageIndex = INDEX_NONE;
+		int32 ShelfIndex = INDEX_NONE;
+		/** Allocated rectangle, padding included */
+		FIntRect Rect;
+		FCanvasAtlasRegion Region;
+		int32 RefCount = 0;
+	};
+
+	TArray<FPage> Pages;
+	TMap<FName, FEntry> Entries;
+	TArray<FName> PendingUploads;
+	FCanvasAtlasStats Stats;
+
+	bool Allocate(const FIntPoint& Size, FEntry& OutEntry);
+	bool AllocateInPage(int32 PageIndex, const FIntPoint& Size, FEntry& OutEntry);
+	void Free(const FEntry& Entry);
+	int32 AddPage();
+	void ReleasePage(int32 PageIndex);
+	void UpdateStats();
+};
@@ -0,0 +1,83 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/GCObject.h"
+#include "UObject/ObjectPtr.h"
+
+class UTexture2D;
+struct FStreamableHandle;
+
+struct FTextureCacheStats
+{
+	int32 Hits = 0;
+	int32 Misses = 0;
+	int32 Evictions = 0;
+	int32 NumRequested = 0;
+	int32 NumCoalesced = 0;
+	int32 NumLoaded = 0;
+	int32 NumFailed = 0;
+	int64 ResidentBytes = 0;
+	double LastLatency = 0.0;
+	double MaxLatency = 0.0;
+	double TotalLatency = 0.0;
+
+	double GetAverageLatency() const { return NumLoaded > 0 ? TotalLatency / NumLoaded : 0.0; }
+	float GetHitRate() const { return Hits + Misses > 0 ? static_cast<float>(Hits) / (Hits + Misses) : 0.f; }
+};
+
+/**
+ * Textures used by canvas tiles, keyed by object path. Entries are loaded asynchronously, kept alive for the garbage
+ * collector and reference counted by the tiles using them. Unreferenced entries stay resident until the cache goes over
+ * its memory budget, then the least recently used ones are evicted first.
+ */
+class FCustomTextureCache : public FGCObject
+{
+public:
+	DECLARE_MULTICAST_DELEGATE_TwoParams(FOnTextureReady, FName /*Path*/, UTexture2D* /*Texture*/);
+
+	/** Broadcast when a texture requested through Acquire finished loading */
+	FOnTextureReady OnTextureReady;
+
+	FCustomTextureCache();
+	virtual ~FCustomTextureCache();
+
+	/** Adds a reference to the texture at Path, returns it when resident or null while it is being loaded */
+	UTexture2D* Acquire(FName Path);
+	void Release(FName Path);
+	UTexture2D* Find(FName Path) const;
+
+	/** Evicts unreferenced textures, least recently used first, until the resident size fits in the budget */
+	void Trim();
+	void SetBudget(int64 InBudgetBytes);
+	int64 GetBudget() const;
+
+	const FTextureCacheStats& GetStats() const { return Stats; }
+	int32 Num() const { return Entries.Num(); }
+
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override { return TEXT("FCustomTextureCache"); }
+
+private:
+	struct FEntry
+	{
+		TObjectPtr<UTexture2D> Texture;
+		TSharedPtr<FStreamableHandle> Handle;
+		double RequestTime = 0.0;
+		int64 ResourceSize = 0;
+		int32 RefCount = 0;
+		uint64 LastUsed = 0;
+		bool bFailed = false;
+	};
+
+	TMap<FName, FEntry> Entries;
+	FTextureCacheStats Stats;
+	uint64 UseClock = 0;
+	/** Negative means the budget follows CustomWindow.TextureCacheBudgetMB */
+	int64 BudgetBytes = -1;
+
+	void OnLoaded(FName Path);
+	void SetResident(FEntry& Entry, UTexture2D* Texture);
+	void Evict(FName Path);
+};
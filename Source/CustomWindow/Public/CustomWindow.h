@@ -5,9 +5,21 @@
 #include "CoreMinimal.h"
 #include "Modules/ModuleManager.h"
 #include "Brushes/SlateColorBrush.h"
+#include "CanvasAnimation.h"
+#include "CanvasCommandQueue.h"
+#include "CanvasItemData.h"
+#include "CanvasJournal.h"
+#include "CanvasPixelBuffer.h"
+#include "CanvasPlot.h"
+#include "CanvasPrimitive.h"
+#include "CanvasScene.h"
+#include "CanvasTextureAtlas.h"
+#include "CustomTextureCache.h"
 #include <functional>
 #include "Rendering/RenderingCommon.h"
+#include "UObject/StrongObjectPtr.h"
 #include "UnrealClient.h"
+#include "Widgets/Docking/SDockTab.h"
 #include "Widgets/SOverlay.h"
 #include "Widgets/SViewport.h"
 #include "Widgets/SWidget.h"
@@ -15,56 +27,420 @@
 #define ACTIVE_COLOR 80, 80, 80, 255
 #define DISABLED_COLOR 40, 40, 40, 255
 
+DECLARE_LOG_CATEGORY_EXTERN(LogCustomWindow, Log, All);
+
+class FCanvasAutosave;
+class FCanvasCapture;
 class FCanvasItem;
 class FSceneViewport;
-class FCanvasBoxItem;
-class FCanvasTextItem;
-class FCanvasTileItem;
+class UFont;
 
-struct FBoxData
+enum class ECanvasDrawMode : uint8
 {
-	FName Name;
-	FVector2D Position = FVector2D::ZeroVector;
-	FVector2D Size = FVector2D::UnitVector;
-	FLinearColor Color;
-	float Thickness = 0.1f;
+	/** One DrawItem call per canvas item */
+	PerItem,
+	/** Box edges gathered into one line batch, tiles into one triangle batch per texture */
+	Batched
 };
 
-struct FTextData
+/** Items and draw batches handed to a canvas */
+struct FCanvasDrawCounters
 {
-	FName Name;
-	FVector2D Position = FVector2D::ZeroVector;
-	float FontSize = 1.f;
-	FLinearColor Color;
-	FString Message;
+	int32 Items = 0;
+	int32 Batches = 0;
 };
 
-struct FTileData
+/**
+ * Immutable copy of everything Draw reads, built on the game thread when the viewport is dirty. The item arrays are
+ * shared with the scene, so building one only copies the visible index lists. They are only held until the snapshot
+ * has been drawn, an edit of a shared array would have to copy it.
+ */
+struct FCanvasRenderSnapshot
 {
-	FName Name;
-	FVector2D Position = FVector2D::ZeroVector;
-	FVector2D Size = FVector2D::UnitVector;
-	FLinearColor Color = FLinearColor::White;
-	FString TexturePath;
+	TSharedPtr<const TArray<FBoxInstance>, ESPMode::ThreadSafe> Boxes;
+	TSharedPtr<const TArray<FTextInstance>, ESPMode::ThreadSafe> Texts;
+	TSharedPtr<const TArray<FTileInstance>, ESPMode::ThreadSafe> Tiles;
+	/** Array indices of the items intersecting the view, in array order */
+	TArray<int32> VisibleBoxes;
+	TArray<int32> VisibleTexts;
+	TArray<int32> VisibleTiles;
+	/** Plots intersecting the view, drawn over the items */
+	TArray<FCanvasPlotSnapshot> Plots;
+	/** World bounds of the selected items, and the rectangle being dragged in screen space */
+	TArray<FBox2D> SelectionBounds;
+	FBox2D Marquee = FBox2D(ForceInit);
+	FLinearColor BackgroundColor = FLinearColor::Black;
+	FVector2D CameraOffset = FVector2D::ZeroVector;
+	float CameraZoom = 1.f;
+	ECanvasDrawMode DrawMode = ECanvasDrawMode::Batched;
+	bool bShowStats = false;
 };
 
-class FCustomViewportClient : public FViewportClient
+class CUSTOMWINDOW_API FCustomViewportClient : public FViewportClient
 {
 public:
+	DECLARE_MULTICAST_DELEGATE(FOnSelectionChanged);
+
+	/** Broadcast after a click or a drag changed the selection */
+	FOnSelectionChanged OnSelectionChanged;
+
 	FLinearColor BackgroundColor;
-	TMap<FName, FCanvasItem*> CanvasItems;
-	TMap<FName, UTexture2D*> LoadedTextures;
+	FCanvasScene Scene;
+	/** Shared by every client the module creates, so a texture shown in several tabs is loaded and packed once */
+	TSharedRef<FCustomTextureCache> TextureCache;
+	/** Optional, see CustomWindow.TextureAtlas */
+	TSharedRef<FCanvasTextureAtlas> TextureAtlas;
+	/**
+	 * Filled from any thread, applied on the game thread at the start of the next tick. Producers that may outlive the
+	 * client hold a reference to the queue rather than to the client.
+	 */
+	const TSharedRef<FCanvasCommandQueue, ESPMode::ThreadSafe> Commands;
+	/**
+	 * Undo history of the item edits, one transaction per call. Animations, plots and pixel tiles are not recorded,
+	 * ClearScene drops the history. Budget from CustomWindow.UndoHistoryMB, read when a tab opens.
+	 */
+	FCanvasJournal Journal;
+
+	/** Redraw every tick regardless of changes, for animated content */
+	bool bContinuousRedraw = false;
+	ECanvasDrawMode DrawMode = ECanvasDrawMode::Batched;
+	uint64 RenderedFrames = 0;
+	uint64 SkippedFrames = 0;
+	int32 VisibleItems = 0;
+	int32 CulledItems = 0;
+	/** Items and draw batches handed to the viewport canvas by the last Draw, and the time it took. Captures count their own */
+	int32 SubmittedItems = 0;
+	int32 SubmittedBatches = 0;
+	double LastDrawTime = 0.0;
+
+	/** World position shown at the top left corner of the viewport */
+	FVector2D CameraOffset = FVector2D::ZeroVector;
+	float CameraZoom = 1.f;
 
-	FCustomViewportClient();
+	/** Creates its own texture cache and atlas unless given ones to share */
+	explicit FCustomViewportClient(TSharedPtr<FCustomTextureCache> InTextureCache = nullptr, TSharedPtr<FCanvasTextureAtlas> InTextureAtlas = nullptr);
 	~FCustomViewportClient();
 
 	virtual void Draw(FViewport* Viewport, FCanvas* Canvas) override;
+	virtual bool InputKey(const FInputKeyEventArgs& EventArgs) override;
+	virtual bool InputAxis(FViewport* Viewport, int32 ControllerId, FKey Key, float Delta, float DeltaTime, int32 NumSamples = 1, bool bGamepad = false) override;
+	virtual void MouseMove(FViewport* Viewport, int32 X, int32 Y) override;
+	virtual void CapturedMouseMove(FViewport* Viewport, int32 X, int32 Y) override;
+	virtual EMouseCaptureMode GetMouseCaptureMode() const override { return EMouseCaptureMode::CaptureDuringMouseDown; }
+
+	/** Adds the item or replaces the one with the same name, the handle stays valid until the item is removed */
+	FCanvasItemHandle AddBox(const FBoxData& Data);
+	FCanvasItemHandle AddText(const FTextData& Data);
+	FCanvasItemHandle AddTile(const FTileData& Data);
+	/** AddBox/AddText/AddTile for any registered primitive, see TCanvasPrimitive */
+	template<typename DataType>
+	FCanvasItemHandle AddItem(const DataType& Data);
+	bool RemoveItem(FName Name);
+	void ClearScene();
+
+	/**
+	 * Retained mode: modify an item in place through its handle, without a name lookup or rebuilding the item. Return
+	 * false for stale handles and for properties the item type doesn't have.
+	 */
+	FCanvasItemHandle FindItem(FName Name) const { return Scene.Find(Name); }
+	bool SetItemPosition(FCanvasItemHandle Handle, const FVector2D& Position);
+	bool SetItemColor(FCanvasItemHandle Handle, const FLinearColor& Color);
+	bool SetItemSize(FCanvasItemHandle Handle, const FVector2D& Size);
+	bool SetItemText(FCanvasItemHandle Handle, const FString& Message);
+
+	/** Reverts or reapplies the last transaction of the journal, false when there is none */
+	bool Undo();
+	bool Redo();
+
+	/**
+	 * Restores the scene saved at BasePath if there is one, then keeps it saved there: the recorded deltas are appended
+	 * to a log every CustomWindow.AutosaveInterval seconds on a worker thread, and compacted into a new snapshot once
+	 * the log outgrows the previous one.
+	 */
+	void EnableAutosave(const FString& BasePath);
+	/** Writes the pending deltas, or a new snapshot after a failed write, waiting for them, and stops saving */
+	void DisableAutosave();
+
+	/**
+	 * Interpolates a property of the item from From to To over Duration seconds, replacing the running animation of
+	 * the same property. All tracks are evaluated in one pass per tick, and removed with their item.
+	 */
+	void Animate(FCanvasItemHandle Handle, ECanvasAnimatedProperty Property, const FVector4f& From, const FVector4f& To, float Duration, ECanvasAnimationLoop Loop = ECanvasAnimationLoop::Once);
+	void AnimatePosition(FCanvasItemHandle Handle, const FVector2D& From, const FVector2D& To, float Duration, ECanvasAnimationLoop Loop = ECanvasAnimationLoop::Once);
+	void AnimateColor(FCanvasItemHandle Handle, const FLinearColor& From, const FLinearColor& To, float Duration, ECanvasAnimationLoop Loop = ECanvasAnimationLoop::Once);
+	void StopAnimations(FCanvasItemHandle Handle);
+	int32 NumAnimations() const { return AnimationTracks.Num(); }
+
+	/**
+	 * Left click selects the topmost item under the cursor, dragging selects every item the rectangle touches, and
+	 * holding shift adds to the selection. Both go through the scene spatial grid.
+	 */
+	FCanvasItemHandle SelectAt(const FVector2D& ScreenPosition, bool bAddToSelection = false);
+	int32 SelectInRect(const FVector2D& ScreenStart, const FVector2D& ScreenEnd, bool bAddToSelection = false);
+	void ClearSelection();
+	/** In selection order, may hold handles of items removed since */
+	const TArray<FCanvasItemHandle>& GetSelection() const { return Selection; }
+
+	/**
+	 * Adds a line graph of the samples appended to the returned buffer, which can be kept and fed from any thread. It is
+	 * decimated to a min and max per pixel column when the view is built, so a plot costs about its width in pixels
+	 * whatever its capacity. Replaces the plot with the same name, keeping the buffer when the capacity is unchanged.
+	 */
+	TSharedRef<FCanvasPlot, ESPMode::ThreadSafe> AddPlot(const FPlotData& Data);
+	TSharedPtr<FCanvasPlot, ESPMode::ThreadSafe> FindPlot(FName Name) const;
+	bool RemovePlot(FName Name);
+	int32 NumPlots() const { return Plots.Num(); }
+
+	/**
+	 * Adds a tile showing the returned pixel buffer of Resolution pixels through a transient texture, for content that
+	 * changes every frame. The buffer can be written from any thread, and only the rectangles written since the last
+	 * frame are uploaded. Data.TexturePath is ignored. Replaces the item with the same name like AddTile, the buffer
+	 * stops being uploaded once its tile is removed or replaced. Only the removal of the replaced item is recorded, pixel
+	 * tiles stay out of the undo history, the autosave and ExportScene.
+	 */
+	TSharedRef<FCanvasPixelBuffer, ESPMode::ThreadSafe> AddPixelTile(const FTileData& Data, const FIntPoint& Resolution);
+	TSharedPtr<FCanvasPixelBuffer, ESPMode::ThreadSafe> FindPixelTile(FName Name) const;
+
+	/** Reads an item back into the data it would be added with, false for stale handles and other item types */
+	template<typename DataType>
+	bool GetItemData(FCanvasItemHandle Handle, DataType& OutData) const
+	{
+		const typename TCanvasPrimitive<DataType>::InstanceType* Item = Scene.Get<typename TCanvasPrimitive<DataType>::InstanceType>(Handle);
+		if (Item)
+		{
+			MakeData(*Item, OutData);
+		}
+		return Item != nullptr;
+	}
+
+	/**
+	 * Batch versions of AddBox/AddText/AddTile. Items whose name already exists are updated in place, the rest are
+	 * appended, and the viewport is invalidated once for the whole batch. The rvalue overloads move the item data.
+	 */
+	void AddBoxes(TArrayView<const FBoxData> Items);
+	void AddBoxes(TArray<FBoxData>&& Items);
+	void AddTexts(TArrayView<const FTextData> Items);
+	void AddTexts(TArray<FTextData>&& Items);
+	void AddTiles(TArrayView<const FTileData> Items);
+	void AddTiles(TArray<FTileData>&& Items);
+	int32 RemoveItems(TArrayView<const FName> Names);
+
+	/** Adds every item of Data to the scene in one pass per primitive type, replacing items with the same name */
+	void ImportScene(const FCanvasSceneData& Data);
+	void ImportScene(FCanvasSceneData&& Data);
+	/** Leaves out pixel tiles, their pixels only live in the buffer returned by AddPixelTile */
+	void ExportScene(FCanvasSceneData& OutData) const;
+
+	/**
+	 * Thread safe versions of AddBox/AddText/AddTile and RemoveItem. Commands for the same name are applied in the order
+	 * they were queued. Returns false when the queue is full and the command was dropped.
+	 */
+	template<typename DataType>
+	bool Enqueue(DataType&& Data) { return Commands->Enqueue(MakeCanvasCommand(Forward<DataType>(Data))); }
+	bool EnqueueRemove(FName Name) { return Commands->Enqueue(MakeCanvasCommand(FCanvasRemoveCommand{ Name })); }
+
+	/** Applies the queued commands as one batch per primitive type, called by ConsumeRedraw */
+	void ApplyCommands();
 
-	void AddBox(const FBoxData& Data);
-	void AddText(const FTextData& Data);
-	void AddTile(const FTileData& Data);
+	void SetBackgroundColor(const FLinearColor& InColor);
+	void SetDrawMode(ECanvasDrawMode InDrawMode);
+	void SetCamera(const FVector2D& InOffset, float InZoom);
+	/** Zooms by Steps wheel notches keeping the world position under ScreenAnchor in place */
+	void ZoomAt(const FVector2D& ScreenAnchor, float Steps);
+	FVector2D ScreenToWorld(const FVector2D& ScreenPosition) const { return CameraOffset + ScreenPosition / CameraZoom; }
+	FVector2D WorldToScreen(const FVector2D& WorldPosition) const { return (WorldPosition - CameraOffset) * CameraZoom; }
+
+	void MarkDirty() { bDirty = true; ++Version; }
+	bool IsDirty() const { return bDirty; }
+
+	/** Called once per Slate tick, returns true if the viewport has to be redrawn and builds the snapshot Draw reads */
+	bool ConsumeRedraw(const FIntPoint& ViewportSize);
+	/** Applies queued commands, animations and atlas uploads, called by ConsumeRedraw and by the mirrors of this client */
+	void UpdateScene();
+	/** The snapshot the next Draw reads, its item arrays are released once it has been drawn */
+	const FCanvasRenderSnapshot& GetSnapshot() const { return RenderSnapshot; }
+	/**
+	 * Bumped by every MarkDirty, lets other consumers of the scene tell whether it changed since they last looked. A
+	 * mirror adds the version of its source.
+	 */
+	uint64 GetVersion() const { return Version + (MirrorSource.IsValid() ? MirrorSource->GetVersion() : 0); }
+
+	/**
+	 * Shows the scene of Source with its own camera. The items are read from the source scene as they are, nothing is
+	 * copied, and the view redraws when the source version changes. Mirrors are views: clicking doesn't select and edits
+	 * belong on the source. Null goes back to the own scene.
+	 */
+	void SetMirrorSource(TSharedPtr<FCustomViewportClient> InSource);
+	const TSharedPtr<FCustomViewportClient>& GetMirrorSource() const { return MirrorSource; }
+	const FCanvasScene& GetViewedScene() const { return MirrorSource.IsValid() ? MirrorSource->Scene : Scene; }
+
+	/** Fills Snapshot with the scene seen from the given camera on a target of TargetSize pixels, without selection or HUD */
+	void FillSnapshot(FCanvasRenderSnapshot& Snapshot, const FVector2D& InCameraOffset, float InCameraZoom, const FIntPoint& TargetSize) const;
+	/** Clears the canvas and draws the items of Snapshot, used by Draw and by offscreen captures, each with its own counters */
+	void DrawSnapshot(FCanvas* Canvas, const FCanvasRenderSnapshot& Snapshot, FCanvasDrawCounters& OutCounters);
+	/** Renders the scene into a render target and writes PNGs from it, created on first use */
+	FCanvasCapture& GetCapture();
+	const FIntPoint& GetViewportSize() const { return LastViewportSize; }
+
+private:
+	bool bDirty = true;
+	uint64 Version = 0;
+	TSharedPtr<FCustomViewportClient> MirrorSource;
+	/** Source version the mirror last drew */
+	uint64 MirroredVersion = 0;
+	/** GFrameCounter of the last UpdateScene, so a mirror only updates the source when the source's own tab didn't */
+	uint64 LastSceneUpdateFrame = MAX_uint64;
+	TUniquePtr<FCanvasAutosave> Autosave;
+	double LastAutosaveTime = 0.0;
+	/** Set while deltas of the journal or of an autosave are applied, they must not be recorded again */
+	bool bApplyingDeltas = false;
+	/** Records of the delta being recorded, kept to reuse the allocations */
+	TArray<uint8> DeltaBefore;
+	TArray<uint8> DeltaAfter;
+	/**
+	 * Items the import in progress moves out of their layer or array. AddBatch only moves them at the end, the layer
+	 * positions recorded meanwhile leave them out so undo restores the items in reverse order to their original places.
+	 */
+	TArray<FCanvasItemHandle> VacatedInBatch;
+	/** Atlas uploads seen so far, the atlas may be shared and a page can change from another client's flush */
+	int32 SeenAtlasUploads = 0;
+	TUniquePtr<FCanvasCapture> Capture;
+	FIntPoint LastViewportSize = FIntPoint::ZeroValue;
+	bool bShowStats = false;
+	double LastStatsRefresh = 0.0;
+	bool bPanning = false;
+	FIntPoint LastMousePosition = FIntPoint::ZeroValue;
+	bool bSelecting = false;
+	bool bAddToSelection = false;
+	FIntPoint SelectionStart = FIntPoint::ZeroValue;
+	TArray<FCanvasItemHandle> Selection;
+	/** Built by ConsumeRedraw and drawn by the Draw that follows it, both on the game thread */
+	FCanvasRenderSnapshot RenderSnapshot;
+	TMap<FName, TStrongObjectPtr<UFont>> LoadedFonts;
+	TArray<FCanvasAnimationTrack> AnimationTracks;
+	TArray<FCanvasPlotInstance> Plots;
+	/** Sum of the samples appended to all plots when last checked, a change means a redraw */
+	uint64 SeenPlotSamples = 0;
+
+	struct FPixelTile
+	{
+		FCanvasItemHandle Handle;
+		TSharedPtr<FCanvasPixelBuffer, ESPMode::ThreadSafe> Buffer;
+		TStrongObjectPtr<UTexture2D> Texture;
+	};
+	/** Pixel tiles added so far, dropped on the next UpdateScene once their item is gone or shows another texture */
+	TArray<FPixelTile> PixelTiles;
+	/** Textures of dropped pixel tiles, RenderSnapshot may still point at them until it is drawn or rebuilt */
+	TArray<TStrongObjectPtr<UTexture2D>> RetiredPixelTextures;
+
+	/** Commands taken from the queue, at most one per name, kept between frames to reuse the allocations */
+	FCanvasPrimitives::FDataArrays PendingItems;
+	TArray<FName> PendingRemoves;
+	/** Command type index and position in the pending array of every pending name */
+	TMap<FName, TTuple<SIZE_T, int32>> PendingNames;
+	int64 ReportedDrops = 0;
+
+	void FlushPendingCommands();
+
+	/** Records the delta in the journal and the autosave log, unless it is being applied from them */
+	void RecordDelta(const FCanvasDelta& Delta);
+	/** Records the add, or the replacement of Existing, before the item is added */
+	template<typename DataType>
+	void RecordAdd(const DataType& Data, FCanvasItemHandle Existing);
+	/** Records the removal of the item before it is removed */
+	void RecordRemove(FCanvasItemHandle Handle);
+	void RecordProperty(FCanvasItemHandle Handle, ECanvasDeltaProperty Property, const FVector4f& Before, const FVector4f& After);
+	void ApplyDelta(const FCanvasDelta& Delta);
+	/** Appends the recorded deltas to the autosave log, or compacts it, unless the previous write is still running */
+	void FlushAutosave();
+
+	void ApplyTexture(FName TexturePath, UTexture2D* Texture);
+	void ReleaseResources(FCanvasItemHandle Handle);
+	void AcquireAtlasRegion(FTileInstance& Tile);
+	void ReleaseTileTextures(const FTileInstance& Tile);
+	const UFont* ResolveFont(const FString& FontPath);
+
+	FBoxInstance MakeInstance(const FBoxData& Data);
+	FTextInstance MakeInstance(const FTextData& Data);
+	FTextInstance MakeInstance(FTextData&& Data);
+	FTileInstance MakeInstance(const FTileData& Data);
+	void MakeData(const FBoxInstance& Box, FBoxData& OutData) const;
+	void MakeData(const FTextInstance& Text, FTextData& OutData) const;
+	void MakeData(const FTileInstance& Tile, FTileData& OutData) const;
+	bool IsPixelTile(const FTileInstance& Tile) const;
+	/** Type of the item for the journal and the autosave log, Num for stale handles and pixel tiles, which are not recorded */
+	ECanvasItemType GetJournaledType(FCanvasItemHandle Handle) const;
+
+	/** Calls Func with the item behind Handle whatever its type, returns false for stale handles */
+	template<typename FuncType>
+	bool VisitItem(FCanvasItemHandle Handle, FuncType&& Func);
+	/** VisitItem, then refreshes the bounds of the item */
+	template<typename FuncType>
+	bool EditItem(FCanvasItemHandle Handle, FuncType&& Func);
+	void TickAnimations(double Time);
+	/** Uploads the dirty regions of the pixel tiles, returns true if any tile changed */
+	bool UploadPixelTiles();
+
+	/** Moves from the items unless DataType is const */
+	template<typename DataType>
+	void ImportItems(TArrayView<DataType> Items);
+
+	void BuildSnapshot(const FIntPoint& ViewportSize);
+	void DrawTiles(FCanvas* Canvas, const FCanvasRenderSnapshot& Snapshot, TArrayView<const int32> Tiles, FCanvasDrawCounters& Counters);
+	void DrawBoxes(FCanvas* Canvas, const FCanvasRenderSnapshot& Snapshot, TArrayView<const int32> Boxes, FCanvasDrawCounters& Counters);
+	void DrawTexts(FCanvas* Canvas, const FCanvasRenderSnapshot& Snapshot, TArrayView<const int32> Texts, FCanvasDrawCounters& Counters);
+	void DrawPlots(FCanvas* Canvas, const FCanvasRenderSnapshot& Snapshot, FCanvasDrawCounters& Counters);
+	void DrawSelection(FCanvas* Canvas, const FCanvasRenderSnapshot& Snapshot);
+	/** CustomWindow.ShowStats overlay, drawn in screen space */
+	void DrawStats(FCanvas* Canvas);
 };
 
+template<typename DataType>
+FCanvasItemHandle FCustomViewportClient::AddItem(const DataType& Data)
+{
+	const FCanvasItemHandle Existing = Scene.Find(Data.Name);
+	RecordAdd(Data, Existing);
+
+	// Acquire the new resources before releasing the replaced item's ones so a shared texture isn't evicted in between
+	typename TCanvasPrimitive<DataType>::InstanceType Instance = MakeInstance(Data);
+	ReleaseResources(Existing);
+	const FCanvasItemHandle Handle = Scene.Add(Data.Name, MoveTemp(Instance));
+	MarkDirty();
+	return Handle;
+}
+
+template<typename DataType>
+void FCustomViewportClient::RecordAdd(const DataType& Data, FCanvasItemHandle Existing)
+{
+	if (bApplyingDeltas)
+	{
+		return;
+	}
+
+	FCanvasJournalScope Transaction(Journal);
+	const ECanvasItemType ExistingType = GetJournaledType(Existing);
+	if (ExistingType != ECanvasItemType::Num && ExistingType != TCanvasPrimitive<DataType>::Type)
+	{
+		// Replacing an item of another type removes it first
+		RecordRemove(Existing);
+	}
+
+	DeltaBefore.Reset();
+	DeltaAfter.Reset();
+	CanvasDelta::WriteItem(Data, DeltaAfter);
+	DataType Replaced;
+	const bool bReplace = ExistingType == TCanvasPrimitive<DataType>::Type && GetItemData(Existing, Replaced);
+	if (bReplace)
+	{
+		CanvasDelta::WriteItem(Replaced, DeltaBefore);
+	}
+	// Undoing a replace that changed the layer puts the replaced item back where it was in its layer, a replace in the
+	// same layer is undone in place
+	const int32 Position = bReplace && Replaced.Layer != Data.Layer ? Scene.GetLayerPosition(Existing, VacatedInBatch) : INDEX_NONE;
+	RecordDelta(FCanvasDelta{ bReplace ? ECanvasDeltaOp::Replace : ECanvasDeltaOp::Add, TCanvasPrimitive<DataType>::Type,
+		ECanvasDeltaProperty::None, DeltaBefore, DeltaAfter, Position });
+}
+
 class SCustomViewport : public SViewport
 {
 	SLATE_BEGIN_ARGS(SCustomViewport)
@@ -77,82 +453,137 @@ class SCustomViewport : public SViewport
 	virtual void Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime) override;
 
 public:
-	void SetSceneViewport(TSharedPtr<FSceneViewport> InSceneViewport);
+	void SetSceneViewport(TSharedPtr<FSceneViewport> InSceneViewport, TSharedPtr<FCustomViewportClient> InViewportClient);
 
+	/** Owned with the tab and its mirrors, declared first so it outlives the scene viewport drawing it */
+	TSharedPtr<FCustomViewportClient> ViewportClient;
 	TSharedPtr<FSceneViewport> SceneViewport;
 };
 
-class FCustomWindowModule : public IModuleInterface
+class FCustomWindowTab;
+
+/** Settings panel of one primitive and the item being edited in it, owned by a tab and handed to the next one when it closes */
+template<typename DataType>
+struct TCanvasSettingsPanel
+{
+	DataType Item;
+	TSharedPtr<SWidget> Widget;
+	/** Tab showing the panel, whose scene the ENTER button adds to */
+	FCustomWindowTab* Owner = nullptr;
+};
+
+template<typename DataType>
+using TCanvasSettingsPanelPtr = TSharedPtr<TCanvasSettingsPanel<DataType>>;
+template<typename DataType>
+using TCanvasSettingsPanelPool = TArray<TSharedRef<TCanvasSettingsPanel<DataType>>>;
+
+/** One CustomWindow tab: its viewport and the toggles of the settings panels, built the first time they are shown */
+class FCustomWindowTab
 {
 public:
 	FSlateColorBrush ActiveColor;
 	FSlateColorBrush DisabledColor;
-	FCustomViewportClient* ViewportClient;
+	TSharedPtr<FCustomViewportClient> ViewportClient;
+	TSharedPtr<SCustomViewport> Viewport;
+	TWeakPtr<SDockTab> DockTab;
 
-	TMap<FName, TTuple<TSharedPtr<SBorder>, TSharedPtr<SWidget>>> Settings;
+	/** Toggle of every panel and the function returning the panel, building it on the first call */
+	TMap<FName, TTuple<TSharedPtr<SBorder>, TFunction<TSharedRef<SWidget>()>>> Settings;
 	TSharedPtr<SOverlay> Overlay;
-	FBoxData BoxData;
-	FTextData TextData;
-	FTileData TileData;
+	FCanvasPrimitives::TTupleOf<TCanvasSettingsPanelPtr> Panels;
 
-	FCustomWindowModule();
+	explicit FCustomWindowTab(TSharedRef<FCustomViewportClient> InViewportClient);
+	~FCustomWindowTab();
 
-	/** IModuleInterface implementation */
-	virtual void StartupModule() override;
-	virtual void ShutdownModule() override;
+	/** The client whose scene the panels edit, the source for mirror tabs */
+	FCustomViewportClient& GetSceneClient() const;
 
-	TSharedRef<SDockTab> CreateWindow(const FSpawnTabArgs& TabArgs);
-	void CreateToggle(FName Name, TSharedPtr<SWidget> WidgetToAdd);
-	TSharedPtr<SWidget> CreateBoxSettings();
-	TSharedRef<SWidget> CreateTextSettings();
-	TSharedRef<SWidget> CreateTileSettings();
+	TSharedRef<SDockTab> CreateDockTab(ETabRole Role);
+	void CreateToggle(FName Name, TFunction<TSharedRef<SWidget>()> GetWidget);
+	/** Panel of DataType, taken from the ones released by closed tabs or built when there is none */
+	template<typename DataType>
+	TCanvasSettingsPanel<DataType>& GetPanel();
+	/** Builds the widget of Panel, one widget per field of TCanvasPrimitive, two per row, then the ENTER button */
+	template<typename DataType>
+	void CreateSettings(TCanvasSettingsPanel<DataType>& Panel);
+	/** Hands the panels built by the tab to the module for the next tab, called when it closes */
+	void ReleasePanels();
 	void Deselect();
+	void ShowSettings(FName Name);
+	/** Loads the last selected item into its settings panel */
+	void LoadSelection();
 	void SetOverlay(TSharedRef<SWidget> NewWidget);
-	FReply AddBox();
+	FReply OpenTab();
+	FReply OpenMirror();
 	void Init();
-	TSharedRef<SWidget> CreateTextEditBox(const FText& Name, const std::function<void(const FText& InText, ETextCommit::Type CommitType)> &TextCommitLambda);
-	TSharedRef<SWidget> CreateColorBox(const FText& Name, const std::function<void(FLinearColor InColor)>& ColorSelectLambda);
-	TSharedRef<SWidget> CreateAssetSelection(const FText& Name, const std::function<void(const FAssetData& InAsset)>& AssetSelectLambda);
-	TSharedRef<SWidget> CreateButton(const FText& Name, FReply(FCustomWindowModule::*InFunc)());
+	TSharedRef<SWidget> CreateTextEditBox(const FText& Name, const std::function<void(const FText& InText, ETextCommit::Type CommitType)> &TextCommitLambda,
+		const std::function<FText()>& TextUpdateLambda);
+	TSharedRef<SWidget> CreateColorBox(const FText& Name, const std::function<void(FLinearColor InColor)>& ColorSelectLambda,
+		const std::function<FLinearColor()>& ColorUpdateLambda);
+	TSharedRef<SWidget> CreateAssetSelection(const FText& Name, UClass* AllowedClass, const std::function<void(const FAssetData& InAsset)>& AssetSelectLambda,
+		const std::function<FString()>& AssetUpdateLambda);
+	TSharedRef<SWidget> CreateButton(const FText& Name, FReply(FCustomWindowTab::*InFunc)());
+
+	/** Panel widget of one field, picked by the field type */
+	TSharedRef<SWidget> CreateField(const FCanvasField& Field, FName& Value);
+	TSharedRef<SWidget> CreateField(const FCanvasField& Field, FString& Value);
+	TSharedRef<SWidget> CreateField(const FCanvasField& Field, float& Value);
+	TSharedRef<SWidget> CreateField(const FCanvasField& Field, int32& Value);
+	TSharedRef<SWidget> CreateField(const FCanvasField& Field, FVector2D& Value);
+	TSharedRef<SWidget> CreateField(const FCanvasField& Field, FLinearColor& Value);
 
+	/** Leave MinValue unset for values that can be negative, layers and positions */
 	template<typename T, typename U>
 	void CreateNumericField(TSharedRef<U> Box, const FText& Name, ETextJustify::Type NameJustification, float FillWidthName, float FillWidthValue,
 		const std::function<void(T InValue, ETextCommit::Type CommitType)>& ValueCommittedLambda,
-		const std::function<T()>& ValueUpdateLambda)
+		const std::function<T()>& ValueUpdateLambda, TOptional<T> MinValue = TOptional<T>())
 	{
 		Box->AddSlot().FillWidth(FillWidthName).VAlign(EVerticalAlignment::VAlign_Center)
 			.AttachWidget(SNew(STextBlock).Text(Name).Justification(NameJustification));
 		Box->AddSlot().FillWidth(FillWidthValue)
 			.AttachWidget(SNew(SNumericEntryBox<T>)
-							.MinValue(0.f)
+							.MinValue(MinValue)
 							.OnValueCommitted_Lambda(ValueCommittedLambda)
 							.Value_Lambda(ValueUpdateLambda));
 	}
+};
 
-	template<typename T>
-	FReply Add()
-	{
-		return FReply::Unhandled();
-	}
+class FCustomWindowModule : public IModuleInterface
+{
+public:
+	TArray<IConsoleObject*> ConsoleCommands;
+	/** Open tabs, the most recently focused one last */
+	TArray<TSharedRef<FCustomWindowTab>> Tabs;
+	/** Shared by the clients of every tab, created with the first one */
+	TSharedPtr<FCustomTextureCache> TextureCache;
+	TSharedPtr<FCanvasTextureAtlas> TextureAtlas;
+	/** Settings panels of closed tabs, reused by the tabs spawned after them */
+	FCanvasPrimitives::TTupleOf<TCanvasSettingsPanelPool> ReleasedPanels;
 
-	template<>
-	FReply Add<FCanvasBoxItem>()
-	{
-		ViewportClient->AddBox(BoxData);
-		return FReply::Handled();
-	}
+	static FCustomWindowModule& Get() { return FModuleManager::LoadModuleChecked<FCustomWindowModule>("CustomWindow"); }
+	static bool IsAvailable() { return FModuleManager::Get().IsModuleLoaded("CustomWindow"); }
 
-	template<>
-	FReply Add<FCanvasTextItem>()
-	{
-		ViewportClient->AddText(TextData);
-		return FReply::Handled();
-	}
+	/** IModuleInterface implementation */
+	virtual void StartupModule() override;
+	virtual void ShutdownModule() override;
 
-	template<>
-	FReply Add<FCanvasTileItem>()
-	{
-		ViewportClient->AddTile(TileData);
-		return FReply::Handled();
-	}
-};
\ No newline at end of file
+	/** Client whose scene the console commands and the blueprint library edit: the one shown by the last focused tab */
+	FCustomViewportClient* GetActiveClient() const;
+
+	TSharedRef<SDockTab> CreateWindow(const FSpawnTabArgs& TabArgs);
+	/** Creates a tab with its own client, showing the scene of MirrorSource instead of a new one when given */
+	TSharedRef<SDockTab> SpawnTab(ETabRole Role, TSharedPtr<FCustomViewportClient> MirrorSource = nullptr);
+	/** Opens another tab next to the open ones, or brings back the first one when none is open */
+	void OpenTab(bool bMirror);
+	void OnTabClosed(TSharedRef<SDockTab> ClosedTab);
+	void OnTabActivated(TSharedRef<SDockTab> ActivatedTab, ETabActivationCause Cause);
+
+	void OpenTabCommand(const TArray<FString>& Args);
+	void SaveScene(const TArray<FString>& Args);
+	void LoadScene(const TArray<FString>& Args);
+	void CaptureScene(const TArray<FString>& Args);
+	void StressCommandQueue(const TArray<FString>& Args);
+	/** Undoes or redoes the given number of steps in the active client, one by default */
+	void Undo(const TArray<FString>& Args);
+	void Redo(const TArray<FString>& Args);
+};
@@ -0,0 +1,64 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CanvasItemData.h"
+#include "Kismet/BlueprintFunctionLibrary.h"
+#include "CustomWindowBlueprintLibrary.generated.h"
+
+class UTextureRenderTarget2D;
+
+/**
+ * Blueprint access to the scene of the last focused CustomWindow tab, the mirrored one for mirror tabs. Every function
+ * returns false when no CustomWindow tab is open
+ */
+UCLASS()
+class UCustomWindowBlueprintLibrary : public UBlueprintFunctionLibrary
+{
+	GENERATED_BODY()
+
+public:
+	UFUNCTION(BlueprintCallable, Category = "CustomWindow")
+	static bool AddBoxes(const TArray<FBoxData>& Boxes);
+
+	UFUNCTION(BlueprintCallable, Category = "CustomWindow")
+	static bool AddTexts(const TArray<FTextData>& Texts);
+
+	UFUNCTION(BlueprintCallable, Category = "CustomWindow")
+	static bool AddTiles(const TArray<FTileData>& Tiles);
+
+	UFUNCTION(BlueprintCallable, Category = "CustomWindow")
+	static bool RemoveItems(const TArray<FName>& Names);
+
+	UFUNCTION(BlueprintCallable, Category = "CustomWindow")
+	static bool ClearScene();
+
+	UFUNCTION(BlueprintCallable, Category = "CustomWindow")
+	static bool AddPlot(const FPlotData& Plot);
+
+	/** False as well when there is no plot of that name */
+	UFUNCTION(BlueprintCallable, Category = "CustomWindow")
+	static bool AppendPlotSamples(FName PlotName, const TArray<float>& Samples);
+
+	UFUNCTION(BlueprintCallable, Category = "CustomWindow")
+	static bool AddPixelTile(const FTileData& Tile, int32 Width = 256, int32 Height = 256);
+
+	/**
+	 * Writes Pixels, rows of Width pixels, at X and Y. False when there is no pixel tile of that name, or when Pixels
+	 * isn't a whole number of rows, in which case nothing is written
+	 */
+	UFUNCTION(BlueprintCallable, Category = "CustomWindow")
+	static bool WritePixelTile(FName TileName, int32 X, int32 Y, int32 Width, const TArray<FColor>& Pixels);
+
+	/**
+	 * Render target holding the scene at the given resolution, for HUDs and materials. It is kept up to date while the
+	 * tab is open and only re-rendered when the scene changed. Null when no CustomWindow tab is open.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "CustomWindow")
+	static UTextureRenderTarget2D* GetSceneTexture(int32 Width = 1024, int32 Height = 1024);
+
+	/** Writes the scene as PNG without waiting for the GPU, the file appears a few frames later */
+	UFUNCTION(BlueprintCallable, Category = "CustomWindow")
+	static bool SaveSceneImage(const FString& FilePath, int32 Width = 1024, int32 Height = 1024);
+};
@@ -0,0 +1,132 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CanvasCommandQueue.h"
+#include "Async/Async.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCanvasCommandQueueStressTest, "CustomWindow.CommandQueue.ManyProducers",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FCanvasCommandQueueStressTest::RunTest(const FString& Parameters)
+{
+	// A small queue so the producers wrap around it many times and keep running into a full queue
+	constexpr int32 NumProducers = 8;
+	constexpr int32 NumPerProducer = 20000;
+	constexpr int32 NumCommands = NumProducers * NumPerProducer;
+	FCanvasCommandQueue Queue(64);
+	std::atomic<bool> bTimedOut{ false };
+	const double Deadline = FPlatformTime::Seconds() + 60.0;
+
+	// Every producer queues its own sequence, the layer carries the sequence number and the name the producer
+	TArray<TFuture<int64>> Producers;
+	for (int32 Producer = 0; Producer < NumProducers; ++Producer)
+	{
+		Producers.Add(Async(EAsyncExecution::ThreadPool, [&Queue, &bTimedOut, Deadline, Producer]() -> int64
+		{
+			int64 NumRejected = 0;
+			FBoxData Box;
+			Box.Name = FName(TEXT("Producer"), Producer + 1);
+			for (int32 Sequence = 0; Sequence < NumPerProducer && !bTimedOut; ++Sequence)
+			{
+				Box.Layer = Sequence;
+				while (!Queue.Enqueue(MakeCanvasCommand(Box)))
+				{
+					++NumRejected;
+					if (FPlatformTime::Seconds() > Deadline)
+					{
+						bTimedOut = true;
+						break;
+					}
+					FPlatformProcess::Yield();
+				}
+			}
+			return NumRejected;
+		}));
+	}
+
+	TArray<int32> NextSequence;
+	NextSequence.Init(0, NumProducers);
+	int32 NumReceived = 0;
+	int32 NumOutOfOrder = 0;
+	int32 NumUnknown = 0;
+	FCanvasCommand Command;
+	while (NumReceived < NumCommands && !bTimedOut)
+	{
+		if (!Queue.Dequeue(Command))
+		{
+			bTimedOut = FPlatformTime::Seconds() > Deadline;
+			FPlatformProcess::Yield();
+			continue;
+		}
+
+		++NumReceived;
+		const int32 Producer = Command.IsType<FBoxData>() ? Command.Get<FBoxData>().Name.GetNumber() - 1 : INDEX_NONE;
+		if (!NextSequence.IsValidIndex(Producer))
+		{
+			++NumUnknown;
+			continue;
+		}
+
+		// A lost command shows up as a gap, a duplicate or a reorder as a step back
+		NumOutOfOrder += Command.Get<FBoxData>().Layer != NextSequence[Producer] ? 1 : 0;
+		NextSequence[Producer] = Command.Get<FBoxData>().Layer + 1;
+	}
+
+	int64 NumRejected = 0;
+	for (TFuture<int64>& Producer : Producers)
+	{
+		NumRejected += Producer.Get();
+	}
+
+	TestFalse(TEXT("Timed out"), bTimedOut.load());
+	TestEqual(TEXT("Commands received"), NumReceived, NumCommands);
+	TestEqual(TEXT("Commands out of order, lost or duplicated"), NumOutOfOrder, 0);
+	TestEqual(TEXT("Commands from unknown producers"), NumUnknown, 0);
+	for (int32 Producer = 0; Producer < NumProducers; ++Producer)
+	{
+		TestEqual(FString::Printf(TEXT("Last sequence of producer %d"), Producer), NextSequence[Producer], NumPerProducer);
+	}
+	TestFalse(TEXT("Commands left in the queue"), Queue.Dequeue(Command));
+
+	const FCanvasCommandQueueStats Stats = Queue.GetStats();
+	TestEqual(TEXT("Enqueued"), Stats.NumEnqueued, static_cast<int64>(NumCommands));
+	TestEqual(TEXT("Dequeued"), Stats.NumDequeued, static_cast<int64>(NumCommands));
+	TestEqual(TEXT("Dropped"), Stats.NumDropped, NumRejected);
+	TestTrue(TEXT("High water within capacity"), Stats.HighWater > 0 && Stats.HighWater <= Stats.Capacity);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCanvasCommandQueueFullTest, "CustomWindow.CommandQueue.Backpressure",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FCanvasCommandQueueFullTest::RunTest(const FString& Parameters)
+{
+	FCanvasCommandQueue Queue(3);
+	TestEqual(TEXT("Capacity rounded up to a power of two"), Queue.GetCapacity(), 4);
+
+	for (int32 Index = 0; Index < 4; ++Index)
+	{
+		TestTrue(TEXT("Enqueue below capacity"), Queue.Enqueue(MakeCanvasCommand(FCanvasRemoveCommand{ FName(TEXT("Item"), Index + 1) })));
+	}
+	TestFalse(TEXT("Enqueue into a full queue"), Queue.Enqueue(MakeCanvasCommand(FCanvasRemoveCommand{ NAME_None })));
+
+	// Draining one cell makes room for exactly one more command, which comes out after the older ones
+	FCanvasCommand Command;
+	TestTrue(TEXT("Dequeue"), Queue.Dequeue(Command) && Command.IsType<FCanvasRemoveCommand>() && Command.Get<FCanvasRemoveCommand>().Name.GetNumber() == 1);
+	TestTrue(TEXT("Enqueue after a dequeue"), Queue.Enqueue(MakeCanvasCommand(FCanvasRemoveCommand{ FName(TEXT("Item"), 5) })));
+	for (int32 Index = 2; Index <= 5; ++Index)
+	{
+		TestTrue(FString::Printf(TEXT("Dequeue %d in order"), Index), Queue.Dequeue(Command) && Command.Get<FCanvasRemoveCommand>().Name.GetNumber() == Index);
+	}
+	TestFalse(TEXT("Dequeue from an empty queue"), Queue.Dequeue(Command));
+
+	const FCanvasCommandQueueStats Stats = Queue.GetStats();
+	TestEqual(TEXT("Enqueued"), Stats.NumEnqueued, static_cast<int64>(5));
+	TestEqual(TEXT("Dropped"), Stats.NumDropped, static_cast<int64>(1));
+	TestEqual(TEXT("High water"), Stats.HighWater, 4);
+	return true;
+}
+
+#endif
@@ -0,0 +1,312 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CanvasJournal.h"
+#include "CustomWindow.h"
+#include "Algo/BinarySearch.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace CanvasJournalTest
+{
+	/** Records the add of a text whose layer carries Index, the message pads the delta to about PayloadSize bytes */
+	static void RecordAdd(FCanvasJournal& Journal, int32 Index, int32 PayloadSize = 16)
+	{
+		FTextData Text;
+		Text.Name = FName(TEXT("Text"), Index + 1);
+		Text.Layer = Index;
+		Text.Message = FString::ChrN(PayloadSize, TEXT('x'));
+
+		TArray<uint8> Bytes;
+		CanvasDelta::WriteItem(Text, Bytes);
+		Journal.Record(FCanvasDelta{ ECanvasDeltaOp::Add, ECanvasItemType::Text, ECanvasDeltaProperty::None, TArrayView<const uint8>(), Bytes });
+	}
+
+	/** Index of the text added or removed by Delta, INDEX_NONE when it doesn't decode */
+	static int32 GetIndex(const FCanvasDelta& Delta)
+	{
+		FTextData Text;
+		const bool bRead = CanvasDelta::ReadItem(Delta.Op == ECanvasDeltaOp::Remove ? Delta.Before : Delta.After, Text);
+		return bRead ? Text.Layer : INDEX_NONE;
+	}
+
+	static TArray<int32> Undo(FCanvasJournal& Journal)
+	{
+		TArray<int32> Indices;
+		Journal.Undo([&Indices](const FCanvasDelta& Delta) { Indices.Add(Delta.Op == ECanvasDeltaOp::Remove ? GetIndex(Delta) : INDEX_NONE); });
+		return Indices;
+	}
+
+	static TArray<int32> Redo(FCanvasJournal& Journal)
+	{
+		TArray<int32> Indices;
+		Journal.Redo([&Indices](const FCanvasDelta& Delta) { Indices.Add(Delta.Op == ECanvasDeltaOp::Add ? GetIndex(Delta) : INDEX_NONE); });
+		return Indices;
+	}
+
+	static FBoxData MakeBox(const TCHAR* Name, int32 Layer)
+	{
+		FBoxData Box;
+		Box.Name = Name;
+		Box.Size = FVector2D(10.f, 10.f);
+		Box.Layer = Layer;
+		return Box;
+	}
+
+	static FString GetBoxOrder(const FCanvasScene& Scene)
+	{
+		FString Order;
+		for (const FBoxInstance& Box : Scene.GetItems<FBoxInstance>())
+		{
+			Order += Scene.GetName(Box.Slot).ToString();
+		}
+		return Order;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCanvasJournalDropRedoTest, "CustomWindow.Journal.DropRedo",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FCanvasJournalDropRedoTest::RunTest(const FString& Parameters)
+{
+	using namespace CanvasJournalTest;
+
+	FCanvasJournal Journal;
+	for (int32 Index = 0; Index < 3; ++Index)
+	{
+		RecordAdd(Journal, Index);
+	}
+	TestEqual(TEXT("Small deltas share one block"), Journal.GetAllocatedSize(), static_cast<int64>(FCanvasJournal::BlockSize));
+
+	Undo(Journal);
+	Undo(Journal);
+	TestEqual(TEXT("Redo after two undos"), Journal.NumRedo(), 2);
+
+	// Recording drops the two undone transactions and writes over their bytes
+	RecordAdd(Journal, 10);
+	TestEqual(TEXT("Redo after recording"), Journal.NumRedo(), 0);
+	TestEqual(TEXT("Undo after recording"), Journal.NumUndo(), 2);
+	TestEqual(TEXT("Deltas after recording"), Journal.NumDeltas(), 2);
+	TestEqual(TEXT("Blocks after recording"), Journal.GetAllocatedSize(), static_cast<int64>(FCanvasJournal::BlockSize));
+	TestTrue(TEXT("Undo the new transaction"), Undo(Journal) == TArray<int32>{ 10 });
+	TestTrue(TEXT("Undo the kept transaction"), Undo(Journal) == TArray<int32>{ 0 });
+	TestTrue(TEXT("Redo the kept transaction"), Redo(Journal) == TArray<int32>{ 0 });
+
+	// Deltas larger than a block get one of their own, undoing and recording again reuses it instead of adding blocks
+	RecordAdd(Journal, 20, FCanvasJournal::BlockSize * 2);
+	const int64 AllocatedSize = Journal.GetAllocatedSize();
+	TestTrue(TEXT("Large delta in a block of its own"), AllocatedSize > FCanvasJournal::BlockSize * 2);
+	for (int32 Index = 21; Index < 30; ++Index)
+	{
+		Undo(Journal);
+		RecordAdd(Journal, Index, FCanvasJournal::BlockSize * 2);
+	}
+	TestEqual(TEXT("Blocks after rewinding over a large delta"), Journal.GetAllocatedSize(), AllocatedSize);
+	TestEqual(TEXT("Undo after rewinding"), Journal.NumUndo(), 2);
+	TestTrue(TEXT("Undo the last large delta"), Undo(Journal) == TArray<int32>{ 29 });
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCanvasJournalBudgetTest, "CustomWindow.Journal.Budget",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FCanvasJournalBudgetTest::RunTest(const FString& Parameters)
+{
+	using namespace CanvasJournalTest;
+
+	constexpr int64 MaxBytes = FCanvasJournal::BlockSize * 4;
+	constexpr int32 NumRecorded = 200;
+	FCanvasJournal Journal(MaxBytes);
+	int64 MaxAllocated = 0;
+	for (int32 Index = 0; Index < NumRecorded; ++Index)
+	{
+		RecordAdd(Journal, Index, FCanvasJournal::BlockSize / 4);
+		MaxAllocated = FMath::Max(MaxAllocated, Journal.GetAllocatedSize());
+	}
+	TestTrue(TEXT("Blocks stay within the budget"), MaxAllocated <= MaxBytes);
+	TestTrue(TEXT("Oldest transactions dropped"), Journal.NumUndo() > 0 && Journal.NumUndo() < NumRecorded);
+
+	// What is left is the newest transactions, without gaps
+	const int32 NumKept = Journal.NumUndo();
+	for (int32 Index = NumRecorded - 1; Index >= NumRecorded - NumKept; --Index)
+	{
+		TestTrue(TEXT("Undo in order"), Undo(Journal) == TArray<int32>{ Index });
+	}
+	TestFalse(TEXT("Undo past the kept transactions"), Journal.CanUndo());
+
+	// A transaction larger than the whole budget is still kept, alone
+	RecordAdd(Journal, NumRecorded, static_cast<int32>(MaxBytes * 2));
+	TestEqual(TEXT("Undo after an oversized transaction"), Journal.NumUndo(), 1);
+	TestTrue(TEXT("Undo the oversized transaction"), Undo(Journal) == TArray<int32>{ NumRecorded });
+
+	// Lowering the budget trims on the next transaction
+	FCanvasJournal Shrunk(MaxBytes);
+	for (int32 Index = 0; Index < 8; ++Index)
+	{
+		RecordAdd(Shrunk, Index, FCanvasJournal::BlockSize / 4);
+	}
+	Shrunk.SetMaxBytes(FCanvasJournal::BlockSize);
+	RecordAdd(Shrunk, 8, FCanvasJournal::BlockSize / 4);
+	TestTrue(TEXT("Blocks within the lowered budget"), Shrunk.GetAllocatedSize() <= FCanvasJournal::BlockSize * 2);
+	TestTrue(TEXT("Newest transaction kept"), Undo(Shrunk) == TArray<int32>{ 8 });
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCanvasJournalNestedTest, "CustomWindow.Journal.NestedTransactions",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FCanvasJournalNestedTest::RunTest(const FString& Parameters)
+{
+	using namespace CanvasJournalTest;
+
+	FCanvasJournal Journal;
+	Journal.BeginTransaction();
+	RecordAdd(Journal, 0);
+	Journal.BeginTransaction();
+	RecordAdd(Journal, 1);
+	Journal.EndTransaction();
+	TestFalse(TEXT("Undo while a transaction is open"), Journal.CanUndo());
+	RecordAdd(Journal, 2);
+	Journal.EndTransaction();
+
+	TestEqual(TEXT("Nested transactions undo as one"), Journal.NumUndo(), 1);
+	TestEqual(TEXT("Deltas"), Journal.NumDeltas(), 3);
+	TestTrue(TEXT("Undo newest first"), Undo(Journal) == TArray<int32>{ 2, 1, 0 });
+	TestTrue(TEXT("Redo oldest first"), Redo(Journal) == TArray<int32>{ 0, 1, 2 });
+
+	// A transaction without deltas leaves no step behind
+	Journal.BeginTransaction();
+	Journal.EndTransaction();
+	TestEqual(TEXT("Undo after an empty transaction"), Journal.NumUndo(), 1);
+
+	{
+		FCanvasJournalScope Outer(Journal);
+		RecordAdd(Journal, 3);
+		FCanvasJournalScope Inner(Journal);
+		RecordAdd(Journal, 4);
+	}
+	TestEqual(TEXT("Undo after scoped transactions"), Journal.NumUndo(), 2);
+	TestTrue(TEXT("Undo the scoped transaction"), Undo(Journal) == TArray<int32>{ 4, 3 });
+
+	// Opening a transaction only drops the redo history once it records something
+	Journal.BeginTransaction();
+	Journal.EndTransaction();
+	TestEqual(TEXT("Redo after an empty transaction"), Journal.NumRedo(), 1);
+	Journal.BeginTransaction();
+	RecordAdd(Journal, 5);
+	Journal.EndTransaction();
+	TestEqual(TEXT("Redo after recording"), Journal.NumRedo(), 0);
+	TestTrue(TEXT("Undo the new transaction"), Undo(Journal) == TArray<int32>{ 5 });
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCanvasJournalLayerOrderTest, "CustomWindow.Journal.LayerOrder",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FCanvasJournalLayerOrderTest::RunTest(const FString& Parameters)
+{
+	using namespace CanvasJournalTest;
+
+	FCustomViewportClient Client;
+	Client.AddBox(MakeBox(TEXT("A"), 0));
+	Client.AddBox(MakeBox(TEXT("B"), 0));
+	Client.AddBox(MakeBox(TEXT("C"), 0));
+	Client.AddBox(MakeBox(TEXT("D"), 1));
+
+	Client.RemoveItem(TEXT("B"));
+	TestEqual(TEXT("Removed"), GetBoxOrder(Client.Scene), FString(TEXT("ACD")));
+	Client.Undo();
+	TestEqual(TEXT("Undone remove"), GetBoxOrder(Client.Scene), FString(TEXT("ABCD")));
+	Client.Redo();
+	TestEqual(TEXT("Redone remove"), GetBoxOrder(Client.Scene), FString(TEXT("ACD")));
+	Client.Undo();
+
+	// Several removes in one transaction come back in their own order
+	const FName Names[] = { TEXT("B"), TEXT("A") };
+	Client.RemoveItems(MakeArrayView(Names));
+	TestEqual(TEXT("Removed both"), GetBoxOrder(Client.Scene), FString(TEXT("CD")));
+	Client.Undo();
+	TestEqual(TEXT("Undone removes"), GetBoxOrder(Client.Scene), FString(TEXT("ABCD")));
+
+	Client.AddBox(MakeBox(TEXT("B"), 1));
+	TestEqual(TEXT("Moved to layer 1"), GetBoxOrder(Client.Scene), FString(TEXT("ACDB")));
+	Client.Undo();
+	TestEqual(TEXT("Undone layer change"), GetBoxOrder(Client.Scene), FString(TEXT("ABCD")));
+	Client.Redo();
+	TestEqual(TEXT("Redone layer change"), GetBoxOrder(Client.Scene), FString(TEXT("ACDB")));
+	Client.Undo();
+
+	// A batch moves its items only once every change is recorded
+	const FBoxData Moved[] = { MakeBox(TEXT("A"), 1), MakeBox(TEXT("B"), 1) };
+	Client.AddBoxes(MakeArrayView(Moved));
+	TestEqual(TEXT("Moved both"), GetBoxOrder(Client.Scene), FString(TEXT("CDAB")));
+	Client.Undo();
+	TestEqual(TEXT("Undone batch"), GetBoxOrder(Client.Scene), FString(TEXT("ABCD")));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCanvasJournalReadDeltasTest, "CustomWindow.Journal.TruncatedLog",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FCanvasJournalReadDeltasTest::RunTest(const FString& Parameters)
+{
+	using namespace CanvasJournalTest;
+
+	FTextData Text;
+	Text.Name = TEXT("Text");
+	Text.Layer = 7;
+	Text.Message = TEXT("Logged");
+	TArray<uint8> Item;
+	CanvasDelta::WriteItem(Text, Item);
+
+	const FVector4f Before(1.f, 2.f, 0.f, 0.f);
+	const FVector4f After(3.f, 4.f, 0.f, 0.f);
+	TArray<uint8> PropertyBefore;
+	TArray<uint8> PropertyAfter;
+	CanvasDelta::WriteProperty(Text.Name, Before, PropertyBefore);
+	CanvasDelta::WriteProperty(Text.Name, After, PropertyAfter);
+
+	// Ends[Index] is where delta Index ends in the log
+	TArray<uint8> Log;
+	TArray<int32> Ends;
+	FCanvasJournal::WriteDelta(FCanvasDelta{ ECanvasDeltaOp::Add, ECanvasItemType::Text, ECanvasDeltaProperty::None, TArrayView<const uint8>(), Item }, Log);
+	Ends.Add(Log.Num());
+	FCanvasJournal::WriteDelta(FCanvasDelta{ ECanvasDeltaOp::Property, ECanvasItemType::Text, ECanvasDeltaProperty::Position, PropertyBefore, PropertyAfter }, Log);
+	Ends.Add(Log.Num());
+	FCanvasJournal::WriteDelta(FCanvasDelta{ ECanvasDeltaOp::Clear }, Log);
+	Ends.Add(Log.Num());
+
+	TArray<FCanvasDelta> Deltas;
+	TestTrue(TEXT("Read the whole log"), FCanvasJournal::ReadDeltas(Log, [&Deltas](const FCanvasDelta& Delta) { Deltas.Add(Delta); }));
+	if (!TestEqual(TEXT("Deltas read"), Deltas.Num(), 3))
+	{
+		return false;
+	}
+	TestEqual(TEXT("Added item"), GetIndex(Deltas[0]), 7);
+	FName Name;
+	FVector4f Value;
+	TestTrue(TEXT("Property"), CanvasDelta::ReadProperty(Deltas[1].After, Name, Value) && Name == Text.Name && Value == After);
+	TestTrue(TEXT("Property kind"), Deltas[1].Property == ECanvasDeltaProperty::Position);
+	TestTrue(TEXT("Clear"), Deltas[2].Op == ECanvasDeltaOp::Clear && Deltas[2].Before.Num() == 0 && Deltas[2].After.Num() == 0);
+
+	// Cut anywhere, the log reads up to the last whole delta and only succeeds when the cut falls between two
+	for (int32 Length = 0; Length < Log.Num(); ++Length)
+	{
+		int32 NumRead = 0;
+		const bool bRead = FCanvasJournal::ReadDeltas(MakeArrayView(Log.GetData(), Length), [&NumRead](const FCanvasDelta&) { ++NumRead; });
+		const int32 NumWhole = Algo::UpperBound(Ends, Length);
+		const bool bBoundary = Length == 0 || Ends.Contains(Length);
+		TestEqual(FString::Printf(TEXT("Deltas read from %d bytes"), Length), NumRead, NumWhole);
+		TestTrue(FString::Printf(TEXT("Result for %d bytes"), Length), bRead == bBoundary);
+	}
+
+	// An unknown op stops the read like a truncation
+	TArray<uint8> Corrupt = Log;
+	Corrupt[Ends[0]] = 0xFF;
+	int32 NumRead = 0;
+	TestFalse(TEXT("Read a corrupt log"), FCanvasJournal::ReadDeltas(Corrupt, [&NumRead](const FCanvasDelta&) { ++NumRead; }));
+	TestEqual(TEXT("Deltas read before the corrupt one"), NumRead, 1);
+	return true;
+}
+
+#endif
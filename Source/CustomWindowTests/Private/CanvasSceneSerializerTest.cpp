@@ -0,0 +1,152 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CanvasSceneSerializer.h"
+#include "CanvasPrimitive.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace CanvasSceneSerializerTest
+{
+	/** Prints every field of an item at full precision, so two scenes compare field by field */
+	struct FFieldPrinter
+	{
+		TArray<FString>& Lines;
+		const TCHAR* Primitive;
+
+		void Add(const FCanvasField& Field, const FString& Value) { Lines.Add(FString::Printf(TEXT("%s.%s = %s"), Primitive, Field.Key, *Value)); }
+
+		void operator()(const FCanvasField& Field, FName Value) { Add(Field, Value.ToString()); }
+		void operator()(const FCanvasField& Field, const FString& Value) { Add(Field, Value); }
+		void operator()(const FCanvasField& Field, float Value) { Add(Field, FString::Printf(TEXT("%.9g"), Value)); }
+		void operator()(const FCanvasField& Field, int32 Value) { Add(Field, FString::FromInt(Value)); }
+		void operator()(const FCanvasField& Field, const FVector2D& Value) { Add(Field, FString::Printf(TEXT("%.9g %.9g"), Value.X, Value.Y)); }
+		void operator()(const FCanvasField& Field, const FLinearColor& Value) { Add(Field, FString::Printf(TEXT("%.9g %.9g %.9g %.9g"), Value.R, Value.G, Value.B, Value.A)); }
+	};
+
+	static TArray<FString> PrintScene(const FCanvasSceneData& Data)
+	{
+		TArray<FString> Lines;
+		FCanvasPrimitives::ForEach([&Data, &Lines](auto Primitive)
+		{
+			for (const auto& Item : Data.*decltype(Primitive)::Items)
+			{
+				decltype(Primitive)::VisitFields(Item, FFieldPrinter{ Lines, decltype(Primitive)::Key });
+			}
+		});
+		return Lines;
+	}
+
+	/** Items of every primitive with no field left at its default, sharing some strings and using non-ASCII ones */
+	static FCanvasSceneData MakeScene()
+	{
+		FCanvasSceneData Data;
+		for (int32 Index = 0; Index < 3; ++Index)
+		{
+			FBoxData& Box = Data.Boxes.AddDefaulted_GetRef();
+			Box.Name = FName(TEXT("Box"), Index + 1);
+			Box.Position = FVector2D(10.25f * Index, -3.5f);
+			Box.Size = FVector2D(64.f, 0.1f + Index);
+			Box.Color = FLinearColor(0.1f, 0.2f, 0.3f, 0.4f);
+			Box.Thickness = 2.75f;
+			Box.Layer = -Index;
+
+			FTextData& Text = Data.Texts.AddDefaulted_GetRef();
+			Text.Name = FName(TEXT("Text"), Index + 1);
+			Text.Position = FVector2D(1.f / 3.f, 1e6f);
+			Text.FontSize = 1.5f;
+			Text.Color = FLinearColor(1.f, 0.5f, 0.f, 0.25f);
+			Text.Message = Index == 0 ? FString(TEXT("Gr\u00FC\u00DFe, \u4E16\u754C")) : FString::Printf(TEXT("Line %d"), Index);
+			Text.FontPath = TEXT("/Engine/EngineFonts/Roboto.Roboto");
+			Text.Layer = Index;
+
+			FTileData& Tile = Data.Tiles.AddDefaulted_GetRef();
+			Tile.Name = FName(TEXT("Tile"), Index + 1);
+			Tile.Position = FVector2D(-7.f, 7.f * Index);
+			Tile.Size = FVector2D(128.f, 32.f);
+			Tile.Color = FLinearColor(0.f, 1.f, 0.f, 0.5f);
+			Tile.TexturePath = TEXT("/Engine/EngineResources/DefaultTexture.DefaultTexture");
+			Tile.Layer = 2;
+		}
+		return Data;
+	}
+
+	static void TestSameScene(FAutomationTestBase& Test, const FCanvasSceneData& Expected, const FCanvasSceneData& Actual)
+	{
+		Test.TestEqual(TEXT("Boxes"), Actual.Boxes.Num(), Expected.Boxes.Num());
+		Test.TestEqual(TEXT("Texts"), Actual.Texts.Num(), Expected.Texts.Num());
+		Test.TestEqual(TEXT("Tiles"), Actual.Tiles.Num(), Expected.Tiles.Num());
+
+		const TArray<FString> ExpectedLines = PrintScene(Expected);
+		const TArray<FString> ActualLines = PrintScene(Actual);
+		for (int32 Index = 0; Index < FMath::Min(ExpectedLines.Num(), ActualLines.Num()); ++Index)
+		{
+			Test.TestEqual(TEXT("Field"), ActualLines[Index], ExpectedLines[Index]);
+		}
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCanvasSceneSerializerBinaryTest, "CustomWindow.Serializer.BinaryRoundTrip",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FCanvasSceneSerializerBinaryTest::RunTest(const FString& Parameters)
+{
+	using namespace CanvasSceneSerializerTest;
+
+	const FCanvasSceneData Scene = MakeScene();
+	TArray<uint8> Bytes;
+	FCanvasSceneSerializer::WriteBinary(Scene, Bytes);
+
+	FCanvasSceneData Read;
+	if (TestTrue(TEXT("ReadBinary"), FCanvasSceneSerializer::ReadBinary(Bytes, Read)))
+	{
+		TestSameScene(*this, Scene, Read);
+	}
+
+	FCanvasSceneData Empty;
+	FCanvasSceneSerializer::WriteBinary(FCanvasSceneData(), Bytes);
+	TestTrue(TEXT("ReadBinary of an empty scene"), FCanvasSceneSerializer::ReadBinary(Bytes, Empty) && Empty.Num() == 0);
+
+	// Truncated files and unknown versions are rejected
+	FCanvasSceneSerializer::WriteBinary(Scene, Bytes);
+	AddExpectedError(TEXT("doesn't match its header"), EAutomationExpectedErrorFlags::Contains, 1);
+	FCanvasSceneData Truncated;
+	TestFalse(TEXT("ReadBinary of a truncated file"), FCanvasSceneSerializer::ReadBinary(MakeArrayView(Bytes.GetData(), Bytes.Num() - 1), Truncated));
+
+	const uint32 NextVersion = FCanvasSceneSerializer::BinaryVersion + 1;
+	FMemory::Memcpy(Bytes.GetData() + sizeof(uint32), &NextVersion, sizeof(uint32));
+	AddExpectedError(TEXT("unsupported version"), EAutomationExpectedErrorFlags::Contains, 1);
+	FCanvasSceneData NewerVersion;
+	TestFalse(TEXT("ReadBinary of a newer version"), FCanvasSceneSerializer::ReadBinary(Bytes, NewerVersion));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCanvasSceneSerializerJsonTest, "CustomWindow.Serializer.JsonRoundTrip",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FCanvasSceneSerializerJsonTest::RunTest(const FString& Parameters)
+{
+	using namespace CanvasSceneSerializerTest;
+
+	const FCanvasSceneData Scene = MakeScene();
+	FCanvasSceneData Read;
+	if (TestTrue(TEXT("ReadJson"), FCanvasSceneSerializer::ReadJson(FCanvasSceneSerializer::WriteJson(Scene), Read)))
+	{
+		TestSameScene(*this, Scene, Read);
+	}
+
+	// Elements that aren't objects are skipped instead of dereferenced
+	AddExpectedError(TEXT("not objects"), EAutomationExpectedErrorFlags::Contains, 1);
+	FCanvasSceneData Mixed;
+	TestTrue(TEXT("ReadJson with non-object items"), FCanvasSceneSerializer::ReadJson(TEXT("{\"version\": 1, \"boxes\": [1, \"box\", null, {\"name\": \"Box\"}]}"), Mixed));
+	TestEqual(TEXT("Boxes read around non-object items"), Mixed.Boxes.Num(), 1);
+
+	AddExpectedError(TEXT("unsupported version"), EAutomationExpectedErrorFlags::Contains, 2);
+	FCanvasSceneData Unversioned;
+	TestFalse(TEXT("ReadJson without a version"), FCanvasSceneSerializer::ReadJson(TEXT("{\"boxes\": []}"), Unversioned));
+	FCanvasSceneData NewerVersion;
+	TestFalse(TEXT("ReadJson of a newer version"), FCanvasSceneSerializer::ReadJson(FString::Printf(TEXT("{\"version\": %d}"), FCanvasSceneSerializer::JsonVersion + 1), NewerVersion));
+	return true;
+}
+
+#endif
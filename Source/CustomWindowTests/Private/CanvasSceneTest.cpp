@@ -0,0 +1,147 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CanvasScene.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace CanvasSceneTest
+{
+	static FBoxInstance MakeBox(float X, int32 Layer = 0)
+	{
+		FBoxInstance Box;
+		Box.Position = FVector2D(X, 0.f);
+		Box.Size = FVector2D(10.f, 10.f);
+		Box.Layer = Layer;
+		return Box;
+	}
+
+	static TArray<FName> GetBoxOrder(const FCanvasScene& Scene)
+	{
+		TArray<FName> Names;
+		for (const FBoxInstance& Box : Scene.GetItems<FBoxInstance>())
+		{
+			Names.Add(Scene.GetName(Box.Slot));
+		}
+		return Names;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCanvasSceneHandleTest, "CustomWindow.Scene.StaleHandles",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FCanvasSceneHandleTest::RunTest(const FString& Parameters)
+{
+	using namespace CanvasSceneTest;
+
+	FCanvasScene Scene;
+	const FCanvasItemHandle First = Scene.Add(TEXT("First"), MakeBox(0.f));
+	const FCanvasItemHandle Second = Scene.Add(TEXT("Second"), MakeBox(20.f));
+	TestTrue(TEXT("Handles valid after Add"), Scene.IsValid(First) && Scene.IsValid(Second));
+	TestTrue(TEXT("Replacing keeps the handle"), Scene.Add(TEXT("First"), MakeBox(5.f)) == First);
+
+	// A removed slot is reused with a new generation
+	TestTrue(TEXT("Remove"), Scene.Remove(First));
+	TestFalse(TEXT("Removed handle"), Scene.IsValid(First));
+	const FCanvasItemHandle Reused = Scene.Add(TEXT("Third"), MakeBox(40.f));
+	TestEqual(TEXT("Slot reused"), Reused.Slot, First.Slot);
+	TestFalse(TEXT("Removed handle after its slot was reused"), Scene.IsValid(First));
+	TestNull(TEXT("Get through a removed handle"), Scene.Get<FBoxInstance>(First));
+
+	// Handles from before Empty must not match the items added after it, even in the same slots
+	const TArray<FCanvasItemHandle> Before = { Second, Reused, Scene.Find(TEXT("Second")) };
+	Scene.Empty();
+	TestEqual(TEXT("Empty scene"), Scene.Num(), 0);
+	const FCanvasItemHandle After = Scene.Add(TEXT("Second"), MakeBox(60.f));
+	const FCanvasItemHandle AfterOther = Scene.Add(TEXT("Other"), MakeBox(80.f));
+	for (const FCanvasItemHandle& Handle : Before)
+	{
+		TestFalse(TEXT("Handle from before Empty"), Scene.IsValid(Handle));
+		TestNull(TEXT("Get through a handle from before Empty"), Scene.Get<FBoxInstance>(Handle));
+		TestFalse(TEXT("Remove through a handle from before Empty"), Scene.Remove(Handle));
+	}
+	TestTrue(TEXT("Handles added after Empty"), Scene.IsValid(After) && Scene.IsValid(AfterOther));
+	TestEqual(TEXT("Items left"), Scene.Num(), 2);
+	TestTrue(TEXT("Find after Empty"), Scene.Find(TEXT("Second")) == After);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCanvasSceneCopyOnWriteTest, "CustomWindow.Scene.CopyOnWrite",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FCanvasSceneCopyOnWriteTest::RunTest(const FString& Parameters)
+{
+	using namespace CanvasSceneTest;
+
+	FCanvasScene Scene;
+	TArray<FName> Names;
+	TArray<FBoxInstance> Boxes;
+	for (int32 Index = 0; Index < 1000; ++Index)
+	{
+		Names.Add(FName(TEXT("Box"), Index + 1));
+		Boxes.Add(MakeBox(Index * 20.f, Index % 4));
+	}
+	Scene.AddBatch(MakeArrayView(Names), MakeArrayView(Boxes));
+	const FCanvasItemHandle Handle = Scene.Find(FName(TEXT("Box"), 500));
+
+	// Nothing shares the array, editing one item edits it in place
+	const TArray<FBoxInstance>* Items = &Scene.GetItems<FBoxInstance>();
+	Scene.Edit<FBoxInstance>(Handle)->Position.Y = 1.f;
+	TestTrue(TEXT("Unshared array edited in place"), &Scene.GetItems<FBoxInstance>() == Items);
+
+	// While a snapshot holds the array, the edit goes to a copy and the snapshot keeps seeing the old item
+	{
+		const TCanvasItemArrayConstRef<FBoxInstance> Shared = Scene.ShareItems<FBoxInstance>();
+		Scene.Edit<FBoxInstance>(Handle)->Position.Y = 2.f;
+		TestTrue(TEXT("Shared array copied"), &Scene.GetItems<FBoxInstance>() != &*Shared);
+		const int32 Index = static_cast<int32>(Scene.Get<FBoxInstance>(Handle) - Scene.GetItems<FBoxInstance>().GetData());
+		TestEqual(TEXT("Snapshot unchanged"), (*Shared)[Index].Position.Y, 1.0);
+	}
+
+	// Once it let go, edits are in place again
+	Items = &Scene.GetItems<FBoxInstance>();
+	Scene.Edit<FBoxInstance>(Handle)->Position.Y = 3.f;
+	TestTrue(TEXT("Released array edited in place"), &Scene.GetItems<FBoxInstance>() == Items);
+	TestEqual(TEXT("Edited item"), Scene.Get<FBoxInstance>(Handle)->Position.Y, 3.0);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCanvasSceneLayerChangeTest, "CustomWindow.Scene.LayerChangeOrder",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FCanvasSceneLayerChangeTest::RunTest(const FString& Parameters)
+{
+	using namespace CanvasSceneTest;
+
+	// Both scenes start as A on layer 0, B and C on layer 1, and then move A to layer 1 next to a new D
+	FCanvasScene Single;
+	FCanvasScene Batched;
+	for (FCanvasScene* Scene : { &Single, &Batched })
+	{
+		Scene->Add(TEXT("A"), MakeBox(0.f, 0));
+		Scene->Add(TEXT("B"), MakeBox(20.f, 1));
+		Scene->Add(TEXT("C"), MakeBox(40.f, 1));
+	}
+
+	Single.Add(TEXT("A"), MakeBox(0.f, 1));
+	Single.Add(TEXT("D"), MakeBox(60.f, 1));
+
+	const TArray<FName> Names = { TEXT("A"), TEXT("D") };
+	TArray<FBoxInstance> Boxes = { MakeBox(0.f, 1), MakeBox(60.f, 1) };
+	Batched.AddBatch(MakeArrayView(Names), MakeArrayView(Boxes));
+
+	const TArray<FName> Expected = { TEXT("B"), TEXT("C"), TEXT("A"), TEXT("D") };
+	TestTrue(TEXT("Add moves the item after its new layer"), GetBoxOrder(Single) == Expected);
+	TestTrue(TEXT("AddBatch orders like Add"), GetBoxOrder(Batched) == Expected);
+
+	// Moving back down goes after the items already on layer 0, of which there are none left
+	Single.Add(TEXT("C"), MakeBox(40.f, 0));
+	const TArray<FName> BatchNames = { TEXT("C") };
+	TArray<FBoxInstance> BatchBoxes = { MakeBox(40.f, 0) };
+	Batched.AddBatch(MakeArrayView(BatchNames), MakeArrayView(BatchBoxes));
+	TestTrue(TEXT("Add and AddBatch agree after moving down"), GetBoxOrder(Single) == GetBoxOrder(Batched));
+	TestTrue(TEXT("Handles follow the moved items"), Batched.Get<FBoxInstance>(Batched.Find(TEXT("C")))->Layer == 0);
+	return true;
+}
+
+#endif
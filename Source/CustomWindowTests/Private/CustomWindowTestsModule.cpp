@@ -0,0 +1,6 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Modules/ModuleManager.h"
+
+// Automation tests of the CustomWindow module, they register themselves when the module loads
+IMPLEMENT_MODULE(FDefaultModuleImpl, CustomWindowTests)